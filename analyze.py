@@ -8,8 +8,10 @@ the complete protocol specification.
 Usage:
     python analyze.py              # Analyze all capture files (default)
     python analyze.py --spec       # Generate protocol reference document
+    python analyze.py --jobs 8     # Decode files in 8 worker processes
     python analyze.py --file X.txt # Analyze a single capture file
     python analyze.py --raw X.txt  # Raw symbols without interpretation
+    python analyze.py --check      # Verify numpy path == scalar path
 
 Physical interface:
     Pin 1: GND
@@ -27,6 +29,8 @@ PWM encoding:
     In position fields, HIGH varies and encodes binary position data.
     Messages are bursts of symbols separated by >10ms idle-HIGH gaps.
     Carrier blocks (3838 Hz, 16 pulses) accompany some CH0 transmissions.
+    An edge on one wire couples into the other as a pulse of a few us;
+    suppress_crosstalk() drops those before bursts are cut.
 
     Position encoding (Type B payload pos 5+):
     The position field uses active-low, LSB-first binary waveform encoding.
@@ -40,8 +44,11 @@ PWM encoding:
 import os
 import sys
 import io
+import pickle
+import bisect
+import hashlib
 import argparse
-from dataclasses import dataclass, field
+from dataclasses import dataclass, field, asdict
 from collections import Counter
 from typing import List, Dict, Tuple, Optional
 
@@ -61,6 +68,13 @@ CARRIER_FREQ_HZ = 3838      # Carrier tone frequency
 CARRIER_PULSES = 16         # Pulses per carrier block
 CARRIER_DUTY = 0.10         # ~10% duty cycle
 CROSSTALK_THRESH = 10       # H durations above this are CH0 carrier crosstalk artifacts
+XTALK_GLITCH_US = 13        # pulses shorter than PWM_UNIT_US/2 are not symbols...
+XTALK_WIN_US = 5            # ...and are crosstalk with another channel's edge this close
+
+# -- Decode cache --
+DECODER_VERSION = 2         # Bump whenever decoding/classification output changes
+                            # (then python bench.py --update-golden)
+CACHE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), ".decode_cache")
 
 # -- Wire roles --
 WIRE_ROLES = {
@@ -297,6 +311,8 @@ class Message:
     header: list = field(default_factory=list)
     payload: list = field(default_factory=list)
     state: Optional[dict] = None   # decoded state dict (TYPE-B only)
+    pairs: list = field(default_factory=list)    # (L, H) unit pairs, see burst_to_lh_pairs
+    low_us: list = field(default_factory=list)   # raw LOW durations behind symbols
 
 
 @dataclass
@@ -313,20 +329,61 @@ class CaptureAnalysis:
     ch1_count: int
     carrier_blocks: int
     pwm_unit_stats: Optional[dict] = None
+    xtalk_pulses: int = 0     # pulses removed by suppress_crosstalk()
 
 
 # ====================================================================
 #  CORE PARSING & DECODING
 # ====================================================================
 
-def parse_capture(filepath):
+# numpy is optional.  With it, the burst helpers below run vectorized on
+# bursts of VECTOR_MIN transitions or more (below that, array setup costs
+# more than the loop); otherwise, or for short bursts, the scalar _py
+# versions run.  Both give identical results — check with --check.
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+VECTOR_MIN = 32
+
+
+def _times(transitions):
+    return np.fromiter((t for t, _ in transitions), dtype=np.float64,
+                       count=len(transitions))
+
+
+def _round1(x):
+    """Elementwise round(x, 1), matching Python's correctly rounded result.
+
+    rint(x*10)/10 agrees with round() except where x*10 lands within
+    float error of a .5 tie; those few elements are redone in Python.
+    """
+    y = x * 10.0
+    r = np.rint(y) / 10.0
+    for i in np.flatnonzero(np.abs(y - np.floor(y) - 0.5) < 1e-6).tolist():
+        r[i] = round(float(x[i]), 1)
+    return r
+
+
+def parse_capture(filepath, use_gcap=True):
     """Parse a logic analyzer CSV into per-channel transition lists.
 
     Auto-detects 2-column (single channel) vs 3-column (dual channel) format.
+    A .gcap path, or a .gcap sibling at least as new as the CSV (see
+    gcap.py convert), is loaded directly instead of re-parsing the text.
     Returns: (channels_dict, column_count)
         channels_dict: {0: [(t, val), ...], 1: [(t, val), ...]}
         column_count: 2 or 3
     """
+    if use_gcap:
+        import gcap
+        if filepath.endswith(".gcap"):
+            return gcap.load_gcap(filepath)
+        g = gcap.fresh_gcap_for(filepath)
+        if g:
+            return gcap.load_gcap(g)
+
     channels = {0: [], 1: []}
     prev = {0: None, 1: None}
     col_count = 3
@@ -367,10 +424,70 @@ def parse_capture(filepath):
     return channels, col_count
 
 
+def short_pulses(transitions, glitch_us=XTALK_GLITCH_US):
+    """Indices i >= 1 whose pulse, transitions[i] to [i+1], is under glitch_us.
+
+    Index 0 is the capture's starting level, not an edge, so it never
+    starts a pulse.
+    """
+    if np is not None and len(transitions) >= VECTOR_MIN:
+        dur_us = np.diff(_times(transitions)[1:]) * 1e6
+        return (np.flatnonzero(dur_us < glitch_us) + 1).tolist()
+    return _short_pulses_py(transitions, glitch_us)
+
+
+def _short_pulses_py(transitions, glitch_us=XTALK_GLITCH_US):
+    return [i for i in range(1, len(transitions) - 1)
+            if (transitions[i + 1][0] - transitions[i][0]) * 1e6 < glitch_us]
+
+
+def suppress_crosstalk(channels, glitch_us=XTALK_GLITCH_US, win_us=XTALK_WIN_US):
+    """Drop sub-unit pulses that coincide with an edge on another channel.
+
+    A pulse of either level shorter than glitch_us is taken out (both
+    its edges, so the level sequence stays intact) when some other
+    channel has an edge from win_us before it starts to win_us after it
+    ends.  Isolated short pulses are kept: BEACON carries real ones.
+    esp32_capture's decoder runs the same stage (XTALK_FILTER) on the
+    constants gen_msg_table.py copies into msg_table.h.
+
+    Returns (channels, pulses removed); the input is not modified.
+    """
+    times = {ch: [t for t, _ in tr[1:]] for ch, tr in channels.items()}
+    out, removed = {}, 0
+    for ch, tr in channels.items():
+        if len(tr) < 3:
+            out[ch] = tr
+            continue
+        others = [times[o] for o in channels if o != ch and times[o]]
+        drop = set()
+        for i in short_pulses(tr, glitch_us):
+            if i in drop:
+                continue
+            lo, hi = tr[i][0] - win_us * 1e-6, tr[i + 1][0] + win_us * 1e-6
+            for o in others:
+                k = bisect.bisect_left(o, lo)
+                if k < len(o) and o[k] <= hi:
+                    drop.update((i, i + 1))
+                    break
+        removed += len(drop) // 2
+        out[ch] = [e for i, e in enumerate(tr) if i not in drop] if drop else tr
+    return out, removed
+
+
 def find_bursts(transitions, gap_threshold=BURST_GAP_S):
     """Split transitions into bursts separated by idle gaps > threshold."""
     if len(transitions) < 2:
         return []
+    if np is not None and len(transitions) >= VECTOR_MIN:
+        t = _times(transitions)
+        cuts = (np.flatnonzero(np.diff(t) > gap_threshold) + 1).tolist()
+        bounds = [0] + cuts + [len(transitions)]
+        return [transitions[a:b] for a, b in zip(bounds, bounds[1:])]
+    return _find_bursts_py(transitions, gap_threshold)
+
+
+def _find_bursts_py(transitions, gap_threshold=BURST_GAP_S):
     bursts = []
     current = [transitions[0]]
     for i in range(1, len(transitions)):
@@ -386,6 +503,13 @@ def find_bursts(transitions, gap_threshold=BURST_GAP_S):
 
 def burst_pulses(burst):
     """Extract (state, duration_us) pairs from a burst's transitions."""
+    if np is not None and len(burst) >= VECTOR_MIN:
+        dur = _round1(np.diff(_times(burst)) * 1e6)
+        return list(zip([s for _, s in burst[:-1]], dur.tolist()))
+    return _burst_pulses_py(burst)
+
+
+def _burst_pulses_py(burst):
     pulses = []
     for i in range(1, len(burst)):
         state = burst[i-1][1]
@@ -417,7 +541,10 @@ def decode_pwm(burst, unit=PWM_UNIT_US):
     """
     pulses = burst_pulses(burst)
     low_us = [d for s, d in pulses if s == 0]
-    symbols = [round(d / unit) for d in low_us]
+    if np is not None and len(low_us) >= VECTOR_MIN:
+        symbols = np.rint(np.array(low_us) / unit).astype(np.int64).tolist()
+    else:
+        symbols = [round(d / unit) for d in low_us]
     return symbols, low_us
 
 
@@ -445,6 +572,23 @@ def burst_to_lh_pairs(burst):
 
     Returns list of (L, H) tuples.
     """
+    if np is not None and len(burst) >= VECTOR_MIN:
+        # Every LOW segment yields a pair; H is the next segment's units
+        # when that segment is HIGH, else 0.  The scalar walk below skips
+        # a zero-unit HIGH one step at a time, which comes to the same.
+        units = np.rint(np.diff(_times(burst)) * 1e6 / PWM_UNIT_US).astype(np.int64)
+        states = np.array([s for _, s in burst[:-1]])
+        low = np.flatnonzero(states == 0)
+        nxt = low + 1
+        nxt_high = nxt < len(states)
+        nxt_high[nxt_high] = states[nxt[nxt_high]] == 1
+        h = np.zeros(len(low), dtype=np.int64)
+        h[nxt_high] = units[nxt[nxt_high]]
+        return list(zip(units[low].tolist(), h.tolist()))
+    return _burst_to_lh_pairs_py(burst)
+
+
+def _burst_to_lh_pairs_py(burst):
     segs = []
     for i in range(1, len(burst)):
         state = burst[i-1][1]
@@ -567,24 +711,89 @@ def decode_type_b_position(payload_pairs):
 #  MESSAGE CLASSIFICATION
 # ====================================================================
 
+# The exact and prefix tables above are compiled into one trie per
+# channel at import, so a message is classified in a single walk over its
+# symbols however many patterns there are.  A node records the exact
+# match that ends there and the best prefix match at or above it (the
+# earliest entry in the prefix list, as the old linear scan picked), so
+# the walk just stops where the symbols leave the trie.  gen_msg_table.py
+# flattens the same tries into esp32_capture/main/msg_table.h.
+
+CH1_PREFIX_CATS = {
+    "TYPE-B": "STATUS",
+    "TYPE-C": "FULL_STATUS",
+    "BEACON": "BEACON",
+    "ECHO": "ECHO",
+}
+
+
+class MsgTrieNode:
+    __slots__ = ("next", "exact", "prefix")
+
+    def __init__(self, prefix=None):
+        self.next = {}          # symbol → MsgTrieNode
+        self.exact = None       # (name, desc, cat, hdr_len) ending here
+        self.prefix = prefix    # (rank, (name, desc, cat, hdr_len)) at or above
+
+
+def build_msg_trie(exact, prefixes, exact_cat, prefix_cat):
+    """Exact table {symbols: (name, desc)} + prefix list → trie root."""
+    root = MsgTrieNode()
+
+    def walk(key):
+        node = root
+        for sym in key:
+            if sym not in node.next:
+                node.next[sym] = MsgTrieNode()
+            node = node.next[sym]
+        return node
+
+    for key, (name, desc) in exact.items():
+        walk(key).exact = (name, desc, exact_cat, len(key))
+    for rank, (prefix, name, desc) in enumerate(prefixes):
+        node = walk(prefix)
+        if node.prefix is None or rank < node.prefix[0]:
+            node.prefix = (rank, (name, desc, prefix_cat(name), len(prefix)))
+
+    def inherit(node, best):
+        if best is not None and (node.prefix is None or best[0] < node.prefix[0]):
+            node.prefix = best
+        for child in node.next.values():
+            inherit(child, node.prefix)
+    inherit(root, None)
+    return root
+
+
+def classify_trie(root, symbols):
+    """One pass over symbols → (name, desc, cat, header_len) or None."""
+    node = root
+    for sym in symbols:
+        nxt = node.next.get(sym)
+        if nxt is None:
+            break
+        node = nxt
+    else:
+        if node.exact is not None:
+            return node.exact
+    return node.prefix[1] if node.prefix else None
+
+
+CH0_TRIE = build_msg_trie(CH0_COMMANDS, CH0_PREFIXES, "COMMAND",
+                          lambda name: "COMMAND")
+CH1_TRIE = build_msg_trie(
+    CH1_RESPONSES, CH1_PREFIXES, "ACK",
+    lambda name: CH1_PREFIX_CATS.get(
+        name, "HANDSHAKE" if "HANDSHAKE" in name or "BOOT" in name else "UNKNOWN"))
+
+
 def classify_ch0(symbols):
     """Classify a CH0 (Z3, receiver->opener) message.
 
     Returns: (name, description, category, header_len)
     """
-    key = tuple(symbols)
-
-    # Exact match first
-    if key in CH0_COMMANDS:
-        name, desc = CH0_COMMANDS[key]
-        cat = "COMMAND"
-        return name, desc, cat, len(symbols)
-
-    # Prefix match
-    for prefix, name, desc in CH0_PREFIXES:
-        if len(key) >= len(prefix) and key[:len(prefix)] == prefix:
-            return name, desc, "COMMAND", len(prefix)
-
+    hit = classify_trie(CH0_TRIE, symbols)
+    if hit is not None:
+        return hit
     return "CH0-UNKNOWN", f"Unrecognized CH0 message ({len(symbols)} symbols)", "UNKNOWN", 0
 
 
@@ -593,25 +802,9 @@ def classify_ch1(symbols):
 
     Returns: (name, description, category, header_len)
     """
-    key = tuple(symbols)
-
-    # Exact match first
-    if key in CH1_RESPONSES:
-        name, desc = CH1_RESPONSES[key]
-        cat = "ACK"
-        return name, desc, cat, len(symbols)
-
-    # Prefix match
-    for prefix, name, desc in CH1_PREFIXES:
-        if len(key) >= len(prefix) and key[:len(prefix)] == prefix:
-            cat = {
-                "TYPE-B": "STATUS",
-                "TYPE-C": "FULL_STATUS",
-                "BEACON": "BEACON",
-                "ECHO": "ECHO",
-            }.get(name, "HANDSHAKE" if "HANDSHAKE" in name or "BOOT" in name else "UNKNOWN")
-            return name, desc, cat, len(prefix)
-
+    hit = classify_trie(CH1_TRIE, symbols)
+    if hit is not None:
+        return hit
     return "CH1-UNKNOWN", f"Unrecognized CH1 message ({len(symbols)} symbols)", "UNKNOWN", 0
 
 
@@ -676,7 +869,8 @@ def decode_type_b_state(payload):
 
 def make_message(time, channel, burst):
     """Create a fully classified Message from a burst on the given channel."""
-    symbols, _ = decode_pwm(burst)
+    symbols, low_us = decode_pwm(burst)
+    pairs = burst_to_lh_pairs(burst)
 
     if channel == 0:
         name, desc, cat, hdr_len = classify_ch0(symbols)
@@ -690,7 +884,6 @@ def make_message(time, channel, burst):
     if name == "TYPE-B" and len(symbols) > TYPE_B_HEADER_LEN:
         state = decode_type_b_state(symbols[TYPE_B_HEADER_LEN:])
         # Decode position using full (L,H) pair encoding
-        pairs = burst_to_lh_pairs(burst)
         if len(pairs) > TYPE_B_HEADER_LEN:
             pos_info = decode_type_b_position(pairs[TYPE_B_HEADER_LEN:])
             state.update(pos_info)
@@ -705,6 +898,8 @@ def make_message(time, channel, burst):
         header=header,
         payload=payload,
         state=state,
+        pairs=pairs,
+        low_us=low_us,
     )
 
 
@@ -721,6 +916,7 @@ def analyze_capture(filepath):
     meta = TEST_FILES.get(filename, {"group": "unknown", "desc": filename})
 
     channels, col_count = parse_capture(filepath)
+    channels, xtalk = suppress_crosstalk(channels)
 
     # Compute duration
     duration = 0.0
@@ -770,9 +966,60 @@ def analyze_capture(filepath):
         ch1_count=len(ch1_msgs),
         carrier_blocks=carrier_count,
         pwm_unit_stats=pwm_stats,
+        xtalk_pulses=xtalk,
     )
 
 
+def load_analysis(filepath, use_cache=True):
+    """analyze_capture() through a persistent on-disk cache.
+
+    Entries in CACHE_DIR are keyed by the SHA-1 of the capture file and
+    DECODER_VERSION, so editing one capture re-decodes only that file and
+    a decoder change invalidates everything.  Entries hold plain dicts
+    rather than pickled dataclasses, so they load the same whether
+    analyze.py runs as a script or is imported.  Name-derived metadata
+    (filename, group, description) is re-applied on load.  A cache entry
+    that cannot be written is skipped, never an error.  This is the one
+    entry point every analysis script should use.
+    """
+    if not use_cache:
+        return analyze_capture(filepath)
+
+    with open(filepath, "rb") as f:
+        digest = hashlib.sha1(f.read()).hexdigest()
+    entry = os.path.join(CACHE_DIR, f"{digest}-v{DECODER_VERSION}.pkl")
+
+    try:
+        with open(entry, "rb") as f:
+            fields, msgs = pickle.load(f)
+        fields["messages"] = [Message(**m) for m in msgs]
+        a = CaptureAnalysis(**fields)
+    except (OSError, pickle.UnpicklingError, EOFError, TypeError, ValueError):
+        a = analyze_capture(filepath)
+        fields = asdict(a)
+        msgs = fields.pop("messages")
+        tmp = f"{entry}.{os.getpid()}.tmp"
+        try:                            # read-only checkout, full disk: skip
+            os.makedirs(CACHE_DIR, exist_ok=True)
+            with open(tmp, "wb") as f:
+                pickle.dump((fields, msgs), f, protocol=pickle.HIGHEST_PROTOCOL)
+            os.replace(tmp, entry)
+        except OSError:
+            try:
+                os.remove(tmp)
+            except OSError:
+                pass
+        return a
+
+    filename = os.path.basename(filepath)
+    meta = TEST_FILES.get(filename, {"group": "unknown", "desc": filename})
+    a.filepath = filepath
+    a.filename = filename
+    a.description = meta["desc"]
+    a.group = meta["group"]
+    return a
+
+
 # ====================================================================
 #  OUTPUT FORMATTING
 # ====================================================================
@@ -817,7 +1064,8 @@ def print_file_analysis(analysis, raw=False):
     print(f"{'='*78}")
     print(f"  Duration: {a.duration:.3f}s | Format: {a.columns}-column | "
           f"Messages: {len(a.messages)} (CH0={a.ch0_count}, CH1={a.ch1_count}) | "
-          f"Carrier blocks: {a.carrier_blocks}")
+          f"Carrier blocks: {a.carrier_blocks}"
+          f"{f' | Crosstalk pulses removed: {a.xtalk_pulses}' if a.xtalk_pulses else ''}")
 
     if not a.messages:
         print("  (no decoded messages)")
@@ -1302,21 +1550,36 @@ def print_spec(analyses):
 #  ALL-FILE RUNNER
 # ====================================================================
 
-def run_all(base_dir):
-    """Analyze all capture files, grouped by test scenario."""
-    analyses = {}
+def discover_files(base_dir):
+    """Capture files in analysis order: manifest first, then any others."""
+    names = [f for f in TEST_FILES if os.path.exists(os.path.join(base_dir, f))]
+    names += [f for f in os.listdir(base_dir)
+              if f.endswith(".txt") and f not in TEST_FILES]
+    return names
+
+
+def load_all(base_dir, names, jobs=1, use_cache=True):
+    """load_analysis() each file, fanned out over `jobs` processes.
+
+    Files are independent, so with jobs > 1 they are decoded in a process
+    pool; map() keeps results in input order, so output is the same as a
+    sequential run.  jobs=0 uses every core.
+    """
+    paths = [os.path.join(base_dir, f) for f in names]
+    jobs = jobs or os.cpu_count() or 1
+    if jobs == 1 or len(paths) < 2:
+        results = [load_analysis(p, use_cache) for p in paths]
+    else:
+        from concurrent.futures import ProcessPoolExecutor
+        with ProcessPoolExecutor(max_workers=min(jobs, len(paths))) as pool:
+            results = list(pool.map(load_analysis, paths,
+                                    [use_cache] * len(paths), chunksize=1))
+    return dict(zip(names, results))
 
-    # Discover and analyze all files
-    for fname, meta in TEST_FILES.items():
-        path = os.path.join(base_dir, fname)
-        if os.path.exists(path):
-            analyses[fname] = analyze_capture(path)
 
-    # Also discover any files not in manifest
-    for f in os.listdir(base_dir):
-        if f.endswith(".txt") and f not in analyses and f not in TEST_FILES:
-            path = os.path.join(base_dir, f)
-            analyses[f] = analyze_capture(path)
+def run_all(base_dir, use_cache=True, jobs=1):
+    """Analyze all capture files, grouped by test scenario."""
+    analyses = load_all(base_dir, discover_files(base_dir), jobs, use_cache)
 
     print("=" * 78)
     print(f"  OVERHEAD DOOR PROTOCOL ANALYSIS - {len(analyses)} capture files")
@@ -1356,6 +1619,42 @@ def run_all(base_dir):
     return analyses
 
 
+# ====================================================================
+#  VECTORIZED PATH CHECK
+# ====================================================================
+
+def check_vectorized(base_dir):
+    """Compare the numpy burst helpers against the scalar ones on every capture."""
+    if np is None:
+        print("numpy not installed - only the scalar path is in use")
+        return True
+    ok = True
+    for fname in TEST_FILES:
+        path = os.path.join(base_dir, fname)
+        if not os.path.exists(path):
+            continue
+        channels, _ = parse_capture(path)
+        n_bursts = n_syms = 0
+        same = True
+        for ch in (0, 1):
+            trans = channels[ch]
+            same &= short_pulses(trans) == _short_pulses_py(trans)
+            bursts = find_bursts(trans)
+            same &= bursts == (_find_bursts_py(trans) if len(trans) >= 2 else [])
+            for b in bursts:
+                pulses = _burst_pulses_py(b)
+                low_us = [d for s, d in pulses if s == 0]
+                same &= burst_pulses(b) == pulses
+                same &= decode_pwm(b) == ([round(d / PWM_UNIT_US) for d in low_us], low_us)
+                same &= burst_to_lh_pairs(b) == _burst_to_lh_pairs_py(b)
+                n_syms += len(low_us)
+            n_bursts += len(bursts)
+        ok &= same
+        print(f"  {'PASS' if same else 'FAIL'} {fname:<42s} {n_bursts:5d} bursts {n_syms:7d} symbols")
+    print(f"\n=== Vectorized check {'PASSED' if ok else 'FAILED'} ===")
+    return ok
+
+
 # ====================================================================
 #  MAIN
 # ====================================================================
@@ -1368,8 +1667,10 @@ def main():
 Examples:
   python analyze.py              Analyze all captures (default)
   python analyze.py --spec       Generate protocol specification
+  python analyze.py -j 8         Analyze all captures on 8 cores
   python analyze.py --file test01_idle_closed.txt
   python analyze.py --raw test01_idle_closed.txt
+  python analyze.py --check      Verify numpy path matches scalar path
         """,
     )
     parser.add_argument("--spec", action="store_true",
@@ -1380,16 +1681,25 @@ Examples:
                         help="Show raw symbols for a single file (no interpretation)")
     parser.add_argument("--dir", type=str, default=None,
                         help="Base directory for capture files (default: script directory)")
+    parser.add_argument("--jobs", "-j", type=int, default=1, metavar="N",
+                        help="Decode files in N worker processes (0 = all cores)")
+    parser.add_argument("--no-cache", action="store_true",
+                        help="Decode from scratch, ignoring .decode_cache/")
+    parser.add_argument("--check", action="store_true",
+                        help="Check vectorized burst decoding against the scalar path")
     args = parser.parse_args()
 
     base_dir = args.dir or os.path.dirname(os.path.abspath(__file__))
 
-    if args.raw:
+    if args.check:
+        sys.exit(0 if check_vectorized(base_dir) else 1)
+
+    elif args.raw:
         path = args.raw if os.path.isabs(args.raw) else os.path.join(base_dir, args.raw)
         if not os.path.exists(path):
             print(f"ERROR: File not found: {path}")
             sys.exit(1)
-        a = analyze_capture(path)
+        a = load_analysis(path, not args.no_cache)
         print_file_analysis(a, raw=True)
 
     elif args.file:
@@ -1397,23 +1707,17 @@ Examples:
         if not os.path.exists(path):
             print(f"ERROR: File not found: {path}")
             sys.exit(1)
-        a = analyze_capture(path)
+        a = load_analysis(path, not args.no_cache)
         print_file_analysis(a)
 
     elif args.spec:
         # Load all files first, then generate spec
-        analyses = {}
-        for fname in TEST_FILES:
-            path = os.path.join(base_dir, fname)
-            if os.path.exists(path):
-                analyses[fname] = analyze_capture(path)
-        for f in os.listdir(base_dir):
-            if f.endswith(".txt") and f not in analyses:
-                analyses[f] = analyze_capture(os.path.join(base_dir, f))
+        analyses = load_all(base_dir, discover_files(base_dir),
+                            args.jobs, not args.no_cache)
         print_spec(analyses)
 
     else:
-        run_all(base_dir)
+        run_all(base_dir, not args.no_cache, args.jobs)
 
 
 if __name__ == "__main__":
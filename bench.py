@@ -0,0 +1,399 @@
+#!/usr/bin/env python3
+"""bench.py — Decode pipeline benchmark and regression check.
+
+Times each stage of analyze.analyze_capture() separately over every
+capture in analyze.TEST_FILES:
+
+  parse       parse_capture() of the CSV (use_gcap=False)
+  xtalk       suppress_crosstalk()
+  bursts      find_bursts() + classify_burst()
+  pwm         decode_pwm() of each data burst
+  pairs       burst_to_lh_pairs()
+  classify    classify_ch0() / classify_ch1()
+  position    decode_type_b_state() + decode_type_b_position()
+
+and reports edges/s, messages/s and the peak Python heap of a full
+analyze_capture() (tracemalloc, in a separate untimed pass).  Stage
+times are the best of --repeat runs.
+
+Every file's decoded message list is diffed against bench_golden.json,
+one line per message (time, channel, name and a hash of symbols, pairs
+and state), so a change in decoder output shows up as the messages it
+touched.  After an intended change, rerun with --update-golden (and bump
+analyze.DECODER_VERSION so stale .decode_cache entries are dropped).
+
+--synth N also generates an N-edge capture from known message tables
+and position sweeps, times it the same way and checks that every
+generated message decodes back to its exact (L,H) pairs, name and
+position.  --paths checks the alternate decode paths against the golden
+snapshot too: numpy vs scalar, cold vs warm .decode_cache, .gcap vs CSV
+and load_all() with -j workers.
+
+Usage:
+    python bench.py                    # time all captures, check golden
+    python bench.py --synth 2000000    # + a synthetic 2M-edge capture
+    python bench.py --paths -j 8       # + alternate decode paths
+    python bench.py --update-golden    # rewrite bench_golden.json
+"""
+
+import os
+import sys
+import json
+import time
+import random
+import shutil
+import difflib
+import hashlib
+import argparse
+import tempfile
+import tracemalloc
+
+import analyze as A
+
+BASE_DIR = os.path.dirname(os.path.abspath(__file__))
+GOLDEN = os.path.join(BASE_DIR, "bench_golden.json")
+STAGES = ("parse", "xtalk", "bursts", "pwm", "pairs", "classify", "position")
+
+
+# ── Golden snapshot ─────────────────────────────────────────────────
+
+def message_lines(messages):
+    """One stable text line per decoded message."""
+    lines = []
+    for m in messages:
+        body = json.dumps([m.symbols, m.pairs, m.state], sort_keys=True,
+                          separators=(",", ":"), default=list)
+        h = hashlib.sha1(body.encode()).hexdigest()[:10]
+        lines.append(f"{m.time:.6f} {m.channel} {m.name} {h}")
+    return lines
+
+
+def load_golden():
+    if not os.path.exists(GOLDEN):
+        return None
+    with open(GOLDEN, encoding="utf-8") as f:
+        return json.load(f)
+
+
+def golden_diff(golden, name, lines, limit=12):
+    """[] if lines match the snapshot, else a short unified diff."""
+    if golden is None or name not in golden["files"]:
+        return ["(no golden entry)"]
+    want = golden["files"][name]
+    if want == lines:
+        return []
+    diff = list(difflib.unified_diff(want, lines, "golden", "decoded", n=0, lineterm=""))
+    return diff[2:2 + limit] + (["..."] if len(diff) > 2 + limit else [])
+
+
+# ── Stage timing ────────────────────────────────────────────────────
+
+def run_stages(path):
+    """One pass through the pipeline, mirroring analyze_capture().
+
+    Returns ({stage: seconds}, edges, messages).
+    """
+    t = dict.fromkeys(STAGES, 0.0)
+    clock = time.perf_counter
+
+    t0 = clock()
+    channels, _ = A.parse_capture(path, use_gcap=False)
+    t["parse"] = clock() - t0
+    edges = sum(len(v) for v in channels.values())
+
+    t0 = clock()
+    channels, _ = A.suppress_crosstalk(channels)
+    t["xtalk"] = clock() - t0
+
+    data = []
+    t0 = clock()
+    for ch in (0, 1):
+        if channels[ch]:
+            for b in A.find_bursts(channels[ch]):
+                if A.classify_burst(b) == "data":
+                    data.append((ch, b))
+    t["bursts"] = clock() - t0
+
+    t0 = clock()
+    syms = [A.decode_pwm(b)[0] for _, b in data]
+    t["pwm"] = clock() - t0
+
+    t0 = clock()
+    pairs = [A.burst_to_lh_pairs(b) for _, b in data]
+    t["pairs"] = clock() - t0
+
+    t0 = clock()
+    names = [(A.classify_ch0 if ch == 0 else A.classify_ch1)(s)[0]
+             for (ch, _), s in zip(data, syms)]
+    t["classify"] = clock() - t0
+
+    t0 = clock()
+    for name, s, p in zip(names, syms, pairs):
+        if name == "TYPE-B" and len(s) > A.TYPE_B_HEADER_LEN:
+            A.decode_type_b_state(s[A.TYPE_B_HEADER_LEN:])
+            if len(p) > A.TYPE_B_HEADER_LEN:
+                A.decode_type_b_position(p[A.TYPE_B_HEADER_LEN:])
+    t["position"] = clock() - t0
+    return t, edges, len(data)
+
+
+def bench_file(path, repeat):
+    best = None
+    for _ in range(repeat):
+        t, edges, msgs = run_stages(path)
+        best = t if best is None else {k: min(best[k], t[k]) for k in t}
+    tracemalloc.start()
+    a = A.analyze_capture(path)
+    peak = tracemalloc.get_traced_memory()[1]
+    tracemalloc.stop()
+    return best, edges, msgs, peak, a.messages
+
+
+def print_header():
+    print(f"  {'file':<36s} {'edges':>8s} {'msgs':>6s} "
+          + " ".join(f"{s:>8s}" for s in STAGES)
+          + f" {'total':>8s} {'Medge/s':>8s} {'kmsg/s':>7s} {'peakMB':>7s}  golden")
+
+
+def print_row(name, t, edges, msgs, peak, status):
+    total = sum(t.values())
+    print(f"  {name[:36]:<36s} {edges:8d} {msgs:6d} "
+          + " ".join(f"{1e3 * t[s]:8.1f}" for s in STAGES)
+          + f" {1e3 * total:8.1f} {edges / total / 1e6 if total else 0:8.2f} "
+          f"{msgs / total / 1e3 if total else 0:7.1f} {peak / 2**20:7.1f}  {status}")
+
+
+# ── Synthetic captures ──────────────────────────────────────────────
+
+def _runs(value, max_one=6, max_zero=9):
+    """value → [(ones, zeros), ...] LSB first, or None if it cannot be
+    sent: it must start with a 1 and every run must fit one pair."""
+    if value <= 0 or not value & 1:
+        return None
+    out = []
+    while value:
+        ones = (~value & (value + 1)).bit_length() - 1
+        value >>= ones
+        zeros = (value & -value).bit_length() - 1 if value else 1
+        value >>= zeros if value else 0
+        if ones > max_one or zeros > max_zero:
+            return None
+        out.append((ones, zeros))
+    return out
+
+
+def _type_b(rng, b, k=140):
+    """TYPE-B message pairs carrying position b (None if b will not encode)."""
+    ra, rb = _runs((b + k) & 0x1FF), _runs(b)
+    if ra is None or rb is None:
+        return None
+    door = rng.choice(list(A.DOOR_STATE_MAP))
+    sub = rng.choice(list(A.SUB_STATE_MAP))
+    pairs = [(s, 1) for s in A.TYPE_B_HEADER + door + sub + (1, 7)]
+    pairs += ra + [(7, 1), (9, 1)] + rb
+    return pairs
+
+
+def _fixed(table, min_len=3):
+    return [k for k in table if len(k) >= min_len and 0 not in k]
+
+
+def synth_capture(path, n_edges, seed=7030):
+    """Write an LA-format CSV of about n_edges edges.
+
+    Returns [(t_s, ch, name, pairs, position), ...], the ground truth.
+    CH0 commands and CH1 exact responses come from analyze's tables;
+    TYPE-B status messages sweep a position up and down across the
+    mod-512 wrap.  Symbols are exact multiples of PWM_UNIT_US, messages
+    are separated by more than BURST_GAP_S, and the last pair of every
+    message has H = 0, as the burst ends on its final rising edge.
+    """
+    rng = random.Random(seed)
+    unit = int(A.PWM_UNIT_US)
+    gap = int(A.BURST_GAP_S * 1e6) + 2000
+    ch0 = _fixed(A.CH0_COMMANDS)
+    ch1 = _fixed(A.CH1_RESPONSES)
+    truth = []
+    levels = [1, 1]
+    t = gap
+    edges = 0
+    pos, step = 301, 22
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("Time[s], Channel 0, Channel 1\n0.000000, 1, 1\n")
+        while edges < n_edges:
+            r = rng.random()
+            position = None
+            if r < 0.3:
+                ch, key = 0, rng.choice(ch0)
+                pairs, name = [(s, 1) for s in key], A.CH0_COMMANDS[key][0]
+            elif r < 0.45:
+                ch, key = 1, rng.choice(ch1)
+                pairs, name = [(s, 1) for s in key], A.CH1_RESPONSES[key][0]
+            else:
+                pairs = None
+                while pairs is None:
+                    pos = (pos + step) % 512
+                    if rng.random() < 0.02:
+                        step = -step
+                    pairs = _type_b(rng, pos)
+                ch, name, position = 1, "TYPE-B", pos
+            pairs[-1] = (pairs[-1][0], 0)
+            truth.append((t / 1e6, ch, name, pairs, position))
+            for l, h in pairs:
+                for level, units in ((0, l), (1, h)):
+                    if level == 1 and not units:
+                        break
+                    levels[ch] = level
+                    f.write(f"{t / 1e6:.6f}, {levels[0]}, {levels[1]}\n")
+                    t += units * unit
+                    edges += 1
+            levels[ch] = 1
+            f.write(f"{t / 1e6:.6f}, {levels[0]}, {levels[1]}\n")
+            edges += 1
+            t += gap + rng.randrange(5000)
+    return truth
+
+
+def check_synth(messages, truth):
+    """Count generated messages that did not decode back unchanged."""
+    bad = abs(len(messages) - len(truth))
+    for m, (t, ch, name, pairs, position) in zip(messages, truth):
+        ok = (abs(m.time - t) < 1e-6 and m.channel == ch and m.name == name
+              and m.pairs == pairs)
+        if position is not None:
+            ok &= m.state is not None and m.state["position"] == position
+        bad += not ok
+    return bad
+
+
+# ── Alternate decode paths ──────────────────────────────────────────
+
+def check_paths(names, golden, jobs):
+    """Each path's message lines must equal the golden snapshot."""
+    results = []
+    paths = [os.path.join(BASE_DIR, n) for n in names]
+
+    def run(label, fn):
+        t0 = time.perf_counter()
+        out = fn()
+        dt = time.perf_counter() - t0
+        bad = [n for n, msgs in zip(names, out) if golden_diff(golden, n, message_lines(msgs))]
+        results.append((label, dt, bad))
+
+    run("scalar+numpy (default)", lambda: [A.analyze_capture(p).messages for p in paths])
+    if A.np is not None:
+        np_saved = A.np
+        A.np = None
+        try:
+            run("scalar only (no numpy)", lambda: [A.analyze_capture(p).messages for p in paths])
+        finally:
+            A.np = np_saved
+
+    tmp = tempfile.mkdtemp(prefix="bench_")
+    cache_saved = A.CACHE_DIR
+    A.CACHE_DIR = os.path.join(tmp, "cache")
+    try:
+        run("decode cache, cold", lambda: [A.load_analysis(p).messages for p in paths])
+        run("decode cache, warm", lambda: [A.load_analysis(p).messages for p in paths])
+        import gcap
+        gpaths = []
+        for p in paths:
+            g = os.path.join(tmp, os.path.basename(p)[:-4] + ".gcap")
+            gcap.convert(p, g)
+            gpaths.append(g)
+        run(".gcap load", lambda: [A.analyze_capture(g).messages for g in gpaths])
+    finally:
+        A.CACHE_DIR = cache_saved
+        shutil.rmtree(tmp, ignore_errors=True)
+
+    run(f"load_all -j {jobs}", lambda: [a.messages for a in
+        A.load_all(BASE_DIR, names, jobs, use_cache=False).values()])
+
+    print(f"\n  {'path':<26s} {'time':>8s}  golden")
+    ok = True
+    for label, dt, bad in results:
+        print(f"  {label:<26s} {dt * 1e3:7.0f}ms  "
+              f"{'match' if not bad else 'DIFF: ' + ', '.join(bad[:4])}")
+        ok &= not bad
+    return ok
+
+
+# ── Main ────────────────────────────────────────────────────────────
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--repeat", type=int, default=3, help="timing runs per file (best of)")
+    ap.add_argument("--synth", type=int, metavar="EDGES", help="also bench a synthetic capture")
+    ap.add_argument("--keep", metavar="FILE", help="keep the synthetic capture here")
+    ap.add_argument("--paths", action="store_true", help="check alternate decode paths")
+    ap.add_argument("--jobs", "-j", type=int, default=0, help="workers for --paths (0 = all cores)")
+    ap.add_argument("--update-golden", action="store_true", help="rewrite bench_golden.json")
+    args = ap.parse_args()
+
+    names = [n for n in A.TEST_FILES if os.path.exists(os.path.join(BASE_DIR, n))]
+    golden = load_golden()
+    if golden and golden.get("decoder_version") != A.DECODER_VERSION:
+        print(f"bench_golden.json is for DECODER_VERSION {golden.get('decoder_version')}, "
+              f"analyze.py is {A.DECODER_VERSION} — expect differences\n")
+
+    print(f"Decode pipeline, {len(names)} captures, best of {args.repeat} "
+          f"(numpy {'on' if A.np is not None else 'off'}), stage times in ms\n")
+    print_header()
+    snap, ok = {}, True
+    tot = dict.fromkeys(STAGES, 0.0)
+    tot_e = tot_m = peak_max = 0
+    diffs = []
+    for n in names:
+        t, edges, msgs, peak, messages = bench_file(os.path.join(BASE_DIR, n), args.repeat)
+        lines = message_lines(messages)
+        snap[n] = lines
+        d = [] if args.update_golden else golden_diff(golden, n, lines)
+        if d:
+            diffs.append((n, d))
+            ok = False
+        print_row(n, t, edges, msgs, peak, "-" if args.update_golden else "DIFF" if d else "ok")
+        for s in STAGES:
+            tot[s] += t[s]
+        tot_e += edges
+        tot_m += msgs
+        peak_max = max(peak_max, peak)
+    print_row("TOTAL", tot, tot_e, tot_m, peak_max, "")
+
+    for n, d in diffs:
+        print(f"\n  {n}:")
+        for line in d:
+            print(f"    {line}")
+
+    if args.synth:
+        path = args.keep or os.path.join(tempfile.gettempdir(), f"bench_synth_{os.getpid()}.txt")
+        t0 = time.perf_counter()
+        truth = synth_capture(path, args.synth)
+        print(f"\n  synthetic: {len(truth)} messages written in "
+              f"{time.perf_counter() - t0:.1f} s → {path if args.keep else 'temp file'}\n")
+        try:
+            print_header()
+            t, edges, msgs, peak, messages = bench_file(path, 1)
+            bad = check_synth(messages, truth)
+            print_row("synthetic", t, edges, msgs, peak,
+                      "ok" if not bad else f"{bad} WRONG")
+            ok &= not bad
+        finally:
+            if not args.keep:
+                os.remove(path)
+
+    if args.paths:
+        ok &= check_paths(names, {"files": snap} if args.update_golden else golden,
+                          args.jobs)
+
+    if args.update_golden:
+        with open(GOLDEN, "w", encoding="utf-8", newline="\n") as f:
+            json.dump({"decoder_version": A.DECODER_VERSION, "files": snap}, f, indent=0)
+            f.write("\n")
+        print(f"\nWrote {os.path.relpath(GOLDEN)}: {sum(map(len, snap.values()))} messages")
+    print(f"\n=== {'PASSED' if ok else 'FAILED'} ===")
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
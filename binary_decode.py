@@ -10,11 +10,11 @@ Counter increases during OPENING, decreases during CLOSING.
 """
 import sys, os
 sys.path.insert(0, os.path.dirname(__file__))
-from analyze import parse_capture, find_bursts, BURST_GAP_S
+from analyze import (parse_capture, suppress_crosstalk, find_bursts, BURST_GAP_S,
+                     CROSSTALK_THRESH)
 
 PWM_UNIT_US = 26.0
 HDR_L = [1, 7, 2, 1, 4, 6, 2, 9]
-CROSSTALK_THRESH = 10
 
 
 def burst_to_pairs(burst):
@@ -65,7 +65,7 @@ def pairs_to_binary(pairs):
 
 def extract_messages(filepath):
     """Extract Type B messages with full (L,H) pairs."""
-    channels, _ = parse_capture(filepath)
+    channels, _ = suppress_crosstalk(parse_capture(filepath)[0])
     ch1 = channels.get(1, [])
     if not ch1:
         return []
@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+"""cc_profile.py — Sampling profiler for the CC1110 receiver firmware.
+
+Drives the esp32_ccdebug PROF command (see profile() in
+esp32_ccdebug/main/main.c): the CC1110 runs, and every --period µs the
+ESP32 halts it, records PC plus a few SFR/XDATA bytes, and resumes it.
+Trigger the exchange you want to look at (e.g. a wall-button press for
+CMD-B-INIT / HANDSHAKE-E) while the sampling window is open.
+
+The PCs are then binned against the flash dump: exact PCs, and
+functions, where a function is the nearest LCALL / vector LJMP target
+at or below the PC.  Watched bytes are reported as value histograms and
+a change timeline.
+
+Usage:
+    python cc_profile.py COM5                          # 5 s @ 200 µs
+    python cc_profile.py COM5 --ms 10000 --period 100
+    python cc_profile.py COM5 --watch S:C6 --watch X:F0A0   # + bytes
+    python cc_profile.py COM5 --csv samples.csv        # save raw samples
+    python cc_profile.py --test                        # no hardware needed
+"""
+
+import os
+import sys
+import time
+import bisect
+import struct
+import argparse
+from collections import Counter
+
+import dump_collect as DC
+
+SRAM_BASE = 0xF000
+
+
+# ── Samples ─────────────────────────────────────────────────────────
+
+def parse_records(frames, rec):
+    """'P' frame payloads in arrival order → [(t_us, pc, (watch
+    bytes...)), ...], t_us summing each record's dt from the start.
+    (The frame addr field is a 16-bit record index and wraps, so the
+    order of arrival is what counts.)
+    """
+    samples = []
+    t = 0
+    for data in frames:
+        for off in range(0, len(data) - rec + 1, rec):
+            dt, pc = struct.unpack_from('<HH', data, off)
+            t += dt
+            samples.append((t, pc, tuple(data[off + 4:off + rec])))
+    return samples
+
+
+def parse_watches(text):
+    """'S80,XF0A0' from '; PROF BEGIN' → ['S:80', 'X:F0A0']."""
+    if not text:
+        return []
+    return [f"{w[0]}:{w[1:]}" for w in text.split(',')]
+
+
+# ── Flash image ─────────────────────────────────────────────────────
+
+def function_starts(flash):
+    """Sorted entry points: LCALL targets plus LJMP targets in the reset
+    and interrupt vectors (0x0000, 0x0003 + 8·n)."""
+    starts = set()
+    for i in range(len(flash) - 2):
+        if flash[i] == 0x12:                    # LCALL addr16
+            tgt = flash[i + 1] << 8 | flash[i + 2]
+            if tgt < len(flash):
+                starts.add(tgt)
+    for vec in [0] + list(range(0x03, 0x93, 8)):
+        if vec + 2 < len(flash) and flash[vec] == 0x02:     # LJMP addr16
+            tgt = flash[vec + 1] << 8 | flash[vec + 2]
+            if tgt < len(flash):
+                starts.add(tgt)
+    return sorted(starts)
+
+
+def function_of(pc, starts):
+    """Label for pc: 'sub_XXXX', 'sram' or 'unknown'."""
+    if pc >= SRAM_BASE:
+        return "sram"
+    i = bisect.bisect_right(starts, pc) - 1
+    if i < 0:
+        return "unknown"
+    return f"sub_{starts[i]:04X}"
+
+
+# ── Report ──────────────────────────────────────────────────────────
+
+def report(samples, watches, flash, top=20):
+    n = len(samples)
+    if not n:
+        print("No samples.")
+        return
+    span = samples[-1][0] - samples[0][0]
+    print(f"\n{n} samples over {span / 1e6:.2f} s "
+          f"(mean interval {span / max(n - 1, 1):.0f} µs)")
+
+    starts = function_starts(flash) if flash else []
+    pcs = Counter(pc for _, pc, _ in samples)
+
+    if starts:
+        funcs = Counter(function_of(pc, starts) for pc in pcs.elements())
+        print(f"\nBy function ({len(starts)} entry points in image):")
+        for name, k in funcs.most_common(top):
+            print(f"  {name:<12s} {k:6d}  {100 * k / n:5.1f}%  {'#' * round(40 * k / n)}")
+
+    print("\nHot PCs:")
+    for pc, k in pcs.most_common(top):
+        code = ""
+        if flash and pc + 3 <= len(flash):
+            code = ' '.join(f"{b:02X}" for b in flash[pc:pc + 3])
+        where = function_of(pc, starts) if starts else ""
+        print(f"  0x{pc:04X}  {k:6d}  {100 * k / n:5.1f}%  {code:<9s} {where}")
+
+    for i, w in enumerate(watches):
+        vals = Counter(s[2][i] for s in samples)
+        print(f"\nWatch {w}: {len(vals)} distinct value(s)")
+        for v, k in vals.most_common(8):
+            print(f"  0x{v:02X}  {k:6d}  {100 * k / n:5.1f}%")
+        changes = []
+        prev = None
+        for t, _, vs in samples:
+            if vs[i] != prev:
+                changes.append((t, vs[i]))
+                prev = vs[i]
+        print(f"  {len(changes) - 1} change(s):", ' '.join(
+            f"{t / 1000:.1f}ms→{v:02X}" for t, v in changes[1:13])
+            + (" ..." if len(changes) > 13 else ""))
+
+
+def write_csv(path, samples, watches):
+    with open(path, 'w') as f:
+        f.write(','.join(['t_us', 'pc'] + watches) + '\n')
+        for t, pc, vs in samples:
+            f.write(','.join([str(t), f"{pc:04X}"] + [f"{v:02X}" for v in vs]) + '\n')
+    print(f"Saved {len(samples)} samples → {path}")
+
+
+# ── Serial session ──────────────────────────────────────────────────
+
+def prof_command(ms, period, watches):
+    toks = [f"PROF {ms:04X} {period:04X}"]
+    for w in watches:
+        space, addr = w.split(':')
+        toks.append(space.upper() + addr.upper())
+    return ' '.join(toks)
+
+
+def run_session(ser, cmd):
+    """Wait for '; CMD?', send cmd, collect 'P' frames until PROF END.
+
+    Returns (frames, rec, watches, end_line) or None.
+    """
+    frames, rec, watches, bad = [], 0, [], 0
+    sent = False
+    while True:
+        first = ser.read(1)
+        if not first:
+            continue
+        if first == b'\xA5' and sent:
+            f = DC.read_frame(ser, first)
+            if f is None:
+                print("  Lost frame sync")
+                continue
+            kind, _, data, ok = f
+            if kind == 'P' and ok:
+                frames.append(data)
+            else:
+                bad += 1
+            continue
+        line = (first + ser.readline()).decode('utf-8', errors='replace').strip()
+        if not line:
+            continue
+        if line.startswith('; CMD?') and not sent:
+            if 'PROF' not in line:
+                print("Firmware has no PROF command — rebuild esp32_ccdebug.")
+                return None
+            print(f"  → {cmd}")
+            ser.write((cmd + "\n").encode())
+            ser.flush()
+            sent = True
+        elif line.startswith('; PROF BEGIN'):
+            fields = dict(f.split('=', 1) for f in line.split()[3:])
+            rec = int(fields['rec'])
+            watches = parse_watches(fields.get('watches', ''))
+            print(f"  Sampling... ({line[2:]})")
+        elif line.startswith('; PROF ERR'):
+            print(f"  {line}")
+            return None
+        elif line.startswith('; PROF END'):
+            if bad:
+                print(f"  {bad} bad frame(s) dropped")
+            ser.write(b"DONE\n")
+            ser.flush()
+            return frames, rec, watches, line
+        else:
+            print(f"  {line}")
+
+
+# ── Self-test ───────────────────────────────────────────────────────
+
+def self_test():
+    print("=== cc_profile.py self-test ===\n")
+    flash = bytearray(b'\xFF' * 0x400)
+    flash[0:3] = b'\x02\x01\x00'            # reset → 0x0100
+    flash[0x100:0x103] = b'\x12\x02\x00'    # LCALL 0x0200
+    flash[0x110:0x113] = b'\x12\x03\x00'    # LCALL 0x0300
+    starts = function_starts(bytes(flash))
+    ok = starts == [0x100, 0x200, 0x300]
+    print(f"1. function_starts: {[hex(s) for s in starts]}  {'PASS' if ok else 'FAIL'}")
+
+    labels = [function_of(pc, starts) for pc in (0x50, 0x105, 0x2FF, 0x301, 0xF010)]
+    ok2 = labels == ["unknown", "sub_0100", "sub_0200", "sub_0300", "sram"]
+    print(f"2. function_of: {labels}  {'PASS' if ok2 else 'FAIL'}")
+
+    rec = 5
+    payload = b''.join(struct.pack('<HHB', 100, pc, v)
+                       for pc, v in [(0x200, 1), (0x201, 1), (0x300, 2)])
+    samples = parse_records([payload[:10], payload[10:]], rec)
+    ok3 = samples == [(100, 0x200, (1,)), (200, 0x201, (1,)), (300, 0x300, (2,))]
+    print(f"3. parse_records: {len(samples)} samples  {'PASS' if ok3 else 'FAIL'}")
+
+    cmd = prof_command(5000, 200, ['S:c6', 'X:F0A0'])
+    ok4 = cmd == "PROF 1388 00C8 SC6 XF0A0" and parse_watches("SC6,XF0A0") == ['S:C6', 'X:F0A0']
+    print(f"4. command: {cmd!r}  {'PASS' if ok4 else 'FAIL'}")
+
+    report(samples, ['S:C6'], bytes(flash), top=3)
+    ok = ok and ok2 and ok3 and ok4
+    print(f"\n=== Self-test {'PASSED' if ok else 'FAILED'} ===")
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port", nargs="?")
+    ap.add_argument("--ms", type=int, default=5000, help="sampling window (ms)")
+    ap.add_argument("--period", type=int, default=200, help="mean sample interval (µs)")
+    ap.add_argument("--watch", action="append", default=[],
+                    help="S:aa (SFR) or X:aaaa (XDATA) byte to record, up to 4")
+    ap.add_argument("--flash", default="cc1110_flash.bin", help="flash dump for PC binning")
+    ap.add_argument("--csv", help="write raw samples here")
+    ap.add_argument("--top", type=int, default=20)
+    ap.add_argument("--test", action="store_true", help="self-test, no hardware")
+    args = ap.parse_args()
+
+    if args.test:
+        sys.exit(0 if self_test() else 1)
+    if not args.port:
+        ap.error("port is required")
+    if DC.serial is None:
+        print("pyserial is required: pip install pyserial")
+        sys.exit(1)
+    if not (0 < args.ms <= 0xFFFF and 0 < args.period <= 0xFFFF):
+        ap.error("--ms and --period must be 1..65535")
+
+    flash = None
+    if os.path.exists(args.flash):
+        with open(args.flash, 'rb') as f:
+            flash = f.read()
+    else:
+        print(f"No {args.flash} — PCs will not be binned by function")
+
+    ser = DC.open_serial(args.port)
+    print(f"Listening on {args.port}; reset the ESP32 if no '; CMD?' appears")
+    t0 = time.time()
+    try:
+        got = run_session(ser, prof_command(args.ms, args.period, args.watch))
+    except KeyboardInterrupt:
+        got = None
+    finally:
+        ser.close()
+    if not got:
+        sys.exit(1)
+
+    frames, rec, watches, end = got
+    samples = parse_records(frames, rec)
+    print(f"  {end[2:]}  ({time.time() - t0:.1f} s session)")
+    report(samples, watches, flash, args.top)
+    if args.csv:
+        write_csv(args.csv, samples, watches)
+
+
+if __name__ == "__main__":
+    main()
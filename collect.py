@@ -4,79 +4,674 @@
 Reads JSON lines from the ESP32 over USB serial and appends them to
 captures.jsonl.  Run this instead of `idf.py monitor` to save data.
 
+Firmware built with MONITOR_MODE=1 streams one record per decoded
+message plus periodic status records; those go to monitor.jsonl so
+captures.jsonl keeps holding only boot-cycle handshakes.  With
+POS_TRACK the firmware also decodes every TYPE-B status message into a
+{"pos": ...} record (door, sub-state, light, unwrapped position and the
+data_A/data_B check); those go to monitor.jsonl as well and the console
+shows each change of door state.
+
+After every cycle record (and with every status record in monitor mode)
+the firmware sends a {"stats": ...} health record: edges dropped on a
+full ring, messages or pairs cut off at MAX_MSGS / MAX_PAIRS, ring
+high-water mark, glitches, crosstalk pulses filtered out, peak edges
+per ms, decode time and the ISR run-time histogram.  Those go to
+monitor.jsonl; the console flags a record that shows the rig itself
+losing data, so a MISS can be put down to the rig rather than the
+receiver.
+
+Firmware built with OUTPUT_BINARY=1 sends CRC-framed binary records
+instead (see "Binary framing" in esp32_capture/main/main.c).  They are
+decoded back into the same JSON records, so the .jsonl files look the
+same either way.  Firmware built with OUTPUT_UDP=1 sends the same frames
+over Wi-Fi, batched into datagrams that each open with a FRAME_CLOCK;
+those are received with collect_multi.py --udp.
+
+Firmware built with OUTPUT_RAW_EDGES=1 also streams every captured
+edge.  With --raw FILE those are written as a logic-analyzer CSV
+(`Time[s], Channel 0, Channel 1`) that analyze.parse_capture and the
+other analysis scripts read like an LA1010 export; a FILE ending in
+.gcap is written in the binary format from gcap.py instead.  Pass
+--channels N to match a firmware built with NUM_CH > 2; the extra
+columns follow Channel 1, so the analysis scripts still see CH0/CH1.
+
 Usage:
     python collect.py COM5          # Windows — use your actual COM port
     python collect.py /dev/ttyACM0  # Linux
+    python collect.py COM5 --raw rig_capture.txt   # also save raw edges
+    python collect.py COM5 --raw rig_capture.gcap  # ... as binary .gcap
+    python collect.py COM5 --raw la.txt --channels 4   # NUM_CH=4 firmware
+    python collect.py --test        # framing self-test (no hardware needed)
 """
 
+import os
 import sys
 import json
-import serial
+import time
+import struct
+import binascii
+
+# ── Binary framing (mirror of esp32_capture/main/main.c) ─────────────
+
+SYNC = b"\xa5\x5a"
+FRAME_CYCLE = 0x01
+FRAME_MSG = 0x02
+FRAME_STATUS = 0x03
+FRAME_EDGES = 0x04
+FRAME_POS = 0x05
+FRAME_STATS = 0x06
+FRAME_CLOCK = 0x07                          # opens every OUTPUT_UDP datagram
+FRAME_TX = 0x10                             # host → device, replay.py
+FRAME_MAX = 1024
+PAIR_ESC = 0xFF
+
+CYCLE_HDR = struct.Struct("<HHHHHIHIB")     # cycle ms lat off win edges msgs overflow ok
+MSG_HDR = struct.Struct("<IB")              # t ch
+STATUS_HDR = struct.Struct("<IIIIIHHI")     # uptime edges msgs overflow dropped ring seq stream_drop
+EDGES_HDR = struct.Struct("<III")           # t0 seq overflow
+POS_REC = struct.Struct("<IIBBBBB5sIIi")    # t seq flags door sub light np p[5] a b pos
+STATS_HDR = struct.Struct("<IIIIHHHIIIIII8H")  # seq ms edges dropped eps_max ring_hwm
+                                            # ring_size msg_full pair_full glitch
+                                            # xtalk proc_us proc_max_us isr_us[8]
+TX_HDR = struct.Struct("<IB")               # t ch
+CLOCK_HDR = struct.Struct("<IIQQ")          # seq rig up_us unix_us
+
+POS_A, POS_B, POS_VALID = 0x01, 0x02, 0x04
+POS_LEARN, POS_CHECK_OK, POS_CHECK_BAD = 0x08, 0x10, 0x20
+POS_NONE = 0xFF
+_pos_names = None
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as computed by the firmware."""
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def encode_frame(ftype, payload):
+    body = bytes([ftype]) + struct.pack("<H", len(payload)) + payload
+    return SYNC + body + struct.pack("<H", crc16(body))
+
+
+def pack_pairs(pairs):
+    """[(L,H), ...] → u8 count + nibble-packed bytes (escape for ≥15)."""
+    out = bytearray([len(pairs)])
+    for l, h in pairs:
+        if l < 15 and h < 15:
+            out.append(l << 4 | h)
+        else:
+            out += bytes([PAIR_ESC, l, h])
+    return bytes(out)
+
+
+def unpack_pairs(buf, pos):
+    """Inverse of pack_pairs; returns (pairs, new_pos)."""
+    n = buf[pos]
+    pos += 1
+    pairs = []
+    for _ in range(n):
+        b = buf[pos]
+        if b == PAIR_ESC:
+            pairs.append([buf[pos + 1], buf[pos + 2]])
+            pos += 3
+        else:
+            pairs.append([b >> 4, b & 0x0F])
+            pos += 1
+    return pairs, pos
+
+
+def unpack_edges(payload):
+    """FRAME_EDGES payload → (seq, overflow, [(t_us, ch, level), ...]).
+
+    t_us is the firmware's 32-bit µs clock with deltas added, so it can
+    run past 2**32 within a frame; RawCsvWriter unwraps across frames.
+    """
+    t, seq, ovf = EDGES_HDR.unpack_from(payload)
+    edges = []
+    v = shift = 0
+    for b in payload[EDGES_HDR.size:]:
+        v |= (b & 0x7F) << shift
+        shift += 7
+        if b & 0x80:
+            continue
+        t += v >> 4
+        edges.append((t, (v >> 1) & 0x07, v & 1))
+        v = shift = 0
+    return seq, ovf, edges
+
+
+class RawCsvWriter:
+    """Write streamed edges in the LA1010 CSV layout parse_capture reads.
+
+    One row per edge with the level of every channel after it, preceded
+    by a t=0 row of idle-HIGH levels.  Time starts RAW_LEAD_S before the
+    first edge so that row is distinct.  The firmware clock is 32 bits
+    (wraps every ~71 min); each frame's t0 is unwrapped against the last
+    edge written, so the file's time axis is continuous.
+    """
+
+    RAW_LEAD_S = 0.010
+
+    def __init__(self, f, n_ch=2):
+        self.f = f
+        self.levels = [1] * n_ch
+        self.origin = None      # absolute µs at t=0
+        self.last = None        # (raw u32 ts, absolute µs) of last edge
+        self.next_seq = None
+        self.lost = 0
+        self.edges = 0
+        self._start(n_ch)
+
+    def _start(self, n_ch):
+        self.f.write("Time[s], " + ", ".join(f"Channel {c}" for c in range(n_ch)) + "\n")
+
+    def _row(self, t_us):
+        vals = ", ".join(str(v) for v in self.levels)
+        self.f.write(f"{(t_us - self.origin) / 1e6:.6f}, {vals}\n")
+
+    def close(self):
+        self.f.close()
+
+    def add(self, seq, edges):
+        if not edges:
+            return
+        if self.next_seq is not None and seq != self.next_seq:
+            self.lost += (seq - self.next_seq) & 0xFFFFFFFF
+        self.next_seq = (seq + len(edges)) & 0xFFFFFFFF
+
+        base = edges[0][0]
+        if self.last is None:
+            abs0 = base
+            self.origin = base - int(self.RAW_LEAD_S * 1e6)
+            self._row(self.origin)
+        else:
+            raw, abs_last = self.last
+            abs0 = abs_last + ((base - raw) & 0xFFFFFFFF)
+
+        for t, ch, lv in edges:
+            if ch >= len(self.levels):
+                continue
+            self.levels[ch] = lv
+            self._row(abs0 + (t - base))
+        self.last = (edges[-1][0] & 0xFFFFFFFF, abs0 + (edges[-1][0] - base))
+        self.edges += len(edges)
+
+
+class RawGcapWriter(RawCsvWriter):
+    """Same edge stream as RawCsvWriter, saved as .gcap (see gcap.py).
+
+    Ticks are the CSV's µs rows, so loading the file gives exactly what
+    parse_capture would read from the equivalent CSV.  The file is
+    written on close().
+    """
+
+    def __init__(self, path, n_ch=2):
+        import gcap
+        self.g = gcap.GcapWriter(path, n_ch, decimals=6)
+        super().__init__(None, n_ch)
+
+    def _start(self, n_ch):
+        pass
+
+    def _row(self, t_us):
+        for ch, lv in enumerate(self.levels):
+            self.g.add(ch, t_us - self.origin, lv)
+
+    def close(self):
+        self.g.close()
+
+
+def pos_state_names():
+    """Door / sub-state / light names in msg_table.h index order."""
+    global _pos_names
+    if _pos_names is None:
+        import analyze as A
+        _pos_names = (list(A.DOOR_STATE_MAP.values()), list(A.SUB_STATE_MAP.values()),
+                      list(A.LIGHT_PATTERNS.values()))
+    return _pos_names
+
+
+def unpack_pos(payload):
+    """FRAME_POS payload → the firmware's JSON {"pos": ...} record."""
+    t, seq, fl, door, sub, light, np_, p, a, b, pos = POS_REC.unpack_from(payload)
+    doors, subs, lights = pos_state_names()
+    rec = {"pos": seq, "t": t}
+    if door != POS_NONE:
+        rec["door"] = doors[door]
+    else:
+        rec["door"] = f"UNKNOWN({p[0]},{p[1]})" if np_ >= 2 else None
+    if sub != POS_NONE:
+        rec["sub"] = subs[sub]
+    else:
+        rec["sub"] = f"({p[2]},{p[3]},{p[4]})" if np_ >= 5 else None
+    rec["light"] = lights[light] if light != POS_NONE else None
+    if fl & POS_A:
+        rec["a"] = a
+    if fl & POS_B:
+        rec["b"] = b
+    rec["position"] = pos if fl & POS_VALID else None
+    if fl & (POS_LEARN | POS_CHECK_OK | POS_CHECK_BAD):
+        rec["check"] = ("ok" if fl & POS_CHECK_OK else
+                        "bad" if fl & POS_CHECK_BAD else "learn")
+    return rec
+
+
+def stats_loss(rec):
+    """What a stats record says the rig lost, or '' if nothing."""
+    parts = [f"{rec[k]} {label}" for k, label in (
+        ("dropped", "edges dropped"), ("msg_full", "msgs over MAX_MSGS"),
+        ("pair_full", "pairs over MAX_PAIRS")) if rec.get(k)]
+    hwm, size = rec.get("ring_hwm", 0), rec.get("ring_size") or 1
+    if hwm * 4 >= size * 3:
+        parts.append(f"ring {hwm}/{size}")
+    return ", ".join(parts)
+
+
+def unpack_clock(payload):
+    """FRAME_CLOCK payload → (seq, rig, up_us, unix_us); unix_us 0 = no SNTP yet."""
+    return CLOCK_HDR.unpack_from(payload)
+
+
+def frame_to_record(ftype, payload):
+    """Decode a frame into the dict the JSON firmware would have printed."""
+    if ftype == FRAME_CYCLE:
+        cy, ms, lat, off, win, edges, msgs, ovf, ok = CYCLE_HDR.unpack_from(payload)
+        rec = {"cycle": cy, "ms": ms, "edges": edges, "msgs": msgs}
+        if ovf:
+            rec["overflow"] = ovf
+        pos = CYCLE_HDR.size
+        for key in ("challenge", "response"):
+            pairs, pos = unpack_pairs(payload, pos)
+            if pairs:
+                rec[key] = pairs
+        if ok:
+            rec["lat"] = lat
+        rec.update(off=off, win=win, ok=bool(ok))
+        return rec
+    if ftype == FRAME_MSG:
+        t, ch = MSG_HDR.unpack_from(payload)
+        pairs, _ = unpack_pairs(payload, MSG_HDR.size)
+        return {"t": t, "ch": ch, "pairs": pairs}
+    if ftype == FRAME_STATUS:
+        up, edges, msgs, ovf, drop, ring, seq, sdrop = STATUS_HDR.unpack_from(payload)
+        rec = {"mon": seq, "uptime_ms": up, "edges": edges, "msgs": msgs,
+               "overflow": ovf, "dropped": drop, "ring": ring}
+        if sdrop:
+            rec["stream_dropped"] = sdrop
+        return rec
+    if ftype == FRAME_POS:
+        return unpack_pos(payload)
+    if ftype == FRAME_STATS:
+        v = STATS_HDR.unpack_from(payload)
+        keys = ("stats", "ms", "edges", "dropped", "eps_max", "ring_hwm", "ring_size",
+                "msg_full", "pair_full", "glitch", "xtalk", "proc_us", "proc_max_us")
+        rec = dict(zip(keys, v))
+        rec["isr_us"] = list(v[len(keys):])
+        return rec
+    if ftype == FRAME_EDGES:
+        seq, ovf, edges = unpack_edges(payload)
+        return {"raw_edges": edges, "seq": seq, "overflow": ovf}
+    return None
+
+
+class FrameDecoder:
+    """Split a serial byte stream into text lines and CRC-checked frames.
+
+    feed() yields ("text", str) for log/JSON lines and ("frame", type,
+    payload) for binary records.  A sync match whose length or CRC is
+    wrong is skipped one byte at a time, so a corrupted frame costs only
+    itself and the stream resynchronises on the next good one.
+    """
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad = 0
+
+    def feed(self, data):
+        buf = self.buf
+        buf += data
+        while buf:
+            s = buf.find(SYNC)
+            if s != 0:
+                nl = buf.find(b"\n", 0, s if s > 0 else len(buf))
+                if nl >= 0:
+                    end, skip = nl, nl + 1
+                elif s > 0:
+                    end = skip = s
+                elif len(buf) > 4 * FRAME_MAX:
+                    end = skip = len(buf) - 1   # runaway junk, keep a byte
+                else:
+                    break                        # partial line, wait
+                text = buf[:end].decode("utf-8", errors="replace").strip()
+                del buf[:skip]
+                if text:
+                    yield ("text", text)
+                continue
+
+            if len(buf) < 5:
+                break
+            n = buf[3] | buf[4] << 8
+            if n > FRAME_MAX:
+                del buf[:1]
+                self.bad += 1
+                continue
+            if len(buf) < 7 + n:
+                break
+            body = bytes(buf[2:5 + n])
+            crc = buf[5 + n] | buf[6 + n] << 8
+            if crc16(body) != crc:
+                del buf[:1]
+                self.bad += 1
+                continue
+            del buf[:7 + n]
+            yield ("frame", body[0], body[3:])
+
+
+# ── Record handling ──────────────────────────────────────────────────
+
+class Collector:
+    """Route decoded records to captures / monitor files and the console.
+
+    rig tags every saved record with {"rig": id} and prefixes console
+    lines, for collect_multi.py.  target=None never reports done.
+    """
+
+    def __init__(self, f, mf, raw=None, rig=None, target=100):
+        self.f, self.mf, self.raw = f, mf, raw
+        self.rig, self.target = rig, target
+        self.tag = f"[{rig}] " if rig is not None else ""
+        self.good = 0
+        self.total = 0
+        self.mon_msgs = 0
+        self.last_door = None
+        self.last_cycle = None
+        self.t_start = time.monotonic()
+
+    def handle(self, data, line=None):
+        """Route one record; returns True once the target is reached."""
+        if self.rig is not None:
+            data["rig"] = self.rig
+            line = None
+        if line is None:
+            line = json.dumps(data, separators=(",", ":"))
+
+        if "raw_edges" in data:
+            if self.raw:
+                self.raw.add(data["seq"], data["raw_edges"])
+            return False
+
+        if "stats" in data:
+            self.mf.write(line + "\n")
+            self.mf.flush()
+            loss = stats_loss(data)
+            if loss:
+                print(f"  {self.tag}[stats {data['stats']}] rig: {loss}")
+            return False
+
+        if "pos" in data:
+            self.mf.write(line + "\n")
+            door = (data.get("door"), data.get("light"))
+            if door != self.last_door:
+                self.last_door = door
+                p, light, check = data.get("position"), data.get("light"), data.get("check")
+                print(f"  {self.tag}[pos {data['pos']:5d}] {data.get('door')}"
+                      f"{f', light {light}' if light else ''}"
+                      f"{f', position {p}' if p is not None else ''}"
+                      f"{f' (check {check})' if check else ''}")
+            return False
+
+        if "pairs" in data or "mon" in data:
+            self.mf.write(line + "\n")
+            if "pairs" in data:
+                self.mon_msgs += 1
+                return False
+            self.mf.flush()
+            ovf = data.get("overflow", 0)
+            print(f"  {self.tag}[mon {data['mon']:4d}] "
+                  f"{data.get('uptime_ms', 0) / 1000:8.1f}s  "
+                  f"{data.get('edges', 0)} edges, "
+                  f"{data.get('msgs', 0)} msgs "
+                  f"(+{self.mon_msgs} logged), ring {data.get('ring', 0)}"
+                  f"{f', OVERFLOW {ovf}' if ovf else ''}")
+            self.mon_msgs = 0
+            return False
+
+        self.f.write(line + "\n")
+        self.f.flush()
+        self.total += 1
+
+        ok = data.get("ok", False)
+        cy = data.get("cycle", "?")
+        self.last_cycle = cy
+        edges = data.get("edges", 0)
+        msgs = data.get("msgs", 0)
+        ovf = data.get("overflow", 0)
+        ovf_s = f", OVERFLOW {ovf}" if ovf else ""
+        ms_s = f"{data['ms'] / 1000:.1f}s, " if "ms" in data else ""
+
+        if ok:
+            self.good += 1
+            c_n = len(data.get("challenge", []))
+            r_n = len(data.get("response", []))
+            rate = self.good * 60 / max(time.monotonic() - self.t_start, 1e-3)
+            lat_s = (f", lat {data['lat']} ms, off {data.get('off', '?')} ms"
+                     if "lat" in data else "")
+            print(f"  {self.tag}[{self.good:3d}/{self.target or '-'}] Cycle {cy}: OK  "
+                  f"({ms_s}{edges} edges, {msgs} msgs, "
+                  f"challenge={c_n} pairs, response={r_n} pairs{ovf_s}"
+                  f"{lat_s})  {rate:.1f} pairs/min")
+        else:
+            print(f"  {self.tag}[  —  ] Cycle {cy}: MISS  "
+                  f"({ms_s}{edges} edges, {msgs} msgs{ovf_s})")
+
+        return self.target is not None and self.good >= self.target
+
+    def handle_text(self, line):
+        if not line.startswith("{"):
+            # ESP_LOGI / debug line
+            print(f"  {self.tag}{line}")
+            return False
+        try:
+            data = json.loads(line)
+        except json.JSONDecodeError:
+            print(f"  {self.tag}[bad json] {line[:80]}")
+            return False
+        return self.handle(data, line)
+
+
+def self_test():
+    """Round-trip frames through FrameDecoder with noise and corruption."""
+    print("=== collect.py framing self-test ===\n")
+    chal = [(1, 1), (7, 1), (3, 2), (4, 1), (2, 6), (3, 15), (4, 0)]
+    resp = [(1, 1), (7, 1), (4, 1), (12, 14), (2, 0)]
+    cyc = CYCLE_HDR.pack(7, 2140, 1890, 300, 12000, 5123, 31, 0, 1)
+    cyc += pack_pairs(chal) + pack_pairs(resp)
+    edges = [(1000, 0, 0), (1026, 0, 1), (1078, 1, 0), (71078, 1, 1)]
+    ep = bytearray(EDGES_HDR.pack(edges[0][0], 40, 0))
+    prev = edges[0][0]
+    for t, ch, lv in edges:
+        v = (t - prev) << 4 | ch << 1 | lv
+        while v >= 0x80:
+            ep.append(v & 0x7F | 0x80)
+            v >>= 7
+        ep.append(v)
+        prev = t
+
+    good = encode_frame(FRAME_CYCLE, cyc)
+    bad = bytearray(good)
+    bad[10] ^= 0x40
+    stream = (b"I (123) capture: boot\r\n" + bytes(bad) + b"\xa5" + good +
+              b"I (456) capture: log line\r\n" + encode_frame(FRAME_EDGES, bytes(ep)))
+
+    dec = FrameDecoder()
+    events = []
+    for i in range(0, len(stream), 7):             # arbitrary chunking
+        events.extend(dec.feed(stream[i:i + 7]))
+
+    frames = [e for e in events if e[0] == "frame"]
+    texts = [e[1] for e in events if e[0] == "text"]
+    checks = [
+        ("two frames recovered", len(frames) == 2),
+        ("corrupted frame rejected", dec.bad > 0),
+        ("log lines kept", any("boot" in t for t in texts)
+                           and any("log line" in t for t in texts)),
+    ]
+    if len(frames) == 2:
+        rec = frame_to_record(frames[0][1], frames[0][2])
+        checks += [
+            ("cycle fields", rec["cycle"] == 7 and rec["lat"] == 1890
+                             and rec["ok"] is True),
+            ("challenge pairs", rec["challenge"] == [list(p) for p in chal]),
+            ("response pairs", rec["response"] == [list(p) for p in resp]),
+            ("raw edges", frame_to_record(frames[1][1], frames[1][2])
+                          ["raw_edges"] == edges),
+        ]
+
+    # Raw CSV export must parse back to the same transitions, across a
+    # 32-bit clock wrap and a lost frame
+    import io
+    from analyze import parse_capture
+    buf = io.StringIO()
+    w = RawCsvWriter(buf)
+    w.add(0, [(0xFFFFFF00, 0, 0), (0xFFFFFF1A, 0, 1)])
+    w.add(5, [(0x00000010, 1, 0), (0x0000002A, 1, 1)])
+    path = "_collect_selftest_raw.txt"
+    with open(path, "w") as f:
+        f.write(buf.getvalue())
+    try:
+        chans, cols = parse_capture(path)
+    finally:
+        os.remove(path)
+    t = [round(x, 6) for x, _ in chans[0]] + [round(x, 6) for x, _ in chans[1]]
+    checks += [
+        ("raw csv columns", cols == 3),
+        ("raw csv transitions", t == [0.0, 0.01, 0.010026, 0.0, 0.010272, 0.010298]),
+        ("raw lost edges", w.lost == 3),
+    ]
+
+    # .gcap export must load to exactly what the CSV parses to
+    gpath = "_collect_selftest_raw.gcap"
+    g = RawGcapWriter(gpath)
+    g.add(0, [(0xFFFFFF00, 0, 0), (0xFFFFFF1A, 0, 1)])
+    g.add(5, [(0x00000010, 1, 0), (0x0000002A, 1, 1)])
+    g.close()
+    try:
+        gchans = parse_capture(gpath)
+    finally:
+        os.remove(gpath)
+    checks.append(("raw gcap == csv", gchans == (chans, cols)))
+
+    # Position records: known states by index, unknown ones from the raw
+    # payload symbols, fields absent where the flags say so
+    pos = frame_to_record(FRAME_POS, POS_REC.pack(
+        5000, 3, POS_A | POS_B | POS_VALID | POS_CHECK_OK,
+        4, 0, POS_NONE, 5, bytes([1, 3, 3, 4, 4]), 1164, 263, 775))
+    unk = frame_to_record(FRAME_POS, POS_REC.pack(
+        6000, 4, 0, POS_NONE, POS_NONE, POS_NONE, 5, bytes([7, 7, 1, 2, 3]), 0, 0, 0))
+    checks += [
+        ("pos record", pos == {"pos": 3, "t": 5000, "door": "CLOSING", "sub": "ACTIVE",
+                               "light": None, "a": 1164, "b": 263, "position": 775,
+                               "check": "ok"}),
+        ("pos unknown state", unk["door"] == "UNKNOWN(7,7)" and unk["sub"] == "(1,2,3)"
+                              and unk["position"] is None and "check" not in unk),
+    ]
+    # Stats records: binary and JSON give the same dict; loss is flagged
+    isr = [5, 90, 20, 1, 0, 0, 0, 0]
+    st = frame_to_record(FRAME_STATS, STATS_HDR.pack(
+        12, 2100, 5123, 7, 9, 3100, 4096, 0, 2, 1, 4, 3400, 210, *isr))
+    clean = dict(st, dropped=0, pair_full=0, ring_hwm=40)
+    checks += [
+        ("stats record", st["stats"] == 12 and st["dropped"] == 7 and st["xtalk"] == 4
+                         and st["ring_size"] == 4096 and st["isr_us"] == isr),
+        ("stats loss", stats_loss(st) == "7 edges dropped, 2 pairs over MAX_PAIRS, "
+                                         "ring 3100/4096" and stats_loss(clean) == ""),
+    ]
+    json_len = len(json.dumps({"cycle": 7, "challenge": chal, "response": resp}))
+    print(f"  cycle record: {len(good)} bytes framed vs ~{json_len} as JSON\n")
+
+    ok = True
+    for name, passed in checks:
+        print(f"  {'PASS' if passed else 'FAIL'}: {name}")
+        ok &= passed
+    print(f"\n=== Self-test {'PASSED' if ok else 'FAILED'} ===")
+    return ok
+
 
 def main():
-    if len(sys.argv) < 2:
-        print("Usage: python collect.py <COM_PORT> [baud]")
+    if len(sys.argv) >= 2 and sys.argv[1] == "--test":
+        sys.exit(0 if self_test() else 1)
+
+    args = sys.argv[1:]
+    rawfile = None
+    if "--raw" in args:
+        i = args.index("--raw")
+        rawfile = args[i + 1] if i + 1 < len(args) else None
+        del args[i:i + 2]
+        if not rawfile:
+            print("--raw needs an output file name")
+            sys.exit(1)
+    n_ch = 2
+    if "--channels" in args:
+        i = args.index("--channels")
+        n_ch = int(args[i + 1]) if i + 1 < len(args) else 0
+        del args[i:i + 2]
+        if not 1 <= n_ch <= 8:
+            print("--channels must be 1..8 (firmware NUM_CH)")
+            sys.exit(1)
+
+    if len(args) < 1:
+        print("Usage: python collect.py <COM_PORT> [baud] [--raw out.txt|out.gcap] [--channels N]")
         print("  e.g. python collect.py COM5")
         sys.exit(1)
 
-    port = sys.argv[1]
-    baud = int(sys.argv[2]) if len(sys.argv) > 2 else 115200
+    import serial
+
+    port = args[0]
+    baud = int(args[1]) if len(args) > 1 else 115200
     outfile = "captures.jsonl"
+    monfile = "monitor.jsonl"
 
     ser = serial.Serial(port, baud, timeout=1)
     print(f"Listening on {port} — writing to {outfile}")
     print("Press Ctrl+C to stop\n")
 
-    good = 0
-    total = 0
+    dec = FrameDecoder()
 
-    with open(outfile, "a", encoding="utf-8") as f:
+    if not rawfile:
+        raw = None
+    elif rawfile.endswith(".gcap"):
+        raw = RawGcapWriter(rawfile, n_ch)
+    else:
+        raw = RawCsvWriter(open(rawfile, "w", encoding="utf-8"), n_ch)
+
+    with open(outfile, "a", encoding="utf-8") as f, \
+         open(monfile, "a", encoding="utf-8") as mf:
+        col = Collector(f, mf, raw)
         try:
-            while True:
-                raw = ser.readline()
-                if not raw:
-                    continue
-                line = raw.decode("utf-8", errors="replace").strip()
-                if not line:
+            done = False
+            while not done:
+                chunk = ser.read(ser.in_waiting or 1)
+                if not chunk:
                     continue
-
-                if line.startswith("{"):
-                    try:
-                        data = json.loads(line)
-                    except json.JSONDecodeError:
-                        print(f"  [bad json] {line[:80]}")
-                        continue
-
-                    f.write(line + "\n")
-                    f.flush()
-                    total += 1
-
-                    ok = data.get("ok", False)
-                    cy = data.get("cycle", "?")
-                    edges = data.get("edges", 0)
-                    msgs = data.get("msgs", 0)
-
-                    if ok:
-                        good += 1
-                        c_n = len(data.get("challenge", []))
-                        r_n = len(data.get("response", []))
-                        print(f"  [{good:3d}/100] Cycle {cy}: OK  "
-                              f"({edges} edges, {msgs} msgs, "
-                              f"challenge={c_n} pairs, response={r_n} pairs)")
+                for ev in dec.feed(chunk):
+                    if ev[0] == "text":
+                        done = col.handle_text(ev[1])
                     else:
-                        print(f"  [  —  ] Cycle {cy}: MISS  "
-                              f"({edges} edges, {msgs} msgs)")
-
-                    if good >= 100:
+                        rec = frame_to_record(ev[1], ev[2])
+                        done = rec is not None and col.handle(rec)
+                    if done:
                         print(f"\n=== 100 good captures collected! ===")
-                        print(f"Total cycles: {total}, saved to {outfile}")
+                        print(f"Total cycles: {col.total}, saved to {outfile}")
                         break
-                else:
-                    # ESP_LOGI / debug line
-                    print(f"  {line}")
 
         except KeyboardInterrupt:
-            print(f"\nStopped. {good} good captures in {total} cycles → {outfile}")
+            print(f"\nStopped. {col.good} good captures in {col.total} cycles → {outfile}")
+        if dec.bad:
+            print(f"({dec.bad} corrupt frame bytes skipped)")
+        if raw:
+            raw.close()
+            print(f"Raw edges: {raw.edges} → {rawfile}"
+                  f"{f' ({raw.lost} lost on the link)' if raw.lost else ''}")
 
     ser.close()
 
@@ -0,0 +1,537 @@
+#!/usr/bin/env python3
+"""collect_multi.py — Collect handshakes from several capture rigs at once.
+
+Each rig is an esp32_capture board on its own Odyssey receiver.  All
+ports are serviced from one loop (selectors where the OS can poll a
+serial handle, in_waiting polling on Windows), records are decoded with
+collect.py's FrameDecoder/Collector, tagged {"rig": ID} and written to
+one captures.jsonl / monitor.jsonl through a buffered appender that
+fsyncs every few seconds.
+
+A rig that resets drops off the bus for a moment; the loop keeps serving
+the others while a background thread waits for the port to come back
+(dump_collect.wait_for_port) and reattaches it with a fresh decoder.
+
+With --udp PORT the same loop also listens for rigs built with
+OUTPUT_UDP=1, any number of them on one port.  Each datagram opens with
+a FRAME_CLOCK naming its rig (six hex digits of the Wi-Fi MAC), so rigs
+appear as they first send; a seq gap counts lost datagrams and a clock
+that goes backwards is a rig restart.  Once a rig has SNTP time every
+record it sends gets "utc_us": its device timestamp "t" mapped through
+the datagram's clock, or the datagram time for records without one, so
+streams from different garages can be merged on one time axis.
+
+Usage:
+    python collect_multi.py COM5 COM6 COM7           # rigs A, B, C
+    python collect_multi.py A=COM5 B=/dev/ttyACM1    # explicit rig IDs
+    python collect_multi.py COM5 COM6 --target 500   # stop at 500 good pairs
+    python collect_multi.py --udp 7030               # Wi-Fi rigs (UDP_PORT)
+    python collect_multi.py COM5 --udp 7030          # both at once
+    python collect_multi.py --test                   # no hardware needed
+"""
+
+import os
+import sys
+import time
+import argparse
+import socket
+import selectors
+import threading
+
+import collect as C
+import dump_collect as DC
+
+FSYNC_S = 5.0               # appender write-out + fsync period
+STATS_S = 30.0              # aggregate status line period
+POLL_S = 0.02               # in_waiting poll period for non-selectable ports
+UDP_RCVBUF = 1 << 20        # socket receive buffer, rides out a slow fsync
+
+
+class Appender:
+    """File-like sink shared by all rigs.
+
+    write() only buffers; flush() (which Collector calls per record)
+    writes out and fsyncs at most every fsync_s, so N rigs cost one
+    fsync per period instead of one per record.
+    """
+
+    def __init__(self, path, fsync_s=FSYNC_S):
+        self.f = open(path, "a", encoding="utf-8")
+        self.fsync_s = fsync_s
+        self.buf = []
+        self.t_sync = time.monotonic()
+
+    def write(self, s):
+        self.buf.append(s)
+
+    def flush(self):
+        if time.monotonic() - self.t_sync >= self.fsync_s:
+            self.sync()
+
+    def sync(self):
+        if self.buf:
+            self.f.write("".join(self.buf))
+            self.buf.clear()
+            self.f.flush()
+            os.fsync(self.f.fileno())
+        self.t_sync = time.monotonic()
+
+    def close(self):
+        self.sync()
+        self.f.close()
+
+
+class Rig:
+    def __init__(self, rig_id, port, out, mon):
+        self.id, self.port = rig_id, port
+        self.col = C.Collector(out, mon, rig=rig_id, target=None)
+        self.ser = None
+        self.dec = None
+        self.pending = None         # serial handed over by the reconnect thread
+        self.resets = 0
+        self.fd_ok = False
+
+    def attach(self, ser):
+        self.ser, self.pending = ser, None
+        self.dec = C.FrameDecoder()
+        ser.timeout = 0
+        try:
+            ser.fileno()
+            self.fd_ok = os.name != "nt"
+        except (AttributeError, OSError, ValueError):
+            self.fd_ok = False
+
+    def waiting(self):
+        return self.ser.in_waiting
+
+    def service(self):
+        """Read what is there and route it; raises OSError on disconnect."""
+        chunk = self.ser.read(self.ser.in_waiting or 1)
+        for ev in self.dec.feed(chunk):
+            if ev[0] == "text":
+                self.col.handle_text(ev[1])
+            else:
+                rec = C.frame_to_record(ev[1], ev[2])
+                if rec is not None:
+                    self.col.handle(rec)
+
+
+def utc_us(t, up_us, unix_us):
+    """Device time t (32-bit µs) → UNIX µs, via one FRAME_CLOCK pair."""
+    dt = (t - up_us) & 0xFFFFFFFF
+    if dt >= 1 << 31:
+        dt -= 1 << 32
+    return unix_us + dt
+
+
+class UdpRig:
+    """An OUTPUT_UDP rig, known by the rig field of its clock frames."""
+
+    def __init__(self, rig, out, mon):
+        self.id, self.port = f"{rig:06X}", "udp"
+        self.col = C.Collector(out, mon, rig=self.id, target=None)
+        self.seq = self.up_us = None
+        self.datagrams = 0
+        self.lost = 0               # datagrams missing from the seq
+        self.resets = 0
+
+    def datagram(self, seq, up_us, unix_us, frames):
+        newest = True
+        if self.seq is not None:
+            gap = (seq - self.seq - 1) & 0xFFFFFFFF
+            if up_us < self.up_us and seq < self.seq:
+                self.resets += 1
+                print(f"  [{self.id}] restarted (reset {self.resets})")
+            elif gap >= 1 << 31:
+                newest = False              # late duplicate / reordered
+            else:
+                self.lost += gap
+        if newest:
+            self.seq, self.up_us = seq, up_us
+        self.datagrams += 1
+        for ftype, payload in frames:
+            rec = C.frame_to_record(ftype, payload)
+            if rec is None:
+                continue
+            if unix_us:
+                rec["utc_us"] = utc_us(rec["t"], up_us, unix_us) if "t" in rec else unix_us
+            self.col.handle(rec)
+
+
+class UdpListener:
+    """One UDP port shared by any number of OUTPUT_UDP rigs."""
+
+    def __init__(self, port, out, mon, sock=None):
+        self.out, self.mon = out, mon
+        self.rigs = {}              # rig field → UdpRig
+        self.bad = 0                # datagrams without a leading clock frame
+        if sock is None:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, UDP_RCVBUF)
+            sock.bind(("", port))
+        sock.setblocking(False)
+        self.sock = sock
+        self.port = sock.getsockname()[1]
+
+    def service(self):
+        while True:
+            try:
+                data, addr = self.sock.recvfrom(65535)
+            except (BlockingIOError, InterruptedError):
+                return
+            except ConnectionResetError:        # Windows: ICMP from a past send
+                continue
+            self.handle(data, addr)
+
+    def handle(self, data, addr=None):
+        frames = [ev[1:] for ev in C.FrameDecoder().feed(data) if ev[0] == "frame"]
+        if not frames or frames[0][0] != C.FRAME_CLOCK:
+            self.bad += 1
+            return
+        seq, rig, up_us, unix_us = C.unpack_clock(frames[0][1])
+        r = self.rigs.get(rig)
+        if r is None:
+            r = self.rigs[rig] = UdpRig(rig, self.out, self.mon)
+            print(f"  [{r.id}] {addr[0] if addr else '?'} connected (udp)")
+        r.datagram(seq, up_us, unix_us, frames[1:])
+
+    def close(self):
+        self.sock.close()
+
+
+class MultiCollector:
+    def __init__(self, rigs, target=None, opener=DC.open_serial,
+                 waiter=DC.wait_for_port, stats_s=STATS_S, udp=None):
+        self.rigs = rigs
+        self.udp = udp
+        self.target = target
+        self.opener, self.waiter = opener, waiter
+        self.stats_s = stats_s
+        self.sel = selectors.DefaultSelector()
+        self.stop = threading.Event()
+        self.t_start = time.monotonic()
+        if udp is not None:
+            self.sel.register(udp.sock, selectors.EVENT_READ, udp)
+
+    def all_rigs(self):
+        return self.rigs + (list(self.udp.rigs.values()) if self.udp else [])
+
+    @property
+    def good(self):
+        return sum(r.col.good for r in self.all_rigs())
+
+    # ── Connection management ───────────────────────────────────────
+
+    def _reconnect(self, rig):
+        while not self.stop.is_set():
+            if self.waiter(rig.port, timeout=30):
+                try:
+                    rig.pending = self.opener(rig.port)
+                    return
+                except OSError:
+                    pass
+            time.sleep(0.5)
+
+    def _connect_later(self, rig):
+        threading.Thread(target=self._reconnect, args=(rig,), daemon=True).start()
+
+    def _drop(self, rig, err):
+        if rig.fd_ok:
+            self.sel.unregister(rig.ser)
+        try:
+            rig.ser.close()
+        except OSError:
+            pass
+        rig.ser = None
+        rig.resets += 1
+        print(f"  [{rig.id}] {rig.port} lost ({err}); waiting for it to return")
+        self._connect_later(rig)
+
+    def _adopt(self):
+        for rig in self.rigs:
+            if rig.ser is None and rig.pending is not None:
+                rig.attach(rig.pending)
+                if rig.fd_ok:
+                    self.sel.register(rig.ser, selectors.EVENT_READ, rig)
+                print(f"  [{rig.id}] {rig.port} connected"
+                      f"{f' (reset {rig.resets})' if rig.resets else ''}")
+
+    # ── Main loop ───────────────────────────────────────────────────
+
+    def _ready(self, timeout):
+        polled = [r for r in self.rigs if r.ser is not None and not r.fd_ok]
+        ready = []
+        for r in polled:
+            try:
+                if r.waiting():
+                    ready.append(r)
+            except OSError as e:
+                self._drop(r, e)
+        if ready:
+            timeout = 0
+        elif polled:
+            timeout = min(timeout, POLL_S)
+        if self.sel.get_map():
+            ready += [key.data for key, _ in self.sel.select(timeout)]
+        elif not ready:
+            time.sleep(timeout)
+        return ready
+
+    def stats(self):
+        mins = max(time.monotonic() - self.t_start, 1e-3) / 60
+        rigs = self.all_rigs()
+        udp = list(self.udp.rigs.values()) if self.udp else []
+        up = sum(r.ser is not None for r in self.rigs) + len(udp)
+        cycles = sum(r.col.total for r in rigs)
+        per = ", ".join(f"{r.id} {r.col.good / mins:.1f}" for r in rigs)
+        lost = sum(r.lost for r in udp)
+        return (f"== {up}/{len(rigs)} rigs up, {self.good} good / "
+                f"{cycles} cycles, {self.good / mins:.1f} pairs/min ({per})"
+                f"{f', {lost} datagrams lost' if lost else ''}")
+
+    def run(self):
+        for rig in self.rigs:
+            self._connect_later(rig)
+        t_stats = time.monotonic()
+        try:
+            while not self.stop.is_set():
+                self._adopt()
+                for rig in self._ready(0.25):
+                    if rig is self.udp:
+                        rig.service()
+                        continue
+                    if rig.ser is None:
+                        continue
+                    try:
+                        rig.service()
+                    except OSError as e:
+                        self._drop(rig, e)
+                if self.target is not None and self.good >= self.target:
+                    print(f"\n=== {self.good} good captures collected! ===")
+                    break
+                now = time.monotonic()
+                if now - t_stats >= self.stats_s:
+                    t_stats = now
+                    print(f"  {self.stats()}")
+        finally:
+            self.stop.set()
+            for rig in self.rigs:
+                if rig.ser is not None:
+                    if rig.fd_ok:
+                        self.sel.unregister(rig.ser)
+                    rig.ser.close()
+                    rig.ser = None
+            if self.udp is not None:
+                self.sel.unregister(self.udp.sock)
+                self.udp.close()
+
+
+def parse_rigs(specs):
+    """['COM5', 'X=COM6'] → [('A', 'COM5'), ('X', 'COM6')]."""
+    rigs, used = [], set()
+    for i, spec in enumerate(specs):
+        rid, _, port = spec.rpartition("=")
+        rid = rid or chr(ord("A") + i)
+        if rid in used:
+            raise ValueError(f"duplicate rig ID {rid}")
+        used.add(rid)
+        rigs.append((rid, port))
+    return rigs
+
+
+# ── Self-test ───────────────────────────────────────────────────────
+
+class _FakeSerial:
+    """Scripted port: a list of byte chunks, None = unplugged."""
+
+    def __init__(self, chunks):
+        self.chunks = list(chunks)
+        self.timeout = 0
+
+    @property
+    def in_waiting(self):
+        if self.chunks and self.chunks[0] is None:
+            raise OSError("device disconnected")
+        return len(self.chunks[0]) if self.chunks else 0
+
+    def read(self, n):
+        if not self.chunks:
+            return b""
+        if self.chunks[0] is None:
+            raise OSError("device disconnected")
+        return self.chunks.pop(0)
+
+    def close(self):
+        pass
+
+
+def self_test():
+    import json
+    print("=== collect_multi.py self-test ===\n")
+    chal = [(1, 1), (7, 1), (3, 2)]
+    resp = [(1, 1), (4, 1)]
+
+    def cycle_frame(cy, ok):
+        p = C.CYCLE_HDR.pack(cy, 2000, 1800 if ok else 0, 300, 12000, 900, 9, 0, ok)
+        return C.encode_frame(C.FRAME_CYCLE, p + C.pack_pairs(chal) + C.pack_pairs(resp))
+
+    def cycle_json(cy, ok):
+        return (json.dumps({"cycle": cy, "ok": ok, "challenge": chal,
+                            "response": resp}) + "\n").encode()
+
+    # Rig A resets mid-frame after two cycles, then carries on; B is JSON
+    fa = cycle_frame(1, 1) + b"I (10) capture: log\r\n" + cycle_frame(2, 0)
+    ports = {
+        "P0": [_FakeSerial([fa[:20], fa[20:], cycle_frame(3, 1)[:9], None]),
+               _FakeSerial([b"I (5) capture: boot\r\n", cycle_frame(1, 1)])],
+        "P1": [_FakeSerial([cycle_json(1, True), cycle_json(2, True)])],
+    }
+
+    def opener(port):
+        if not ports[port]:
+            raise OSError("gone")
+        return ports[port].pop(0)
+
+    path, mpath = "_multi_selftest.jsonl", "_multi_selftest_mon.jsonl"
+    out, mon = Appender(path, fsync_s=3600), Appender(mpath, fsync_s=3600)
+    rigs = [Rig(rid, port, out, mon) for rid, port in parse_rigs(["P0", "P1"])]
+    mc = MultiCollector(rigs, target=4, opener=opener,
+                        waiter=lambda port, timeout: True, stats_s=3600)
+    t0 = time.monotonic()
+    mc.run()
+    elapsed = time.monotonic() - t0
+    print(f"  {mc.stats()}")
+    written_before_close = os.path.getsize(path)
+    out.close()
+    mon.close()
+    try:
+        with open(path) as f:
+            recs = [json.loads(l) for l in f]
+    finally:
+        os.remove(path)
+        os.remove(mpath)
+
+    by_rig = {}
+    for r in recs:
+        by_rig.setdefault(r["rig"], []).append((r["cycle"], r["ok"]))
+    checks = [
+        ("parse_rigs", parse_rigs(["COM5", "X=COM6"]) == [("A", "COM5"), ("X", "COM6")]),
+        ("target reached", mc.good == 4 and elapsed < 10),
+        ("rig A survives reset", rigs[0].resets == 1
+            and by_rig.get("A") == [(1, True), (2, False), (1, True)]),
+        ("rig B tagged", by_rig.get("B") == [(1, True), (2, True)]),
+        ("appender buffered", written_before_close == 0 and len(recs) == 5),
+    ]
+
+    # UDP: two Wi-Fi rigs on one port; one loses a datagram and restarts,
+    # the other has no SNTP time yet; a datagram without a clock is junk
+    def dgram(seq, rig, up, unix, *frames):
+        return C.encode_frame(C.FRAME_CLOCK, C.CLOCK_HDR.pack(seq, rig, up, unix)) + b"".join(frames)
+
+    up0, unix0 = (1 << 32) + 1000, 1_760_000_000_000_000
+    msg = C.encode_frame(C.FRAME_MSG, C.MSG_HDR.pack(500, 1) + C.pack_pairs(resp))
+    sends = [
+        dgram(0, 0xA1B2C3, up0, unix0, cycle_frame(1, 1), msg),
+        dgram(2, 0xA1B2C3, up0 + 40000, unix0 + 40000, cycle_frame(2, 0)),
+        dgram(7, 0x00000F, 9000, 0, cycle_frame(1, 1)),
+        cycle_frame(9, 1),
+        dgram(0, 0xA1B2C3, 2000, unix0 + 90000, cycle_frame(1, 1)),
+        dgram(8, 0x00000F, 12000, 0, cycle_frame(2, 1)),
+    ]
+    out, mon = Appender(path, fsync_s=3600), Appender(mpath, fsync_s=3600)
+    udp = UdpListener(0, out, mon, sock=socket.socket(socket.AF_INET, socket.SOCK_DGRAM))
+    udp.sock.bind(("127.0.0.1", 0))
+    tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    for d in sends:
+        tx.sendto(d, ("127.0.0.1", udp.sock.getsockname()[1]))
+    tx.close()
+    mu = MultiCollector([], target=4, udp=udp, stats_s=3600)
+    t0 = time.monotonic()
+    mu.run()
+    elapsed = time.monotonic() - t0
+    print(f"  {mu.stats()}")
+    out.close()
+    mon.close()
+    try:
+        with open(path) as f:
+            urecs = [json.loads(l) for l in f]
+        with open(mpath) as f:
+            umon = [json.loads(l) for l in f]
+    finally:
+        os.remove(path)
+        os.remove(mpath)
+    a, b = udp.rigs.get(0xA1B2C3), udp.rigs.get(0x00000F)
+    udp_by = {}
+    for r in urecs:
+        udp_by.setdefault(r["rig"], []).append((r["cycle"], r.get("utc_us")))
+    checks += [
+        ("udp utc_us", utc_us(500, up0, unix0) == unix0 - 500
+                       and utc_us(0x10, 0xFFFFFFF0, 0) == 0x20),
+        ("udp target reached", mu.good == 4 and elapsed < 10),
+        ("udp rigs by clock frame", a is not None and b is not None and udp.bad == 1),
+        ("udp seq gap / restart", a is not None and a.lost == 1 and a.resets == 1
+                                  and b is not None and b.lost == 0),
+        ("udp records", udp_by.get("A1B2C3") == [(1, unix0), (2, unix0 + 40000),
+                                                 (1, unix0 + 90000)]
+                        and udp_by.get("00000F") == [(1, None), (2, None)]),
+        ("udp msg time", [m.get("utc_us") for m in umon if "pairs" in m] == [unix0 - 500]),
+    ]
+    ok = True
+    for name, passed in checks:
+        print(f"  {'PASS' if passed else 'FAIL'}: {name}")
+        ok &= passed
+    print(f"\n=== Self-test {'PASSED' if ok else 'FAILED'} ===")
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("ports", nargs="*", help="PORT or ID=PORT, one per rig")
+    ap.add_argument("--udp", type=int, metavar="PORT",
+                    help="also receive OUTPUT_UDP rigs on this UDP port")
+    ap.add_argument("--target", type=int, help="stop after this many good pairs in total")
+    ap.add_argument("--out", default="captures.jsonl")
+    ap.add_argument("--monitor", default="monitor.jsonl")
+    ap.add_argument("--test", action="store_true", help="self-test, no hardware")
+    args = ap.parse_args()
+
+    if args.test:
+        sys.exit(0 if self_test() else 1)
+    if not args.ports and args.udp is None:
+        ap.error("at least one port (or --udp PORT) is required")
+    if args.ports and DC.serial is None:
+        print("pyserial is required: pip install pyserial")
+        sys.exit(1)
+    try:
+        specs = parse_rigs(args.ports)
+    except ValueError as e:
+        ap.error(str(e))
+
+    out, mon = Appender(args.out), Appender(args.monitor)
+    rigs = [Rig(rid, port, out, mon) for rid, port in specs]
+    try:
+        udp = UdpListener(args.udp, out, mon) if args.udp is not None else None
+    except OSError as e:
+        ap.error(f"--udp {args.udp}: {e}")
+    mc = MultiCollector(rigs, target=args.target, udp=udp)
+    where = [f"{r.id}={r.port}" for r in rigs] + ([f"udp:{udp.port}"] if udp else [])
+    print(f"Listening on {', '.join(where)} — writing to {args.out}")
+    print("Press Ctrl+C to stop\n")
+    try:
+        mc.run()
+    except KeyboardInterrupt:
+        print("\nStopped.")
+    finally:
+        out.close()
+        mon.close()
+    print(f"  {mc.stats()}")
+    for r in mc.all_rigs():
+        lost = getattr(r, "lost", 0)
+        print(f"  [{r.id}] {r.port}: {r.col.good} good in {r.col.total} cycles"
+              f"{f', {r.resets} reset(s)' if r.resets else ''}"
+              f"{f', {lost} datagram(s) lost' if lost else ''}")
+
+
+if __name__ == "__main__":
+    main()
@@ -13,10 +13,10 @@ import os
 from collections import Counter
 
 sys.path.insert(0, os.path.dirname(__file__))
-from analyze import parse_capture, find_bursts, BURST_GAP_S
+from analyze import (parse_capture, suppress_crosstalk, find_bursts, BURST_GAP_S,
+                     CROSSTALK_THRESH as CROSSTALK_THRESHOLD)
 
 PWM_UNIT_US = 26.0
-CROSSTALK_THRESHOLD = 10  # H values above this are CH0 carrier interference
 
 TYPE_B_HEADER_LOW = [1, 7, 2, 1, 4, 6, 2, 9]
 
@@ -74,6 +74,7 @@ def raw_l_symbols(pairs, start=0):
 
 def extract_messages(filepath):
     channels, ncols = parse_capture(filepath)
+    channels, _ = suppress_crosstalk(channels)
     ch1 = channels.get(1, [])
     if not ch1:
         return []
@@ -9,12 +9,51 @@ Usage:
     python dump_collect.py COM5 firmware.hex    # explicit filename
     python dump_collect.py --test               # self-test (no hardware needed)
     python dump_collect.py --dry-run COM5       # capture Phase 0 test HEX only
+    python dump_collect.py --program patched.hex COM5   # flash, then verify
+    python dump_collect.py --diff COM5          # refresh cc1110_flash.bin
+    python dump_collect.py --hex COM5           # HEX text transfer, no binary
+    python dump_collect.py --snapshot COM5      # + live SFR/radio/SRAM state
+
+After Phase 3 the firmware prompts "; CMD?" and takes commands from the
+host (see host_session() in esp32_ccdebug/main/main.c).
+
+--program sends the image (Intel HEX or raw .bin) page by page in PROG
+mode.  Each 1 KB page it touches is erased and rewritten, with bytes the
+image does not cover set to 0xFF.  The programmed pages are then checked
+against the firmware's per-block CRCs instead of a full dump.
+
+--diff asks for one CRC per 64-byte block, compares them with the cached
+.bin from an earlier dump and fetches only the blocks that differ.  The
+.hex and .bin are rewritten from the merged image.  Without a cache, or
+with firmware that does not answer, the full dump runs as usual.
+
+Data is read with the firmware's BIN command: CRC-framed binary chunks,
+less than half the bytes of Intel HEX text.  Bad frames are re-requested;
+--hex, older firmware or a stream that loses sync use HEX records.
+
+--snapshot first saves the halted receiver's state as XDATA-addressed
+Intel HEX (*_xdata.hex): radio registers at 0xDF00, SFRs at their
+0xDF80 alias, SRAM at 0xF000.  It runs before anything else in the
+session because PROG and the on-chip CRC stub overwrite SRAM.
 """
 
+import os
 import sys
 import time
-import serial
-from serial.tools import list_ports
+import struct
+import binascii
+
+try:
+    import serial
+    from serial.tools import list_ports
+except ImportError:         # --test runs without pyserial
+    serial = None
+
+PAGE_SIZE = 1024
+BLOCK_SIZE = 64             # firmware BLOCK_SIZE, one CRC each
+FLASH_SIZE = 32 * 1024
+BIN_MAGIC = b'\xA5B'        # binary frame: A5, kind, u16 addr, u16 len, data, u16 crc
+BIN_RETRIES = 3             # re-requests of a bad frame before using HEX
 
 
 def wait_for_port(port, timeout=30):
@@ -43,8 +82,8 @@ def open_serial(port):
     raise serial.SerialException(f"Cannot open {port} after 5 attempts")
 
 
-def ihex_to_bin(hex_lines):
-    """Convert Intel HEX lines to a flat binary."""
+def ihex_to_map(hex_lines):
+    """Parse Intel HEX lines into {address: byte}."""
     data = {}
     for line in hex_lines:
         line = line.strip()
@@ -59,7 +98,12 @@ def ihex_to_bin(hex_lines):
                 data[address + i] = b
         elif rec_type == 0x01:  # EOF
             break
+    return data
+
 
+def ihex_to_bin(hex_lines):
+    """Convert Intel HEX lines to a flat binary."""
+    data = ihex_to_map(hex_lines)
     if not data:
         return b''
     min_addr = min(data.keys())
@@ -70,6 +114,355 @@ def ihex_to_bin(hex_lines):
     return bytes(buf)
 
 
+def bin_to_ihex(bin_data, base=0):
+    """Encode a flat binary as 16-byte Intel HEX data records + EOF."""
+    lines = []
+    for off in range(0, len(bin_data), 16):
+        chunk = bin_data[off:off + 16]
+        addr = base + off
+        raw = bytes([len(chunk), addr >> 8, addr & 0xFF, 0x00]) + chunk
+        lines.append(f":{raw.hex().upper()}{(-sum(raw)) & 0xFF:02X}")
+    lines.append(":00000001FF")
+    return lines
+
+
+def map_to_ihex(data):
+    """Encode {address: byte} as 16-byte Intel HEX records over its
+    contiguous runs, + EOF."""
+    lines = []
+    run = []
+    for addr in sorted(data) + [None]:
+        if run and (addr is None or addr != run[0] + len(run) or len(run) == 16):
+            lines += bin_to_ihex(bytes(data[a] for a in run), run[0])[:-1]
+            run = []
+        if addr is not None:
+            run.append(addr)
+    lines.append(":00000001FF")
+    return lines
+
+
+def crc16_rndh(data, crc=0xFFFF):
+    """CRC of the CC1110 RNDL/RNDH unit: x^16+x^15+x^2+1, MSB first,
+    seeded 0xFFFF.  Matches the firmware's "; CRC" block values."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x8005) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def read_frame(ser, first=b''):
+    """Read one binary frame (A5 <kind> <addr> <len> <data> <crc>).
+
+    first: bytes of the header already read by the caller.  Returns
+    (kind, addr, data, crc_ok), or None on a short read or bad magic.
+    """
+    hdr = first + ser.read(6 - len(first))
+    if len(hdr) < 6 or hdr[0] != 0xA5:
+        return None
+    a, n = struct.unpack('<HH', hdr[2:])
+    body = ser.read(n + 2)
+    if len(body) < n + 2:
+        return None
+    data, crc = body[:n], int.from_bytes(body[n:], 'little')
+    return chr(hdr[1]), a, data, binascii.crc_hqx(hdr[2:] + data, 0xFFFF) == crc
+
+
+def block_ranges(blocks):
+    """Merge sorted block numbers into (address, length) runs."""
+    runs = []
+    for b in blocks:
+        if runs and runs[-1][0] + runs[-1][1] == b * BLOCK_SIZE:
+            runs[-1][1] += BLOCK_SIZE
+        else:
+            runs.append([b * BLOCK_SIZE, BLOCK_SIZE])
+    return [tuple(r) for r in runs]
+
+
+def load_image(path):
+    """Load a .hex or .bin image as {page: PAGE_SIZE bytes}, gaps = 0xFF."""
+    if path.lower().endswith('.hex'):
+        with open(path) as f:
+            data = ihex_to_map(f.readlines())
+    else:
+        with open(path, 'rb') as f:
+            data = dict(enumerate(f.read()))
+    if data and max(data) >= FLASH_SIZE:
+        raise ValueError(f"{path}: data at 0x{max(data):X} beyond {FLASH_SIZE} byte flash")
+    pages = {}
+    for addr, val in data.items():
+        page = pages.setdefault(addr // PAGE_SIZE, bytearray(b'\xFF' * PAGE_SIZE))
+        page[addr % PAGE_SIZE] = val
+    return {p: bytes(pages[p]) for p in sorted(pages)}
+
+
+def page_line(page, data):
+    """Encode one page as the firmware's 'W <page> <hex> <crc16>' command."""
+    crc = binascii.crc_hqx(data, 0xFFFF)
+    return f"W {page:02X} {data.hex().upper()} {crc:04X}\n"
+
+
+class Programmer:
+    """Drives the firmware's PROG mode from the lines it prints.
+
+    '; PROG READY' → first page, each '; W pp OK|ERR' → next page, then
+    END.  feed() returns True for lines that belong to the exchange so
+    the caller need not echo them.
+    """
+
+    def __init__(self, pages):
+        self.pages = pages
+        self.queue = list(pages)
+        self.failed = []
+        self.done = False
+        self.started = False
+
+    def _send(self, ser, text):
+        ser.write(text.encode())
+        ser.flush()
+
+    def _next(self, ser):
+        if self.queue:
+            p = self.queue[0]
+            self._send(ser, page_line(p, self.pages[p]))
+        else:
+            self._send(ser, "END\n")
+
+    def feed(self, line, ser):
+        if self.done:
+            return False
+        if line.startswith('; PROG READY'):
+            self.started = True
+            self._next(ser)
+            return True
+        if line.startswith('; W ') and self.started:
+            parts = line.split()
+            page = int(parts[2], 16)
+            ok = parts[3] == 'OK'
+            if self.queue and self.queue[0] == page:
+                self.queue.pop(0)
+            if not ok:
+                self.failed.append(page)
+            print(f"  page {page:02X} @ 0x{page * PAGE_SIZE:04X}: "
+                  f"{'OK' if ok else ' '.join(parts[3:])}")
+            self._next(ser)
+            return True
+        if line.startswith('; PROG DONE'):
+            self.done = True
+            print(f"  {line[2:]}")
+            return True
+        return False
+
+    def verify(self, bin_data):
+        """Compare programmed pages against a full dump; returns bad pages."""
+        bad = []
+        for p, data in self.pages.items():
+            if bin_data[p * PAGE_SIZE:(p + 1) * PAGE_SIZE] != data:
+                bad.append(p)
+        return bad
+
+
+class HostSession:
+    """Answers the firmware's '; CMD?' prompts for one run.
+
+    In order: PROG (if programming), CRC (if there is a cache or pages
+    to verify), one 'BIN aaaa nnnn' per run of changed blocks, then DONE.
+    With nothing else to do the whole flash is read with BIN.  Firmware
+    whose first prompt does not list BIN, or a binary stream that loses
+    sync, gets 'R' (HEX records) and DUMP instead.  finished is set on
+    '; BYE'.
+    """
+
+    def __init__(self, prog=None, cache=None, binary=True, snapshot=False):
+        self.prog = prog
+        self.binary = binary
+        self.want_snap = snapshot
+        self.snap = None            # XDATA addr → byte, SFRs at 0xDF80+
+        self.cache = cache
+        self.expected = bytearray(cache) if cache else None
+        if prog:
+            if self.expected is None:
+                self.expected = bytearray(b'\xFF' * FLASH_SIZE)
+            for p, data in prog.pages.items():
+                self.expected[p * PAGE_SIZE:(p + 1) * PAGE_SIZE] = data
+        self.sent_prog = False
+        self.sent_crc = False
+        self.crcs = {}
+        self.crc_done = False
+        self.changed = []
+        self.fetch = None
+        self.bad_pages = []
+        self.full_sent = False
+        self.fetched = {}           # addr → bytes from BIN frames
+        self.retries = {}
+        self.draining = False
+        self.prompted = False
+        self.finished = False
+
+    def _send(self, ser, text):
+        ser.write(text.encode())
+        ser.flush()
+
+    def _known(self, block):
+        """Blocks whose content we can predict: all with a cache, else
+        only those inside programmed pages."""
+        return self.cache is not None or (block * BLOCK_SIZE) // PAGE_SIZE in self.prog.pages
+
+    def _command(self, ser):
+        if self.want_snap:
+            print("  Taking SFR / radio / SRAM snapshot...")
+            self.want_snap = False
+            cmd = "SNAP"
+        elif self.prog and not self.sent_prog:
+            print(f"  Programming {len(self.prog.pages)} page(s)...")
+            self.sent_prog = True
+            cmd = "PROG"
+        elif self.expected is not None and not self.sent_crc:
+            print("  Requesting block CRCs...")
+            self.sent_crc = True
+            cmd = "CRC"
+        elif self.fetch:
+            addr, n = self.fetch.pop(0)
+            cmd = f"{'BIN' if self.binary else 'R'} {addr:04X} {n:04X}"
+        elif self.crc_done or self.full_sent:
+            cmd = "DONE"
+        elif self.binary:
+            print(f"  Reading {FLASH_SIZE} bytes as binary frames...")
+            self.full_sent = True
+            cmd = f"BIN 0000 {FLASH_SIZE:04X}"
+        else:
+            cmd = "DUMP"
+        self._send(ser, cmd + "\n")
+
+    def _read_frames(self, ser, addr, length, store):
+        """Read the frames of one BIN reply into store {addr: bytes}.
+        Returns a list of (addr, len) frames that failed their CRC, or
+        None if the stream lost sync (short read or bad magic)."""
+        t0 = time.time()
+        got, bad = 0, []
+        while got < length:
+            frame = read_frame(ser)
+            if frame is None or frame[0] != 'B':
+                return None
+            _, a, data, ok = frame
+            if ok:
+                store[a] = data
+            else:
+                bad.append((a, len(data)))
+            got += len(data)
+        dt = time.time() - t0
+        print(f"  BIN 0x{addr:04X}+{length}: {len(bad)} bad frame(s), "
+              f"{dt:.1f} s ({length / dt if dt else 0:.0f} B/s)")
+        return bad
+
+    def _bin_begin(self, line, ser):
+        fields = dict(f.split('=') for f in line.split()[3:])
+        addr, length = int(fields['addr'], 16), int(fields['len'])
+        if fields.get('space', 'code') == 'xdata':
+            frames = {}
+            bad = self._read_frames(ser, addr, length, frames)
+            if bad is None:
+                print("  Snapshot stream lost sync")
+                self.draining = True
+            for a, data in frames.items():
+                self.snap.update(zip(range(a, a + len(data)), data))
+            return
+        bad = self._read_frames(ser, addr, length, self.fetched)
+        if bad is None:
+            print("  Binary stream lost sync — falling back to HEX records")
+            self.binary = False
+            self.draining = True
+            bad = [(addr, length)]
+        if self.fetch is None:
+            self.fetch = []
+        for a, n in bad:
+            self.retries[a] = self.retries.get(a, 0) + 1
+            if self.retries[a] > BIN_RETRIES:
+                self.binary = False
+            self.fetch.append((a, n))
+
+    def _crc_end(self):
+        self.crc_done = True
+        nblocks = FLASH_SIZE // BLOCK_SIZE
+        if len(self.crcs) != nblocks:
+            print(f"  Got {len(self.crcs)}/{nblocks} block CRCs — falling back to full dump")
+            self.crc_done = False
+            return
+        for b in range(nblocks):
+            if not self._known(b):
+                continue
+            exp = self.expected[b * BLOCK_SIZE:(b + 1) * BLOCK_SIZE]
+            if crc16_rndh(exp) != self.crcs[b]:
+                self.changed.append(b)
+        if self.prog:
+            self.bad_pages = sorted({b * BLOCK_SIZE // PAGE_SIZE for b in self.changed
+                                     if b * BLOCK_SIZE // PAGE_SIZE in self.prog.pages})
+        self.fetch = block_ranges(self.changed) if self.cache is not None else []
+        print(f"  {len(self.changed)} of {nblocks} blocks differ"
+              + (f", fetching {len(self.changed) * BLOCK_SIZE} bytes" if self.fetch else ""))
+
+    def feed(self, line, ser):
+        if self.draining:
+            self.draining = not line.startswith('; BIN END')
+            return True
+        if self.prog and self.prog.feed(line, ser):
+            return True
+        if line.startswith('; CMD?'):
+            if not self.prompted:
+                self.prompted = True
+                self.binary = self.binary and 'BIN' in line
+                if self.want_snap and 'SNAP' not in line:
+                    print("  Firmware has no SNAP command — skipping snapshot")
+                    self.want_snap = False
+            self._command(ser)
+        elif line.startswith('; SNAP BEGIN'):
+            self.snap = {}
+        elif line.startswith('; SNAP END'):
+            print(f"  Snapshot: {len(self.snap)} bytes")
+        elif line.startswith('; SFR ') and self.snap is not None:
+            parts = line.split()
+            base = 0xDF00 | int(parts[2], 16)
+            for i, v in enumerate(parts[3:]):
+                if v != '--':
+                    self.snap[base + i] = int(v, 16)
+        elif line.startswith('; BIN BEGIN'):
+            self._bin_begin(line, ser)
+        elif line.startswith('; BIN '):
+            if 'ERR' in line:
+                print(f"  {line}")
+        elif line.startswith('; CRC BEGIN'):
+            fields = dict(f.split('=') for f in line.split()[3:])
+            if int(fields.get('block', 0)) != BLOCK_SIZE:
+                print(f"  Firmware block size {fields.get('block')} != {BLOCK_SIZE} — full dump")
+                self.expected = None
+        elif line.startswith('; CRC END'):
+            if self.expected is not None:
+                self._crc_end()
+        elif line.startswith('; CRC '):
+            parts = line.split()
+            addr = int(parts[2], 16)
+            for i, c in enumerate(parts[3:]):
+                self.crcs[addr // BLOCK_SIZE + i] = int(c, 16)
+        elif line.startswith('; R '):
+            if 'ERR' in line:
+                print(f"  {line}")
+        elif line.startswith('; BYE'):
+            self.finished = True
+        else:
+            return False
+        return True
+
+    def merged(self, hex_lines):
+        """Expected image (0xFF if none) with fetched blocks applied."""
+        out = bytearray(self.expected or b'\xFF' * FLASH_SIZE)
+        for addr, val in ihex_to_map(hex_lines).items():
+            out[addr] = val
+        for addr, data in self.fetched.items():
+            out[addr:addr + len(data)] = data
+        return bytes(out)
+
+
 def self_test():
     """Generate and parse test Intel HEX data (no hardware needed)."""
     print("=== dump_collect.py self-test ===\n")
@@ -130,12 +523,162 @@ def self_test():
     if all_ok:
         print("   PASS: All checksums valid")
 
+    # Programming: image → page commands
+    print("\n6. Encoding a page for PROG mode...")
+    pages = {1: bytes(range(256)) * 4}
+    line = page_line(1, pages[1])
+    crc = binascii.crc_hqx(pages[1], 0xFFFF)
+    if (len(line) == 2 + 2 + 1 + 2 * PAGE_SIZE + 1 + 4 + 1 and line.startswith("W 01 00010203")
+            and line.rstrip().endswith(f"{crc:04X}")):
+        print(f"   PASS: {len(line) - 1} chars, crc 0x{crc:04X}")
+    else:
+        print("   FAIL: bad page line")
+        return False
+    full = bytearray(b'\xFF' * FLASH_SIZE)
+    full[PAGE_SIZE:2 * PAGE_SIZE] = pages[1]
+    if Programmer(pages).verify(bytes(full)) != [] or Programmer(pages).verify(bytes(FLASH_SIZE)) != [1]:
+        print("   FAIL: verify")
+        return False
+    print("   PASS: verify detects matching and mismatching pages")
+
+    # Diff dump: block CRCs → only changed blocks requested
+    print("\n7. Block-CRC diff session...")
+    if crc16_rndh(b"123456789") != 0xAEE7:
+        print(f"   FAIL: crc16_rndh check value 0x{crc16_rndh(b'123456789'):04X}")
+        return False
+    cache = bytes(range(256)) * (FLASH_SIZE // 256)
+    device = bytearray(cache)
+    device[0x0041] ^= 0xFF                  # block 1
+    device[0x0080:0x0100] = b'\x00' * 128   # blocks 2, 3
+
+    class FakeSerial:
+        def __init__(self):
+            self.sent = []
+        def write(self, b):
+            self.sent.append(b.decode().strip())
+        def flush(self):
+            pass
+
+    ser = FakeSerial()
+    sess = HostSession(cache=cache)
+    sess.feed("; CMD? PROG|CRC|R|DUMP|DONE within 5000 ms, else dumping", ser)
+    sess.feed(f"; CRC BEGIN block={BLOCK_SIZE} size={FLASH_SIZE}", ser)
+    per_line = 8
+    for a in range(0, FLASH_SIZE, BLOCK_SIZE * per_line):
+        crcs = [crc16_rndh(device[b:b + BLOCK_SIZE])
+                for b in range(a, a + BLOCK_SIZE * per_line, BLOCK_SIZE)]
+        sess.feed(f"; CRC {a:04X} " + ' '.join(f"{c:04X}" for c in crcs), ser)
+    sess.feed("; CRC END", ser)
+    hex_lines = []
+    while not sess.finished:
+        sess.feed("; CMD?", ser)
+        cmd = ser.sent[-1]
+        if cmd.startswith("R "):
+            addr, n = int(cmd[2:6], 16), int(cmd[7:11], 16)
+            hex_lines += bin_to_ihex(device[addr:addr + n], addr)[:-1]
+        elif cmd == "DONE":
+            sess.feed("; BYE", ser)
+        else:
+            break
+    if ser.sent != ["CRC", "R 0040 00C0", "DONE"] or sess.merged(hex_lines) != bytes(device):
+        print(f"   FAIL: commands {ser.sent}")
+        return False
+    print(f"   PASS: {' / '.join(ser.sent)}, merged image matches device")
+
+    # Binary frames: full read, one corrupted frame is re-requested
+    print("\n8. Binary frame transfer...")
+
+    def frames(addr, n, corrupt=None, mem=device, base=0):
+        out = b''
+        for a in range(addr, addr + n, 256):
+            data = bytes(mem[a - base:a - base + min(256, addr + n - a)])
+            hdr = struct.pack('<HH', a, len(data))
+            crc = binascii.crc_hqx(hdr + data, 0xFFFF)
+            if a == corrupt:
+                data = bytes([data[0] ^ 0xFF]) + data[1:]
+            out += BIN_MAGIC + hdr + data + struct.pack('<H', crc)
+        return out
+
+    class FakeBinSerial(FakeSerial):
+        def __init__(self):
+            super().__init__()
+            self.rx = b''
+        def read(self, n):
+            chunk, self.rx = self.rx[:n], self.rx[n:]
+            return chunk
+
+    ser = FakeBinSerial()
+    sess = HostSession()
+    corrupt = 0x0100
+    sess.feed("; CMD? PROG|CRC|R|BIN|DUMP|DONE within 5000 ms, else dumping", ser)
+    while not sess.finished and len(ser.sent) < 10:
+        cmd = ser.sent[-1]
+        if cmd.startswith("BIN "):
+            addr, n = int(cmd[4:8], 16), int(cmd[9:13], 16)
+            ser.rx = frames(addr, n, corrupt)
+            corrupt = None
+            sess.feed(f"; BIN BEGIN addr={addr:04X} len={n} chunk=256", ser)
+            sess.feed("; BIN END", ser)
+        elif cmd == "DONE":
+            sess.feed("; BYE", ser)
+            break
+        sess.feed("; CMD?", ser)
+    if (ser.sent != [f"BIN 0000 {FLASH_SIZE:04X}", "BIN 0100 0100", "DONE"]
+            or sess.merged([]) != bytes(device)):
+        print(f"   FAIL: commands {ser.sent}")
+        return False
+    print(f"   PASS: {' / '.join(ser.sent)}, image matches device")
+
+    # Snapshot: SFR lines at their 0xDF80 alias + xdata frames
+    print("\n9. SNAP snapshot...")
+    ser = FakeBinSerial()
+    sess = HostSession(snapshot=True)
+    sess.feed("; CMD? PROG|CRC|R|BIN|SNAP|DUMP|DONE within 5000 ms, else dumping", ser)
+    sess.feed("; SNAP BEGIN", ser)
+    sess.feed("; SFR C0 " + ' '.join('--' if i == 1 else f"{i:02X}" for i in range(16)), ser)
+    sram = bytes(range(256)) * 16
+    ser.rx = frames(0xF000, len(sram), mem=sram, base=0xF000)
+    sess.feed("; BIN BEGIN addr=F000 len=4096 chunk=256 space=xdata", ser)
+    sess.feed("; SNAP END", ser)
+    snap = ihex_to_map(map_to_ihex(sess.snap))
+    if (ser.sent != ["SNAP"] or 0xDFC1 in snap or snap.get(0xDFC2) != 2
+            or bytes(snap[a] for a in range(0xF000, 0x10000)) != sram):
+        print(f"   FAIL: snapshot {ser.sent}")
+        return False
+    print(f"   PASS: {len(snap)} bytes, skipped SFR left out")
+
     print("\n=== Self-test PASSED ===")
     print("The HEX parser is working correctly.")
     print("Ready to capture real data from the ESP32.")
     return True
 
 
+def finish_session(session, hex_lines, hex_file, bin_file):
+    """Report a session the firmware ended with '; BYE' (no full dump)."""
+    if session.prog:
+        prog = session.prog
+        bad = sorted(set(session.bad_pages + prog.failed))
+        if not prog.started:
+            print("\nPROG mode was never offered — image NOT programmed.")
+        elif bad:
+            print(f"\nProgramming FAILED: pages {', '.join(f'{p:02X}' for p in bad)}")
+        else:
+            print(f"\nAll {len(prog.pages)} programmed page(s) verified by block CRC.")
+
+    if session.cache is None and not session.full_sent:
+        return
+    bin_data = session.merged(hex_lines)
+    with open(hex_file, 'w') as f:
+        for hl in bin_to_ihex(bin_data):
+            f.write(hl + '\n')
+    with open(bin_file, 'wb') as f:
+        f.write(bin_data)
+    if session.cache is None:
+        print(f"\nFull {len(bin_data)} byte dump → {hex_file} + {bin_file}")
+    else:
+        print(f"\n{len(session.changed)} changed block(s) merged → {hex_file} + {bin_file}")
+
+
 def main():
     if len(sys.argv) >= 2 and sys.argv[1] == '--test':
         ok = self_test()
@@ -146,10 +689,38 @@ def main():
     if '--dry-run' in sys.argv:
         dry_run = True
 
+    prog = None
+    if '--program' in args:
+        i = args.index('--program')
+        if i + 1 >= len(args):
+            print("--program needs an image file (.hex or .bin)")
+            sys.exit(1)
+        image = args[i + 1]
+        del args[i:i + 2]
+        prog = Programmer(load_image(image))
+        print(f"Image {image}: {len(prog.pages)} page(s) to program")
+
+    diff = '--diff' in args
+    if diff:
+        args.remove('--diff')
+    binary = '--hex' not in args
+    if not binary:
+        args.remove('--hex')
+    snapshot = '--snapshot' in args
+    if snapshot:
+        args.remove('--snapshot')
+
     if len(args) < 1:
         print("Usage: python dump_collect.py <COM_PORT> [output.hex]")
         print("       python dump_collect.py --test")
         print("       python dump_collect.py --dry-run <COM_PORT>")
+        print("       python dump_collect.py --program <image.hex|.bin> <COM_PORT>")
+        print("       python dump_collect.py --diff <COM_PORT> [output.hex]")
+        print("       add --hex to transfer Intel HEX text instead of binary frames")
+        print("       add --snapshot to save SFR/radio/SRAM state as *_xdata.hex")
+        sys.exit(1)
+    if serial is None:
+        print("pyserial is required: pip install pyserial")
         sys.exit(1)
 
     port = args[0]
@@ -159,6 +730,16 @@ def main():
         hex_file = args[1] if len(args) > 1 else "cc1110_flash.hex"
     bin_file = hex_file.replace('.hex', '.bin')
 
+    cache = None
+    if diff:
+        if os.path.exists(bin_file) and os.path.getsize(bin_file) == FLASH_SIZE:
+            with open(bin_file, 'rb') as f:
+                cache = f.read()
+            print(f"Cache {bin_file}: only blocks whose CRC differs will be read")
+        else:
+            print(f"No {FLASH_SIZE} byte cache at {bin_file} — full dump")
+    session = HostSession(prog, cache, binary, snapshot) if not dry_run else None
+
     ser = open_serial(port)
 
     if dry_run:
@@ -200,6 +781,11 @@ def main():
             if not line:
                 continue
 
+            if session and session.feed(line, ser):
+                if session.finished:
+                    break
+                continue
+
             if line.startswith(':'):
                 hex_lines.append(line)
                 # Show progress for data records
@@ -224,6 +810,17 @@ def main():
     except Exception:
         pass
 
+    if session and session.snap:
+        snap_file = hex_file.replace('.hex', '_xdata.hex')
+        with open(snap_file, 'w') as f:
+            for hl in map_to_ihex(session.snap):
+                f.write(hl + '\n')
+        print(f"Saved {len(session.snap)} byte XDATA snapshot → {snap_file}")
+
+    if session and session.finished:
+        finish_session(session, hex_lines, hex_file, bin_file)
+        return
+
     if not hex_lines:
         print("No HEX data received. Check wiring and retry.")
         sys.exit(1)
@@ -247,6 +844,19 @@ def main():
     else:
         print(f"\nPartial dump ({len(bin_data)} bytes — may be incomplete)")
 
+    if prog:
+        if not prog.started:
+            print("\nPROG mode was never offered — image NOT programmed.")
+        elif got_eof and len(bin_data) == FLASH_SIZE:
+            bad = prog.verify(bin_data)
+            if bad or prog.failed:
+                print(f"\nProgramming FAILED: pages "
+                      f"{', '.join(f'{p:02X}' for p in sorted(set(bad + prog.failed)))}")
+            else:
+                print(f"\nAll {len(prog.pages)} programmed page(s) verified against the dump.")
+        else:
+            print("\nDump incomplete — cannot verify programmed pages.")
+
     # Quick analysis
     if len(bin_data) >= 16:
         print(f"\nFirst 32 bytes:")
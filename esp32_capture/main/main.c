@@ -8,23 +8,87 @@
  *   GPIO4  = CH0 (Z3, receiver→opener) input tap
  *   GPIO5  = CH1 (Z4, opener→receiver) input tap
  *   GPIO6  = 2N7002 MOSFET gate (controls receiver GND path)
+ *   GPIO7/10/0/1/3/2 = optional CH2..CH7 taps (NUM_CH > 2)
  *
- * Each cycle: power off 500ms → power on → capture 12s → parse → JSON output
+ * Each cycle: power off → power on → capture ≤12s → JSON output
+ * Messages are decoded while capturing; the window closes as soon as a
+ * challenge and its response have both been seen, and ADAPTIVE_SCHED
+ * tunes the power-off time and window from observed handshake latency.
  * Stops automatically after 100 good challenge-response pairs.
+ *
+ * MONITOR_MODE=1 instead leaves the receiver powered and streams every
+ * decoded message as a JSON line, plus a periodic status record, for
+ * long soak tests and bus monitoring.  With POS_TRACK each TYPE-B status
+ * message is also decoded on the spot into door state and unwrapped
+ * position (see "Position tracker").
+ *
+ * Output (OUTPUT_BINARY):
+ *   0 = one JSON line per record (original)
+ *   1 = CRC-16 framed binary records, see "Binary framing" below;
+ *       ESP_LOG text still passes through between frames
+ * OUTPUT_UDP=1 sends the binary frames over Wi-Fi instead, batched into
+ * UDP datagrams with SNTP time, see "Network output"; ESP_LOG text
+ * stays on USB.
+ *
+ * Capture backend (CAPTURE_USE_RMT):
+ *   0 = GPIO any-edge ISR, esp_timer timestamp per edge (original path)
+ *   1 = RMT RX hardware pulse capture, 0.5 µs resolution, no per-edge IRQ
+ *
+ * TX_MODE (monitor mode only) drives CH0/CH1 itself with generated or
+ * host-replayed protocol traffic, see "Traffic generator" below.
+ *
+ * XTALK_FILTER drops the few-µs pulses an edge on one tap couples into
+ * the others before they reach the decoder, see "Crosstalk filter".
+ *
+ * NUM_CH (1..8) sets how many input taps are captured.  Only CH0/CH1
+ * carry the handshake; extra channels are recorded for the raw edge
+ * stream (logic-analyzer use) and decoded like any other line.
+ *
+ * A stats record follows every cycle record (and every status record in
+ * monitor mode) with the rig's own health counters, see "Health
+ * counters" below.
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
+#include "soc/gpio_struct.h"
+#include "driver/rmt_rx.h"
+#include "driver/rmt_tx.h"
+#include "driver/usb_serial_jtag.h"
+#include "driver/usb_serial_jtag_vfs.h"
 #include "esp_timer.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/ringbuf.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_netif_sntp.h"
+#include "esp_mac.h"
+#include "nvs_flash.h"
+#include "lwip/sockets.h"
+#include "msg_table.h"          /* generated: python gen_msg_table.py */
 
 /* ── Pin assignments (change if wired differently) ─────────────── */
 #define PIN_CH0       GPIO_NUM_4    /* Z3: receiver → opener */
 #define PIN_CH1       GPIO_NUM_5    /* Z4: opener → receiver */
 #define PIN_MOSFET    GPIO_NUM_6    /* 2N7002 gate            */
+#define PIN_CH2       GPIO_NUM_7    /* spare taps, NUM_CH > 2 */
+#define PIN_CH3       GPIO_NUM_10
+#define PIN_CH4       GPIO_NUM_0
+#define PIN_CH5       GPIO_NUM_1
+#define PIN_CH6       GPIO_NUM_3
+#define PIN_CH7       GPIO_NUM_2    /* strapping pin: keep high at boot */
+
+#define NUM_CH        2             /* input channels, 1..8   */
 
 /* ── Protocol constants ────────────────────────────────────────── */
 #define PWM_UNIT_US   26            /* ~26 µs base time unit  */
@@ -33,60 +97,254 @@
 /* ── Timing ────────────────────────────────────────────────────── */
 #define CAPTURE_MS    12000         /* 12 s capture window    */
 #define POWER_OFF_MS  500           /* 500 ms receiver off    */
-#define SETTLE_MS     2000          /* 2 s between cycles     */
+#define SETTLE_MS     2000          /* 2 s after a missed cycle */
 #define TARGET_GOOD   100           /* stop after this many   */
 
+/* ── Adaptive scheduler ────────────────────────────────────────── */
+#define ADAPTIVE_SCHED     1        /* 0 = fixed timing above      */
+#define POWER_OFF_MIN_MS   100      /* never cut power shorter     */
+#define POWER_OFF_STEP_MS  25       /* shrink per good cycle       */
+#define LAT_BIN_MS         50       /* latency histogram bin width */
+#define LAT_MIN_SAMPLES    8        /* before trimming the window  */
+#define LAT_PCTL           98       /* window covers this pctl     */
+#define LAT_MARGIN_MS      750      /* ...plus this much headroom  */
+
+/* ── Mode ──────────────────────────────────────────────────────── */
+#define MONITOR_MODE       0        /* 1 = continuous bus monitor */
+#define MONITOR_STATUS_MS  5000     /* status record period       */
+#define POS_TRACK          1        /* publish TYPE-B door/position */
+
+/* ── Output format ─────────────────────────────────────────────── */
+#define OUTPUT_BINARY      0        /* 1 = framed binary records   */
+#define OUTPUT_RAW_EDGES   0        /* 1 = stream every edge (binary only) */
+
+/* ── Network output ────────────────────────────────────────────── */
+#define OUTPUT_UDP         0        /* 1 = frames over Wi-Fi/UDP (binary only) */
+#define WIFI_SSID          "garage"
+#define WIFI_PASS          ""
+#define UDP_HOST           "192.168.1.10"   /* collect_multi.py --udp */
+#define UDP_PORT           7030
+#define UDP_MTU            1400     /* datagram size limit         */
+#define UDP_BATCH_MS       20       /* max wait to fill a datagram */
+#define UDP_QUEUE_BYTES    16384    /* frames waiting for the sender */
+#define SNTP_SERVER        "pool.ntp.org"
+
+/* ── Traffic generator ─────────────────────────────────────────── */
+#define TX_MODE            0        /* 0 off, 1 generate, 2 replay from host */
+#define TX_LOOPBACK        1        /* 1 = drive the CH0/CH1 taps themselves */
+#define PIN_TX0            GPIO_NUM_20  /* TX_LOOPBACK 0: outputs to   */
+#define PIN_TX1            GPIO_NUM_21  /* another rig (UART0 pins)    */
+#define TX_GAP_US          12000    /* generator: idle between messages */
+#define TX_LEAD_US         100000   /* replay: first message this far out */
+#define TX_ECHO_WIN_US     200      /* echo start-time tolerance   */
+
+/* ── Crosstalk filter ──────────────────────────────────────────── */
+#define XTALK_FILTER       1        /* 1 = drop coincident sub-unit pulses */
+#define XTALK_FIFO         16       /* edges held for look-ahead; power of two */
+
+/* ── Capture backend ───────────────────────────────────────────── */
+#define CAPTURE_USE_RMT  0          /* 1 = RMT RX, 0 = GPIO ISR */
+
+#if NUM_CH < 1 || NUM_CH > 8
+#error "NUM_CH must be 1..8 (3-bit channel field in the raw edge stream)"
+#endif
+#if CAPTURE_USE_RMT && NUM_CH > 2
+#error "The C3 has two RMT RX channels; use the GPIO ISR backend for NUM_CH > 2"
+#endif
+
+#if CAPTURE_USE_RMT
+#define RMT_RES_HZ     2000000      /* 0.5 µs per tick        */
+#define RMT_FILTER_NS  1000         /* ignore glitches < 1 µs */
+#define RMT_RX_SYMS    (MAX_PAIRS + 16)
+#endif
+
 /* ── Buffers ───────────────────────────────────────────────────── */
-#define RING_SIZE     4096
+#define RING_SIZE     8192          /* must be a power of two */
+#define RING_MASK     (RING_SIZE - 1)
 #define MAX_PAIRS     128
 #define MAX_MSGS      48
+#define ARENA_SIZE    4096          /* message pairs; power of two */
+#define ARENA_MASK    (ARENA_SIZE - 1)
 
 static const char *TAG = "capture";
 
 /* ── Edge event (written by ISR) ───────────────────────────────── */
 typedef struct {
     uint32_t ts;        /* esp_timer_get_time() truncated to 32 bits */
-    uint8_t  ch;        /* 0 or 1 */
+    uint8_t  ch;        /* 0 .. NUM_CH-1 */
     uint8_t  level;     /* gpio level after edge */
 } edge_t;
 
-static edge_t    s_ring[RING_SIZE];
+/*
+ * Single-producer / single-consumer ring.  s_head is only written by the
+ * producer (ISR or RMT task), s_tail only by decode_task.  Both count up
+ * freely and are masked on access, so head - tail is the fill level.
+ * A full ring rejects new edges and counts them in s_overflow rather
+ * than overwriting data the decoder has not seen yet.
+ *
+ * Entries are stored as two arrays, timestamp and (ch << 1) | level,
+ * 5 bytes per edge instead of a padded 8-byte edge_t.
+ */
+_Static_assert((RING_SIZE & RING_MASK) == 0, "RING_SIZE must be a power of two");
+
+static uint32_t  s_ring_ts[RING_SIZE];
+static uint8_t   s_ring_cl[RING_SIZE];
 static volatile uint32_t s_head;
+static volatile uint32_t s_tail;
+static volatile uint32_t s_overflow;
 static volatile bool     s_run;
 
+/* ── Health counters ───────────────────────────────────────────────
+ * What the rig did to the capture, so a MISS can be told apart from a
+ * receiver that never answered.  Counted since the previous stats
+ * record; stats_emit() sends one after every cycle record, and with
+ * every status record in monitor mode.
+ *
+ *   isr_us[b]    GPIO ISR run time (RMT backend: receive-done IRQ to
+ *                rmt_task), < 2^b µs per bucket, the last one open
+ *   eps_max      most edges stamped within one ms
+ *   ring_hwm     ring fill high-water mark, out of RING_SIZE
+ *   msg_full     messages save() dropped: all MAX_MSGS slots or the
+ *                whole ARENA_SIZE in use
+ *   pair_full    pairs cut off messages longer than MAX_PAIRS
+ *   glitch       LOW or HIGH segments shorter than half a symbol unit
+ *                that reached the decoder
+ *   xtalk        pulses the crosstalk filter took out
+ *   proc_us      decode_task time spent draining, and its longest pass
+ *
+ * Edges lost to a full ring are the step in s_overflow.
+ */
+#define STATS_BINS  8
+
+typedef struct {
+    uint16_t isr_us[STATS_BINS];
+    uint16_t eps_max;
+    uint16_t ring_hwm;
+    uint32_t msg_full;
+    uint32_t pair_full;
+    uint32_t glitch;
+    uint32_t xtalk;
+    uint32_t proc_us;
+    uint32_t proc_max_us;
+} stats_t;
+
+static stats_t      s_stats;
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t     s_cpu_mhz;
+
+static inline void IRAM_ATTR stats_time(uint32_t us)
+{
+    int b = us ? 32 - __builtin_clz(us) : 0;
+    if (b >= STATS_BINS) b = STATS_BINS - 1;
+    if (s_stats.isr_us[b] < UINT16_MAX) s_stats.isr_us[b]++;
+}
+
+/* Snapshot and restart the counters; the ISR cannot run in between */
+static void stats_take(stats_t *out)
+{
+    portENTER_CRITICAL(&s_stats_mux);
+    *out = s_stats;
+    memset(&s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_stats_mux);
+}
+
+static const gpio_num_t s_ch_pins[8] = {
+    PIN_CH0, PIN_CH1, PIN_CH2, PIN_CH3, PIN_CH4, PIN_CH5, PIN_CH6, PIN_CH7,
+};
+
 /* ── Parsed message ────────────────────────────────────────────── */
 typedef struct {
     uint8_t  ch;
     uint16_t n;            /* number of (L,H) pairs */
-    uint8_t  L[MAX_PAIRS]; /* LOW durations in symbol units  */
-    uint8_t  H[MAX_PAIRS]; /* HIGH durations in symbol units */
+    uint32_t t;            /* timestamp of first falling edge */
+    uint32_t off;          /* arena offset of the pairs      */
+    uint8_t *L;            /* LOW durations in symbol units  */
+    uint8_t *H;            /* HIGH durations in symbol units */
 } msg_t;
 
 static msg_t s_msgs[MAX_MSGS];
 static int   s_nmsg;
+static uint32_t s_msg_total;        /* messages decoded since boot */
 
-/* ── ISR ───────────────────────────────────────────────────────── */
-static void IRAM_ATTR edge_isr(void *arg)
+/*
+ * Finished messages are posted to s_msg_q as msg_t pointers the moment
+ * they are decoded.  Cycle mode: app_main watches it for the handshake.
+ * Monitor mode: emit_task prints them; s_msgs is then a slot ring and
+ * s_msg_done counts slots handed back, so a slow host drops messages
+ * (s_msg_drop) instead of having their slots overwritten mid-print.
+ */
+static QueueHandle_t     s_msg_q;
+#if MONITOR_MODE
+static volatile uint32_t s_msg_done;
+static uint32_t          s_msg_drop;
+#endif
+
+/* Held by decode_task while draining; others take it to touch state */
+static SemaphoreHandle_t s_dec_lock;
+
+/* ── Ring producer (ISR or RMT task) ───────────────────────────── */
+static inline void IRAM_ATTR ring_push(uint32_t ts, uint8_t ch, uint8_t level)
 {
-    if (!s_run) return;
     uint32_t h = s_head;
-    if (h >= RING_SIZE) return;
+    uint32_t fill = h - s_tail;
+    if (fill >= RING_SIZE) {
+        s_overflow++;
+        return;
+    }
+    if (fill >= s_stats.ring_hwm)
+        s_stats.ring_hwm = (uint16_t)(fill + 1);
+    s_ring_ts[h & RING_MASK] = ts;
+    s_ring_cl[h & RING_MASK] = (uint8_t)(ch << 1 | level);
+    __atomic_thread_fence(__ATOMIC_RELEASE);    /* entry before head */
+    s_head = h + 1;
+}
 
-    uint32_t ch = (uint32_t)arg;
-    gpio_num_t pin = (ch == 0) ? PIN_CH0 : PIN_CH1;
+#if !CAPTURE_USE_RMT
+/* ── ISR ───────────────────────────────────────────────────────────
+ * One raw handler for the whole GPIO bank instead of the per-pin ISR
+ * service: the port is read once per interrupt and every channel that
+ * differs from the previous snapshot gets an edge with the same
+ * timestamp.  Cost is one register read plus one push per changed
+ * line, not a dispatch and gpio_get_level() per pin.
+ *
+ * A line that toggles twice between snapshots (pulse shorter than the
+ * ISR latency) reads unchanged and is dropped as a pair, which keeps
+ * the levels on each channel alternating for the decoder.
+ */
+static uint32_t s_pin_mask;             /* GPIO bits of CH0..NUM_CH-1 */
+static uint32_t s_prev_in;              /* port snapshot at last IRQ  */
+static uint8_t  s_bit_ch[32];           /* GPIO bit → channel         */
 
-    s_ring[h].ts    = (uint32_t)esp_timer_get_time();
-    s_ring[h].ch    = (uint8_t)ch;
-    s_ring[h].level = (uint8_t)gpio_get_level(pin);
-    s_head = h + 1;
+static void IRAM_ATTR edge_isr(void *arg)
+{
+    uint32_t c0 = esp_cpu_get_cycle_count();
+    uint32_t st = GPIO.status.val;
+    GPIO.status_w1tc.val = st;
+
+    uint32_t in = GPIO.in.val;
+    uint32_t ts = (uint32_t)esp_timer_get_time();
+    uint32_t changed = (in ^ s_prev_in) & s_pin_mask;
+    s_prev_in = in;
+    if (!s_run) return;
+
+    while (changed) {
+        int bit = __builtin_ctz(changed);
+        changed &= changed - 1;
+        ring_push(ts, s_bit_ch[bit], (uint8_t)((in >> bit) & 1));
+    }
+    stats_time((esp_cpu_get_cycle_count() - c0) / s_cpu_mhz);
 }
 
-/* ── GPIO setup ────────────────────────────────────────────────── */
-static void hw_init(void)
+static void capture_init(void)
 {
+    for (int c = 0; c < NUM_CH; c++) {
+        s_pin_mask |= 1u << s_ch_pins[c];
+        s_bit_ch[s_ch_pins[c]] = (uint8_t)c;
+    }
+
     /* Input pins: internal pull-up, interrupt on any edge */
     gpio_config_t in = {
-        .pin_bit_mask = (1ULL << PIN_CH0) | (1ULL << PIN_CH1),
+        .pin_bit_mask = s_pin_mask,
         .mode         = GPIO_MODE_INPUT,
         .pull_up_en   = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
@@ -94,6 +352,136 @@ static void hw_init(void)
     };
     gpio_config(&in);
 
+    s_prev_in = GPIO.in.val;
+    gpio_isr_register(edge_isr, NULL, ESP_INTR_FLAG_IRAM, NULL);
+    for (int c = 0; c < NUM_CH; c++)
+        gpio_intr_enable(s_ch_pins[c]);
+}
+
+#else
+/* ── RMT RX backend ────────────────────────────────────────────────
+ * Each channel records pulse widths in hardware.  A receive ends when
+ * the line idles HIGH for GAP_US, so one receive == one message.  The
+ * C3's RMT has no DMA; the driver ping-pongs the 48-word channel RAM
+ * into our buffer, which is one IRQ per ~24 symbols, not per edge.
+ *
+ * Symbols carry durations only.  The done-callback time marks the end
+ * of the idle threshold, so the last rising edge was GAP_US earlier;
+ * every other edge is placed by walking the tick sums backwards from
+ * there.  Ticks are accumulated before converting, so intra-message
+ * timing stays at RMT resolution with no cumulative rounding drift.
+ */
+typedef struct {
+    uint8_t  ch;
+    uint8_t  buf;           /* which half of s_rmt_buf[ch] */
+    uint16_t nsym;
+    uint32_t t_done;        /* esp_timer at receive-done IRQ */
+} rmt_frame_t;
+
+static rmt_channel_handle_t s_rmt_ch[NUM_CH];
+static rmt_symbol_word_t    s_rmt_buf[NUM_CH][2][RMT_RX_SYMS];
+static QueueHandle_t        s_rmt_q;
+
+static const rmt_receive_config_t s_rmt_rx_cfg = {
+    .signal_range_min_ns = RMT_FILTER_NS,
+    .signal_range_max_ns = GAP_US * 1000,
+};
+
+#define TICKS_TO_US(t)  ((uint32_t)(((uint64_t)(t) * 1000000 + RMT_RES_HZ / 2) / RMT_RES_HZ))
+
+static bool IRAM_ATTR rmt_rx_done(rmt_channel_handle_t chan,
+                                  const rmt_rx_done_event_data_t *ev, void *arg)
+{
+    uint32_t ch = (uint32_t)arg;
+    rmt_frame_t f = {
+        .ch     = (uint8_t)ch,
+        .buf    = (uint8_t)(ev->received_symbols != s_rmt_buf[ch][0]),
+        .nsym   = (uint16_t)ev->num_symbols,
+        .t_done = (uint32_t)esp_timer_get_time(),
+    };
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(s_rmt_q, &f, &woken);
+    return woken == pdTRUE;
+}
+
+/* Convert one received frame into edge_t entries for the decoder */
+static void rmt_frame_to_edges(const rmt_frame_t *f)
+{
+    const rmt_symbol_word_t *sym = s_rmt_buf[f->ch][f->buf];
+
+    /* Total ticks up to (not including) the final idle HIGH segment */
+    uint32_t total = 0;
+    for (int i = 0; i < f->nsym; i++) {
+        total += sym[i].duration0;
+        if (i < f->nsym - 1 || sym[i].level1 == 0)
+            total += sym[i].duration1;
+    }
+
+    uint32_t t_last = f->t_done - GAP_US;   /* last rising edge */
+    uint32_t acc = 0;
+
+    for (int i = 0; i < f->nsym; i++) {
+        uint16_t d[2]  = { sym[i].duration0, sym[i].duration1 };
+        uint8_t  lv[2] = { sym[i].level0,    sym[i].level1    };
+        for (int k = 0; k < 2; k++) {
+            ring_push(t_last - TICKS_TO_US(total - acc), f->ch, lv[k]);
+            if (acc >= total) return;           /* idle segment reached */
+            acc += d[k];
+        }
+    }
+}
+
+static void rmt_task(void *arg)
+{
+    rmt_frame_t f;
+    for (;;) {
+        if (xQueueReceive(s_rmt_q, &f, portMAX_DELAY) != pdTRUE) continue;
+
+        /* Re-arm into the other half first; the gap before the next
+         * message is at least GAP_US, so nothing is missed here. */
+        rmt_receive(s_rmt_ch[f.ch], s_rmt_buf[f.ch][f.buf ^ 1],
+                    sizeof(s_rmt_buf[0][0]), &s_rmt_rx_cfg);
+
+        if (s_run) {
+            stats_time((uint32_t)esp_timer_get_time() - f.t_done);
+            rmt_frame_to_edges(&f);
+        }
+    }
+}
+
+static void capture_init(void)
+{
+    const gpio_num_t *pins = s_ch_pins;
+
+    s_rmt_q = xQueueCreate(16, sizeof(rmt_frame_t));
+
+    for (int c = 0; c < NUM_CH; c++) {
+        rmt_rx_channel_config_t cfg = {
+            .gpio_num          = pins[c],
+            .clk_src           = RMT_CLK_SRC_DEFAULT,
+            .resolution_hz     = RMT_RES_HZ,
+            .mem_block_symbols = 48,
+        };
+        ESP_ERROR_CHECK(rmt_new_rx_channel(&cfg, &s_rmt_ch[c]));
+        gpio_pullup_en(pins[c]);
+
+        rmt_rx_event_callbacks_t cbs = { .on_recv_done = rmt_rx_done };
+        ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(s_rmt_ch[c], &cbs,
+                                                        (void *)c));
+        ESP_ERROR_CHECK(rmt_enable(s_rmt_ch[c]));
+        ESP_ERROR_CHECK(rmt_receive(s_rmt_ch[c], s_rmt_buf[c][0],
+                                    sizeof(s_rmt_buf[0][0]), &s_rmt_rx_cfg));
+    }
+
+    xTaskCreate(rmt_task, "rmt_rx", 3072, NULL, configMAX_PRIORITIES - 2, NULL);
+}
+#endif /* CAPTURE_USE_RMT */
+
+/* ── GPIO setup ────────────────────────────────────────────────── */
+static void hw_init(void)
+{
+    s_cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+
     /* MOSFET gate output */
     gpio_config_t out = {
         .pin_bit_mask = (1ULL << PIN_MOSFET),
@@ -105,9 +493,7 @@ static void hw_init(void)
     gpio_config(&out);
     gpio_set_level(PIN_MOSFET, 1);   /* receiver ON at start */
 
-    gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
-    gpio_isr_handler_add(PIN_CH0, edge_isr, (void *)0);
-    gpio_isr_handler_add(PIN_CH1, edge_isr, (void *)1);
+    capture_init();
 }
 
 /* ── Microseconds → symbol unit (rounded) ──────────────────────── */
@@ -117,101 +503,717 @@ static inline uint8_t sym(uint32_t us)
     return s < 1 ? 1 : s;
 }
 
-/* ── Save a finished message ───────────────────────────────────── */
-static void save(int ch, uint8_t *L, uint8_t *H, int n)
+#if !OUTPUT_BINARY
+/* ── Print (L,H) pairs as JSON array ───────────────────────────── */
+static void json_pairs(const msg_t *m)
 {
-    if (n < 2 || s_nmsg >= MAX_MSGS) return;
+    putchar('[');
+    for (int i = 0; i < m->n; i++) {
+        if (i) putchar(',');
+        printf("[%u,%u]", m->L[i], m->H[i]);
+    }
+    putchar(']');
+}
+#endif
+
+/* ── Binary framing ────────────────────────────────────────────────
+ *   A5 5A | type u8 | len u16 | payload[len] | crc16 u16
+ * Little-endian.  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over
+ * type, len and payload.  0xA5 never occurs in ESP_LOG text, so the
+ * host can resync on the sync bytes and reject false hits by CRC.
+ *
+ * Pair lists are a u8 count followed by one byte per pair,
+ * (L << 4) | H, while both fit in 0..14; otherwise the escape byte
+ * 0xFF and then L and H as whole bytes (crosstalk-stretched H values).
+ *
+ * FRAME_POS carries t u32, seq u32, flags u8, door u8, sub u8,
+ * light u8, np u8, the first 5 payload symbols, a u32, b u32, pos i32
+ * (see "Position tracker").
+ *
+ * FRAME_STATS carries seq u32 (cycle number, or status seq in monitor
+ * mode), ms u32 covered, edges u32, dropped u32, eps_max u16,
+ * ring_hwm u16, ring_size u16, msg_full u32, pair_full u32, glitch u32,
+ * xtalk u32, proc_us u32, proc_max_us u32, isr_us u16[8] (see "Health
+ * counters").
+ *
+ * FRAME_CLOCK opens every UDP datagram (OUTPUT_UDP) and carries seq u32
+ * (datagram number), rig u32 (low 3 bytes of the Wi-Fi MAC), up_us u64
+ * (esp_timer) and unix_us u64 (SNTP time at the same instant, 0 until
+ * the first sync).  The host maps every "t" in the datagram to UTC by
+ * its offset from the low 32 bits of up_us.
+ *
+ * FRAME_TX goes the other way, host to device (replay.py), and
+ * carries t u32 (µs since the start of the replay), ch u8, pairs.
+ *
+ * FRAME_EDGES carries t0 u32, seq u32 (ring index of the first edge),
+ * overflow u32, then varints of (delta_us << 4) | (ch << 1) | level,
+ * delta against the previous edge (the first against t0).  A seq gap
+ * means frames were lost on the link; an overflow step means edges
+ * never made it into the ring.
+ *
+ * Each writer task owns its frame_t: s_out belongs to the record writer
+ * (app_main in cycle mode, emit_task in monitor mode), s_efr to
+ * decode_task.  A frame goes out in one driver write (or one ring
+ * buffer item with OUTPUT_UDP), so frames from the two never
+ * interleave.
+ */
+#define FRAME_CYCLE    0x01
+#define FRAME_MSG      0x02
+#define FRAME_STATUS   0x03
+#define FRAME_EDGES    0x04
+#define FRAME_POS      0x05
+#define FRAME_STATS    0x06
+#define FRAME_CLOCK    0x07         /* OUTPUT_UDP datagram header */
+#define FRAME_TX       0x10         /* host → device, TX_MODE 2 */
+
+#define FRAME_MAX      1024
+#define PAIR_ESC       0xFF
+
+#if OUTPUT_BINARY || TX_MODE == 2
+static uint16_t crc16_ccitt(const uint8_t *p, size_t n)
+{
+    uint16_t crc = 0xFFFF;
+    while (n--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+#endif
+
+#if OUTPUT_BINARY
+typedef struct {
+    uint8_t  buf[FRAME_MAX];
+    uint16_t len;               /* 0 = no frame open */
+} frame_t;
+
+static frame_t s_out;
+
+static inline void put_u8(frame_t *f, uint8_t v)   { f->buf[f->len++] = v; }
+static inline void put_u16(frame_t *f, uint16_t v) { put_u8(f, v); put_u8(f, v >> 8); }
+static inline void put_u32(frame_t *f, uint32_t v) { put_u16(f, v); put_u16(f, v >> 16); }
+static inline void put_u64(frame_t *f, uint64_t v) { put_u32(f, v); put_u32(f, v >> 32); }
+
+#if OUTPUT_RAW_EDGES
+static void put_varint(frame_t *f, uint64_t v)
+{
+    while (v >= 0x80) {
+        put_u8(f, (uint8_t)v | 0x80);
+        v >>= 7;
+    }
+    put_u8(f, (uint8_t)v);
+}
+#endif
+
+static void put_pairs(frame_t *f, const msg_t *m)
+{
+    if (!m) { put_u8(f, 0); return; }
+    put_u8(f, (uint8_t)m->n);
+    for (int i = 0; i < m->n; i++) {
+        if (m->L[i] < 15 && m->H[i] < 15) {
+            put_u8(f, (uint8_t)(m->L[i] << 4 | m->H[i]));
+        } else {
+            put_u8(f, PAIR_ESC);
+            put_u8(f, m->L[i]);
+            put_u8(f, m->H[i]);
+        }
+    }
+}
+
+static void frame_begin(frame_t *f, uint8_t type)
+{
+    f->buf[0] = 0xA5;
+    f->buf[1] = 0x5A;
+    f->buf[2] = type;
+    f->len    = 5;              /* len filled in by frame_end() */
+}
+
+static void frame_seal(frame_t *f)
+{
+    uint16_t len = f->len - 5;
+    f->buf[3] = (uint8_t)len;
+    f->buf[4] = (uint8_t)(len >> 8);
+    put_u16(f, crc16_ccitt(&f->buf[2], f->len - 2));
+}
+
+#if OUTPUT_UDP
+static RingbufHandle_t s_udp_rb;    /* sealed frames → udp_task */
+#endif
+
+/* Seal and send; returns false if the host did not drain it in time */
+static bool frame_end(frame_t *f, TickType_t wait)
+{
+    frame_seal(f);
+#if OUTPUT_UDP
+    bool sent = xRingbufferSend(s_udp_rb, f->buf, f->len, wait) == pdTRUE;
+#else
+    int n = usb_serial_jtag_write_bytes(f->buf, f->len, wait);
+    bool sent = (n == f->len);
+#endif
+    f->len = 0;
+    return sent;
+}
+
+/* Worst case: a cycle frame with two fully escaped pair lists is
+ * 23 + 2 * (1 + 3 * MAX_PAIRS) bytes.  One edge varint is ≤ 6 bytes. */
+_Static_assert(5 + 23 + 2 * (1 + 3 * MAX_PAIRS) + 2 <= FRAME_MAX,
+               "FRAME_MAX too small for a cycle frame");
+#define EDGE_MAX_BYTES   6
+#endif /* OUTPUT_BINARY */
+
+#if OUTPUT_BINARY || TX_MODE == 2
+static void output_init(void)
+{
+    /* Frames go straight to the driver, bypassing newline translation;
+     * pointing the console VFS at the same driver keeps ESP_LOG lines
+     * from being spliced into the middle of a frame.  Replay frames
+     * from the host are read from the same driver. */
+    usb_serial_jtag_driver_config_t cfg = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+    cfg.tx_buffer_size = 8192;
+    cfg.rx_buffer_size = 4096;
+    ESP_ERROR_CHECK(usb_serial_jtag_driver_install(&cfg));
+    usb_serial_jtag_vfs_use_driver();
+}
+#else
+static void output_init(void) {}
+#endif
+
+_Static_assert(!OUTPUT_RAW_EDGES || OUTPUT_BINARY,
+               "OUTPUT_RAW_EDGES needs OUTPUT_BINARY");
+_Static_assert(!TX_MODE || MONITOR_MODE, "TX_MODE needs MONITOR_MODE");
+_Static_assert(!OUTPUT_UDP || OUTPUT_BINARY, "OUTPUT_UDP needs OUTPUT_BINARY");
+
+/* ── Raw edge stream ───────────────────────────────────────────────
+ * decode_task copies every edge it drains into s_efr before decoding
+ * it, so the host sees the full edge sequence no matter how long the
+ * capture runs or how small the ring is.  A frame is sent when full or
+ * STREAM_FLUSH_MS after it was opened.  If the host stops reading, the
+ * frame is dropped after STREAM_WAIT_MS instead of stalling the decoder
+ * (the seq gap shows it on the host); ring overflow is still counted.
+ */
+#if OUTPUT_RAW_EDGES
+#define STREAM_FLUSH_MS  20
+#define STREAM_WAIT_MS   50
+
+static frame_t  s_efr;
+static uint32_t s_efr_prev;         /* ts of last edge in s_efr     */
+static uint32_t s_efr_open;         /* esp_timer ms when it opened  */
+static uint32_t s_stream_drop;      /* edge frames the host missed  */
+
+static void stream_flush(void)
+{
+    if (s_efr.len && !frame_end(&s_efr, pdMS_TO_TICKS(STREAM_WAIT_MS)))
+        s_stream_drop++;
+}
+
+static void stream_edge(uint32_t seq, const edge_t *e, uint32_t now_ms)
+{
+    if (s_efr.len == 0) {
+        frame_begin(&s_efr, FRAME_EDGES);
+        put_u32(&s_efr, e->ts);
+        put_u32(&s_efr, seq);
+        put_u32(&s_efr, s_overflow);
+        s_efr_prev = e->ts;
+        s_efr_open = now_ms;
+    }
+    put_varint(&s_efr, (uint64_t)(e->ts - s_efr_prev) << 4 | e->ch << 1 | e->level);
+    s_efr_prev = e->ts;
+
+    if (s_efr.len + EDGE_MAX_BYTES + 2 > FRAME_MAX)
+        stream_flush();
+}
+#endif
+
+/* ── Stats record ──────────────────────────────────────────────── */
+static void stats_emit(uint32_t seq)
+{
+    static uint32_t head0, ovf0;
+    static int64_t  t0;
+
+    stats_t st;
+    stats_take(&st);
+    int64_t  now  = esp_timer_get_time();
+    uint32_t head = s_head, ovf = s_overflow;
+    uint32_t ms   = (uint32_t)((now - t0) / 1000);
+    uint32_t edges = head - head0, dropped = ovf - ovf0;
+    head0 = head;
+    ovf0  = ovf;
+    t0    = now;
+
+#if OUTPUT_BINARY
+    frame_t *f = &s_out;
+    frame_begin(f, FRAME_STATS);
+    put_u32(f, seq);
+    put_u32(f, ms);
+    put_u32(f, edges);
+    put_u32(f, dropped);
+    put_u16(f, st.eps_max);
+    put_u16(f, st.ring_hwm);
+    put_u16(f, RING_SIZE);
+    put_u32(f, st.msg_full);
+    put_u32(f, st.pair_full);
+    put_u32(f, st.glitch);
+    put_u32(f, st.xtalk);
+    put_u32(f, st.proc_us);
+    put_u32(f, st.proc_max_us);
+    for (int b = 0; b < STATS_BINS; b++)
+        put_u16(f, st.isr_us[b]);
+    frame_end(f, portMAX_DELAY);
+#else
+    printf("{\"stats\":%lu,\"ms\":%lu,\"edges\":%lu,\"dropped\":%lu,"
+           "\"eps_max\":%u,\"ring_hwm\":%u,\"ring_size\":%d,"
+           "\"msg_full\":%lu,\"pair_full\":%lu,\"glitch\":%lu,\"xtalk\":%lu,"
+           "\"proc_us\":%lu,\"proc_max_us\":%lu,\"isr_us\":[",
+           (unsigned long)seq, (unsigned long)ms, (unsigned long)edges,
+           (unsigned long)dropped, st.eps_max, st.ring_hwm, RING_SIZE,
+           (unsigned long)st.msg_full, (unsigned long)st.pair_full,
+           (unsigned long)st.glitch, (unsigned long)st.xtalk,
+           (unsigned long)st.proc_us, (unsigned long)st.proc_max_us);
+    for (int b = 0; b < STATS_BINS; b++)
+        printf(b ? ",%u" : "%u", st.isr_us[b]);
+    printf("]}\n");
+    fflush(stdout);
+#endif
+}
+
+/* ── Streaming decoder: edges → messages ───────────────────────────
+ * Per-channel edge-walking state lives across calls so decode_task can
+ * feed edges as they arrive.  Callers other than decode_task must hold
+ * s_dec_lock.
+ */
+static struct {
+    uint32_t lo_t;          /* timestamp of last falling edge  */
+    uint32_t hi_t;          /* timestamp of last rising edge   */
+    uint32_t t0;            /* first falling edge of message   */
+    bool     in_lo;
+    bool     in_hi;
+    int      idx;
+    uint32_t off;           /* arena region being written ...  */
+    uint8_t *L, *H;         /* ... NULL = none (arena full)    */
+} s_st[NUM_CH];
+
+/* ── Message arena ─────────────────────────────────────────────────
+ * The L and H bytes of decoded messages live in two parallel arenas,
+ * n bytes each per message instead of a fixed MAX_PAIRS.  A channel
+ * reserves MAX_PAIRS at the top when its message starts and the decoder
+ * writes pairs straight into place; save() hands the region to the
+ * msg_t and gives the unused tail back when it is still the topmost
+ * reservation (the usual case; messages on different channels rarely
+ * overlap), leaving a hole otherwise.  Offsets count up freely and are
+ * masked on access like the edge ring; a reservation that would run
+ * past the end starts at offset 0 instead.
+ *
+ * Cycle mode resets the arena with the decoder every cycle.  In monitor
+ * mode it is a ring: the space behind the oldest region still in use,
+ * a message emit_task has not handed back or one still being decoded,
+ * is free.
+ */
+_Static_assert((ARENA_SIZE & ARENA_MASK) == 0, "ARENA_SIZE must be a power of two");
+_Static_assert(ARENA_SIZE >= 2 * NUM_CH * MAX_PAIRS, "ARENA_SIZE too small");
+
+static uint8_t  s_arena_L[ARENA_SIZE];
+static uint8_t  s_arena_H[ARENA_SIZE];
+static uint32_t s_arena_top;
+
+/* Offset of the oldest region in use (s_arena_top if none) */
+static uint32_t arena_tail(void)
+{
+    uint32_t top = s_arena_top, tail = top;
+#if MONITOR_MODE
+    for (uint32_t i = s_msg_done; i != s_msg_total; i++) {
+        uint32_t off = s_msgs[i % MAX_MSGS].off;
+#else
+    for (int i = 0; i < s_nmsg; i++) {
+        uint32_t off = s_msgs[i].off;
+#endif
+        if (top - off > top - tail) tail = off;
+    }
+    for (int c = 0; c < NUM_CH; c++)
+        if (s_st[c].L && top - s_st[c].off > top - tail) tail = s_st[c].off;
+    return tail;
+}
+
+/* Reserve room for channel c's next message; leaves L NULL if full */
+static void arena_open(int c)
+{
+    uint32_t top = s_arena_top;
+    if ((top & ARENA_MASK) + MAX_PAIRS > ARENA_SIZE)
+        top += ARENA_SIZE - (top & ARENA_MASK);
+    if (top + MAX_PAIRS - arena_tail() > ARENA_SIZE)
+        return;
+    s_arena_top = top + MAX_PAIRS;
+    s_st[c].off = top;
+    s_st[c].L   = &s_arena_L[top & ARENA_MASK];
+    s_st[c].H   = &s_arena_H[top & ARENA_MASK];
+}
+
+/* ── Save a finished message ───────────────────────────────────────
+ * Hands channel c's arena region over to a msg_t.  A message that is
+ * dropped (or too short to count) leaves the region with the channel,
+ * to be written over by its next message.
+ */
+static void save(int c)
+{
+    int n = s_st[c].idx;
+    if (n < 2) return;
+#if MONITOR_MODE
+    if (s_msg_total - s_msg_done >= MAX_MSGS || !s_st[c].L) {
+        s_msg_drop++;
+        s_stats.msg_full++;
+        return;
+    }
+    msg_t *m = &s_msgs[s_msg_total % MAX_MSGS];
+#else
+    if (s_nmsg >= MAX_MSGS || !s_st[c].L) {
+        s_stats.msg_full++;
+        return;
+    }
     msg_t *m = &s_msgs[s_nmsg++];
-    m->ch = (uint8_t)ch;
-    m->n  = (uint16_t)n;
-    memcpy(m->L, L, n);
-    memcpy(m->H, H, n);
+#endif
+    s_msg_total++;
+    m->ch  = (uint8_t)c;
+    m->n   = (uint16_t)n;
+    m->t   = s_st[c].t0;
+    m->off = s_st[c].off;
+    m->L   = s_st[c].L;
+    m->H   = s_st[c].H;
+    if (s_arena_top == s_st[c].off + MAX_PAIRS)
+        s_arena_top = s_st[c].off + n;
+    s_st[c].L = s_st[c].H = NULL;
+    xQueueSend(s_msg_q, &m, 0);
 }
 
-/* ── Process ring buffer → messages ────────────────────────────── */
-static void process(void)
+static void decode_edge(const edge_t *e)
 {
-    s_nmsg = 0;
-    uint32_t cnt = s_head;
-
-    /* Per-channel edge-walking state */
-    struct {
-        uint32_t lo_t;          /* timestamp of last falling edge  */
-        uint32_t hi_t;          /* timestamp of last rising edge   */
-        bool     in_lo;
-        bool     in_hi;
-        int      idx;
-        uint8_t  L[MAX_PAIRS];
-        uint8_t  H[MAX_PAIRS];
-    } st[2];
-    memset(st, 0, sizeof(st));
-
-    for (uint32_t i = 0; i < cnt; i++) {
-        int      c  = s_ring[i].ch;
-        uint32_t ts = s_ring[i].ts;
-        int      lv = s_ring[i].level;
-
-        if (lv == 0) {                              /* ── falling edge ── */
-            if (st[c].in_hi) {
-                uint32_t dur = ts - st[c].hi_t;
-                if (dur > GAP_US) {
-                    save(c, st[c].L, st[c].H, st[c].idx);
-                    st[c].idx = 0;
-                } else if (st[c].idx > 0) {
-                    st[c].H[st[c].idx - 1] = sym(dur);
-                }
-                st[c].in_hi = false;
+    int      c  = e->ch;
+    uint32_t ts = e->ts;
+
+    if (e->level == 0) {                        /* ── falling edge ── */
+        if (s_st[c].in_hi) {
+            uint32_t dur = ts - s_st[c].hi_t;
+            if (dur < PWM_UNIT_US / 2) s_stats.glitch++;
+            if (dur > GAP_US) {
+                save(c);
+                s_st[c].idx = 0;
+            } else if (s_st[c].idx > 0 && s_st[c].L) {
+                s_st[c].H[s_st[c].idx - 1] = sym(dur);
             }
-            st[c].lo_t  = ts;
-            st[c].in_lo = true;
-
-        } else {                                    /* ── rising edge ── */
-            if (st[c].in_lo && st[c].idx < MAX_PAIRS) {
-                st[c].L[st[c].idx] = sym(ts - st[c].lo_t);
-                st[c].H[st[c].idx] = 0;
-                st[c].idx++;
-                st[c].in_lo = false;
+            s_st[c].in_hi = false;
+        }
+        if (s_st[c].idx == 0) {
+            s_st[c].t0 = ts;
+            if (!s_st[c].L) arena_open(c);
+        }
+        s_st[c].lo_t  = ts;
+        s_st[c].in_lo = true;
+
+    } else {                                    /* ── rising edge ── */
+        if (s_st[c].in_lo && ts - s_st[c].lo_t < PWM_UNIT_US / 2)
+            s_stats.glitch++;
+        if (s_st[c].in_lo && s_st[c].idx == MAX_PAIRS)
+            s_stats.pair_full++;
+        if (s_st[c].in_lo && s_st[c].idx < MAX_PAIRS) {
+            if (s_st[c].L) {
+                s_st[c].L[s_st[c].idx] = sym(ts - s_st[c].lo_t);
+                s_st[c].H[s_st[c].idx] = 0;
             }
-            st[c].hi_t  = ts;
-            st[c].in_hi = true;
+            s_st[c].idx++;
+            s_st[c].in_lo = false;
         }
+        s_st[c].hi_t  = ts;
+        s_st[c].in_hi = true;
     }
+}
 
-    /* Flush anything left over */
-    for (int c = 0; c < 2; c++)
-        if (st[c].idx > 0)
-            save(c, st[c].L, st[c].H, st[c].idx);
+/* Close messages whose line has idled HIGH past the GAP_US boundary */
+static void decode_idle(uint32_t now)
+{
+    for (int c = 0; c < NUM_CH; c++) {
+        if (s_st[c].idx > 0 && s_st[c].in_hi &&
+            (int32_t)(now - s_st[c].hi_t) > GAP_US) {
+            save(c);
+            s_st[c].idx = 0;
+        }
+    }
 }
 
-/* ── Header match (L-values only, same as analyze.py) ──────────── */
-static bool hdr_match(const msg_t *m, const uint8_t *hdr, int len)
+/* ── Crosstalk filter ──────────────────────────────────────────────
+ * An edge on one tap couples into the others as a pulse of a few µs,
+ * which the decoder would take for a symbol (the junk CH0 bursts and
+ * stray trailing pairs analyze.py used to report).  Same rule as
+ * analyze.suppress_crosstalk, on the constants in msg_table.h: a pulse
+ * shorter than XTALK_GLITCH_US is dropped, both edges, when another
+ * channel has an edge from XTALK_WIN_US before it starts to
+ * XTALK_WIN_US after it ends.  Short pulses on a quiet bus are real
+ * (BEACON) and pass.
+ *
+ * That takes XTALK_HOLD_US of look-ahead, so edges wait in s_xt until
+ * a newer edge or decode_task's clock is past it; messages come out of
+ * the decoder that much later.  Needs the ring in time order across
+ * channels, which only the GPIO ISR backend gives: the RMT backend
+ * delivers each channel a whole message at a time, so there only
+ * RMT_FILTER_NS (pulses under 1 µs) applies.  The raw edge stream is
+ * taken before the filter; analyze.py applies the same rule to it.
+ */
+#define XTALK_ON  (XTALK_FILTER && !CAPTURE_USE_RMT)
+
+#if XTALK_ON
+#define XTALK_HOLD_US  (XTALK_GLITCH_US + XTALK_WIN_US)
+#define XTALK_MASK     (XTALK_FIFO - 1)
+_Static_assert((XTALK_FIFO & XTALK_MASK) == 0, "XTALK_FIFO must be a power of two");
+
+static edge_t   s_xt[XTALK_FIFO];
+static bool     s_xt_drop[XTALK_FIFO];  /* second edge of a dropped pulse */
+static uint32_t s_xt_head, s_xt_tail;
+static uint32_t s_xt_last[NUM_CH];      /* last edge released, per channel */
+static uint8_t  s_xt_seen;              /* channels with an s_xt_last */
+
+/* Does a channel other than c have an edge in [t0 - WIN, t1 + WIN]? */
+static bool xtalk_coincident(int c, uint32_t t0, uint32_t t1)
 {
-    if (m->n < len) return false;
-    for (int i = 0; i < len; i++)
-        if (m->L[i] != hdr[i]) return false;
-    return true;
+    for (int o = 0; o < NUM_CH; o++)
+        if (o != c && (s_xt_seen >> o & 1) && t0 - s_xt_last[o] <= XTALK_WIN_US)
+            return true;
+    for (uint32_t j = s_xt_tail; j != s_xt_head; j++) {
+        const edge_t *x = &s_xt[j & XTALK_MASK];
+        if ((int32_t)(x->ts - t1) > XTALK_WIN_US) break;
+        if (x->ch != c) return true;
+    }
+    return false;
 }
 
-/* ── Print (L,H) pairs as JSON array ───────────────────────────── */
-static void json_pairs(const msg_t *m)
+/* Decode the oldest held edge, unless it starts or ends a crosstalk pulse */
+static void xtalk_release(void)
 {
-    putchar('[');
-    for (int i = 0; i < m->n; i++) {
-        if (i) putchar(',');
-        printf("[%u,%u]", m->L[i], m->H[i]);
+    uint32_t i = s_xt_tail++ & XTALK_MASK;
+    edge_t   a = s_xt[i];
+    bool     drop = s_xt_drop[i];
+
+    for (uint32_t j = s_xt_tail; !drop && j != s_xt_head; j++) {
+        uint32_t k = j & XTALK_MASK;
+        if (s_xt[k].ch != a.ch) continue;
+        if (s_xt[k].ts - a.ts < XTALK_GLITCH_US &&
+            xtalk_coincident(a.ch, a.ts, s_xt[k].ts)) {
+            s_xt_drop[k] = true;
+            s_stats.xtalk++;
+            drop = true;
+        }
+        break;
     }
-    putchar(']');
+    s_xt_last[a.ch] = a.ts;
+    s_xt_seen |= 1u << a.ch;
+    if (!drop)
+        decode_edge(&a);
+}
+
+static void xtalk_edge(const edge_t *e)
+{
+    while (s_xt_head != s_xt_tail &&
+           (s_xt_head - s_xt_tail == XTALK_FIFO ||
+            (int32_t)(e->ts - s_xt[s_xt_tail & XTALK_MASK].ts) > XTALK_HOLD_US))
+        xtalk_release();
+    uint32_t i = s_xt_head++ & XTALK_MASK;
+    s_xt[i] = *e;
+    s_xt_drop[i] = false;
+}
+
+/* Release what no edge still in flight can pair with; all if flush */
+static void xtalk_idle(uint32_t now, bool flush)
+{
+    while (s_xt_head != s_xt_tail &&
+           (flush || (int32_t)(now - s_xt[s_xt_tail & XTALK_MASK].ts) > XTALK_HOLD_US))
+        xtalk_release();
 }
 
-/* ── Headers for handshake messages (L-values) ─────────────────── */
-static const uint8_t HDR_CMD_B_INIT[] = {1,7,3,4,1,4,1,9};  /* 8 syms */
-static const uint8_t HDR_HANDSHAKE_E[] = {1,7,4,4,2,3,1,9};  /* 8 syms */
+static void xtalk_reset(void)
+{
+    s_xt_tail = s_xt_head;
+    s_xt_seen = 0;
+}
+#else
+static inline void xtalk_edge(const edge_t *e)          { decode_edge(e); }
+static inline void xtalk_idle(uint32_t now, bool flush) {}
+static inline void xtalk_reset(void)                    {}
+#endif /* XTALK_ON */
+
+static void decode_reset(void)
+{
+    memset(s_st, 0, sizeof(s_st));
+    s_arena_top = 0;
+    s_nmsg = 0;
+    s_tail = s_head;                    /* discard anything unread */
+    xtalk_reset();
+    xQueueReset(s_msg_q);
+}
+
+#if !MONITOR_MODE
+/* Flush anything left over */
+static void decode_flush(void)
+{
+    xtalk_idle(0, true);
+    for (int c = 0; c < NUM_CH; c++) {
+        if (s_st[c].idx > 0)
+            save(c);
+        s_st[c].idx = 0;
+    }
+}
+#endif
+
+/* Edges-per-ms peak; the ring is close enough to time order for it */
+static void stats_edge(const edge_t *e)
+{
+    static uint32_t ms, n;
+    if (e->ts / 1000 != ms) {
+        ms = e->ts / 1000;
+        n  = 0;
+    }
+    if (++n > s_stats.eps_max)
+        s_stats.eps_max = (uint16_t)(n < UINT16_MAX ? n : UINT16_MAX);
+}
+
+/* Drain the ring continuously; capture never has to stop for this */
+static void decode_task(void *arg)
+{
+    for (;;) {
+        /* Sample the clock before head: every edge older than `now` is
+         * already in the ring, so the idle check cannot race an edge. */
+        uint32_t now = (uint32_t)esp_timer_get_time();
+
+        xSemaphoreTake(s_dec_lock, portMAX_DELAY);
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        uint32_t h = s_head;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);    /* head before entries */
+        while (s_tail != h) {
+            uint32_t i = s_tail & RING_MASK;
+            const edge_t e = {
+                .ts = s_ring_ts[i], .ch = s_ring_cl[i] >> 1, .level = s_ring_cl[i] & 1,
+            };
+            stats_edge(&e);
+#if OUTPUT_RAW_EDGES
+            stream_edge(s_tail, &e, now / 1000);
+#endif
+            xtalk_edge(&e);
+            s_tail = s_tail + 1;
+        }
+        xtalk_idle(now, false);
+        decode_idle(now);
+#if OUTPUT_RAW_EDGES
+        if (s_efr.len && now / 1000 - s_efr_open >= STREAM_FLUSH_MS)
+            stream_flush();
+#endif
+        uint32_t us = (esp_cpu_get_cycle_count() - c0) / s_cpu_mhz;
+        s_stats.proc_us += us;
+        if (us > s_stats.proc_max_us) s_stats.proc_max_us = us;
+        xSemaphoreGive(s_dec_lock);
+        vTaskDelay(1);
+    }
+}
+
+#if !MONITOR_MODE
+/* ── Message classification (L-values only, same as analyze.py) ──
+ * msg_classify() walks the generated trie in msg_table.h once per
+ * message; the patterns live in analyze.py.
+ */
 
 /* CMD-B-INIT short form has ≤22 pairs; long form (challenge) has >22 */
 #define CMD_B_INIT_LONG_THRESH  22
 
-/* ── Find handshake pair and emit JSON ─────────────────────────── */
-static bool emit_json(int cycle)
+/* CMD-B-INIT long form on CH0 */
+static bool is_challenge(const msg_t *m)
+{
+    return m->ch == 0 && m->n > CMD_B_INIT_LONG_THRESH &&
+           msg_classify(0, m->L, m->n) == MSG_CMD_B_INIT;
+}
+
+/* HANDSHAKE-E on CH1 */
+static bool is_response(const msg_t *m)
+{
+    return m->ch == 1 && msg_classify(1, m->L, m->n) == MSG_HANDSHAKE_E;
+}
+
+/* ── Adaptive cycle scheduler ──────────────────────────────────────
+ * Learns how long after power-on the handshake completes and trims the
+ * capture window to a high percentile of that (plus margin), so dead
+ * cycles give up early.  Power-off time walks down while cycles succeed
+ * and doubles on a miss (receiver did not fully reset), settling near
+ * the shortest off time that still produces a clean boot handshake.
+ */
+#define LAT_BINS  (CAPTURE_MS / LAT_BIN_MS + 1)
+
+typedef struct {
+    int      cycle;
+    uint32_t off_ms;        /* power-off time used this cycle      */
+    uint32_t window_ms;     /* capture window allowed              */
+    uint32_t ms;            /* capture window actually used        */
+    uint32_t lat_ms;        /* power-on → response, 0 if none      */
+    uint32_t edges;
+    uint32_t overflow;
+} cycle_t;
+
+static struct {
+    uint16_t hist[LAT_BINS];
+    uint32_t n;             /* latency samples in hist             */
+    uint32_t off_ms;
+    bool     full_next;     /* last trimmed cycle missed: probe full */
+    int64_t  t_start;
+    int      good;
+} s_sched;
+
+static void sched_init(void)
+{
+    memset(&s_sched, 0, sizeof(s_sched));
+    s_sched.off_ms  = POWER_OFF_MS;
+    s_sched.t_start = esp_timer_get_time();
+}
+
+static uint32_t sched_window_ms(void)
+{
+    if (!ADAPTIVE_SCHED || s_sched.n < LAT_MIN_SAMPLES || s_sched.full_next)
+        return CAPTURE_MS;
+
+    uint32_t need = (s_sched.n * LAT_PCTL + 99) / 100, acc = 0;
+    for (int b = 0; b < LAT_BINS; b++) {
+        acc += s_sched.hist[b];
+        if (acc >= need) {
+            uint32_t w = (b + 1) * LAT_BIN_MS + LAT_MARGIN_MS;
+            return w < CAPTURE_MS ? w : CAPTURE_MS;
+        }
+    }
+    return CAPTURE_MS;
+}
+
+static void sched_update(const cycle_t *c, bool ok)
+{
+    if (ok) {
+        s_sched.good++;
+        uint32_t b = c->lat_ms / LAT_BIN_MS;
+        s_sched.hist[b < LAT_BINS ? b : LAT_BINS - 1]++;
+        s_sched.n++;
+    }
+    if (!ADAPTIVE_SCHED) return;
+
+    s_sched.full_next = !ok && c->window_ms < CAPTURE_MS;
+    if (ok) {
+        if (s_sched.off_ms > POWER_OFF_MIN_MS + POWER_OFF_STEP_MS)
+            s_sched.off_ms -= POWER_OFF_STEP_MS;
+        else
+            s_sched.off_ms = POWER_OFF_MIN_MS;
+    } else {
+        s_sched.off_ms *= 2;
+        if (s_sched.off_ms > POWER_OFF_MS) s_sched.off_ms = POWER_OFF_MS;
+    }
+}
+
+/* Good pairs per minute since the loop started, ×10 */
+static uint32_t sched_rate_x10(void)
+{
+    int64_t ms = (esp_timer_get_time() - s_sched.t_start) / 1000;
+    return ms > 0 ? (uint32_t)(s_sched.good * 600000LL / ms) : 0;
+}
+
+/* ── Find handshake pair and emit the cycle record ─────────────── */
+static bool emit_cycle(const cycle_t *c)
 {
     const msg_t *challenge = NULL;
     const msg_t *response  = NULL;
@@ -219,75 +1221,962 @@ static bool emit_json(int cycle)
     for (int i = 0; i < s_nmsg; i++) {
         msg_t *m = &s_msgs[i];
 
-        /* CMD-B-INIT long form on CH0 (take last match — it's the challenge) */
-        if (m->ch == 0 && m->n > CMD_B_INIT_LONG_THRESH &&
-            hdr_match(m, HDR_CMD_B_INIT, sizeof(HDR_CMD_B_INIT)))
-            challenge = m;
-
-        /* HANDSHAKE-E on CH1 */
-        if (m->ch == 1 &&
-            hdr_match(m, HDR_HANDSHAKE_E, sizeof(HDR_HANDSHAKE_E)))
-            response = m;
+        /* Take last match — the final CMD-B-INIT is the challenge */
+        if (is_challenge(m)) challenge = m;
+        if (is_response(m))  response  = m;
     }
 
     bool ok = (challenge != NULL) && (response != NULL);
 
-    printf("{\"cycle\":%d,\"edges\":%lu,\"msgs\":%d",
-           cycle, (unsigned long)s_head, s_nmsg);
+#if OUTPUT_BINARY
+    frame_t *f = &s_out;
+    frame_begin(f, FRAME_CYCLE);
+    put_u16(f, (uint16_t)c->cycle);
+    put_u16(f, (uint16_t)c->ms);
+    put_u16(f, (uint16_t)c->lat_ms);
+    put_u16(f, (uint16_t)c->off_ms);
+    put_u16(f, (uint16_t)c->window_ms);
+    put_u32(f, c->edges);
+    put_u16(f, (uint16_t)s_nmsg);
+    put_u32(f, c->overflow);
+    put_u8(f, ok);
+    put_pairs(f, challenge);
+    put_pairs(f, response);
+    frame_end(f, portMAX_DELAY);
+#else
+    printf("{\"cycle\":%d,\"ms\":%lu,\"edges\":%lu,\"msgs\":%d",
+           c->cycle, (unsigned long)c->ms, (unsigned long)c->edges, s_nmsg);
+    if (c->overflow) printf(",\"overflow\":%lu", (unsigned long)c->overflow);
     if (challenge) { printf(",\"challenge\":"); json_pairs(challenge); }
     if (response)  { printf(",\"response\":");  json_pairs(response);  }
+    if (ok) printf(",\"lat\":%lu", (unsigned long)c->lat_ms);
+    printf(",\"off\":%lu,\"win\":%lu",
+           (unsigned long)c->off_ms, (unsigned long)c->window_ms);
     printf(",\"ok\":%s}\n", ok ? "true" : "false");
     fflush(stdout);
+#endif
 
     return ok;
 }
 
+#endif /* !MONITOR_MODE */
+
+/* ── Position tracker ──────────────────────────────────────────────
+ * Decodes each TYPE-B status message as it arrives, the same way as
+ * analyze.decode_type_b_state / decode_type_b_position.  After the
+ * 8-symbol header, payload L-symbols 0-1 are the door state, 2-4 the
+ * sub-state and 1-4 the light (door closed only); from 5 on comes a
+ * prefix (1,7 or 9), data_A, a (7,9) or (9,9) delimiter, then data_B,
+ * each data field an active-low LSB-first bit run.
+ *
+ * data_B is a 9-bit position counter; it is unwrapped across the
+ * mod-512 rollover like binary_decode.unwrap_positions.  data_A
+ * carries the same counter plus a constant, either in its low bits or
+ * from bit 10 up (captures show both), so (A >> s) - B mod 512 stays
+ * put from one message to the next for s = 0 or 10.  Each message is
+ * checked against the last good one with the same delimiter; one that
+ * disagrees is published as "bad" and kept out of the unwrap, and the
+ * reference only moves on when two messages in a row agree on a new
+ * relation.
+ */
+#if MONITOR_MODE && POS_TRACK
+#define POS_MOD        512
+#define POS_A          0x01     /* data_A decoded                */
+#define POS_B          0x02     /* data_B decoded                */
+#define POS_VALID      0x04     /* pos holds the unwrapped data_B */
+#define POS_LEARN      0x08     /* A/B reference (re)set here    */
+#define POS_CHECK_OK   0x10     /* data_A agrees with data_B     */
+#define POS_CHECK_BAD  0x20     /* ... or does not               */
+
+typedef struct {
+    uint32_t t;
+    uint8_t  flags;
+    uint8_t  door, sub, light;  /* TB_* index, TB_*_NONE = unknown */
+    uint8_t  np;                /* payload symbols, capped at 5    */
+    uint8_t  p[5];              /* ... to name unknown states      */
+    uint32_t a, b;              /* raw data_A / data_B values      */
+    int32_t  pos;
+} pos_rec_t;
+
+typedef struct {
+    bool     have_ref, have_next;
+    uint32_t ref_a, ref_b;      /* last message that checked out   */
+    uint32_t next_a, next_b;    /* candidate after a mismatch      */
+} pos_ab_t;
+
+static struct {
+    bool     have_prev;
+    uint16_t prev_b;
+    int32_t  offset;            /* multiple of POS_MOD             */
+    pos_ab_t ab[2];             /* per delimiter: (7,9), (9,9)     */
+    uint32_t seq;
+} s_pos;
+
+/* L ones then H zeros per pair, LSB first; crosstalk pairs skipped.
+ * Values are kept to 32 bits (data_B needs 9). */
+static bool pos_bits(const msg_t *m, int i0, int i1, uint32_t *val)
+{
+    uint32_t v = 0;
+    int nb = 0;
+    for (int i = i0; i < i1; i++) {
+        if (m->H[i] > CROSSTALK_THRESH) continue;
+        for (int j = 0; j < m->L[i] && nb < 32; j++)
+            v |= 1u << nb++;
+        nb += m->H[i];
+    }
+    *val = v;
+    return nb > 0;
+}
+
+static bool pos_ab_agree(uint32_t a0, uint32_t b0, uint32_t a1, uint32_t b1)
+{
+    static const uint8_t shift[] = { 0, 10 };
+    for (int i = 0; i < 2; i++) {
+        int s = shift[i];
+        if ((((a0 >> s) - b0) & (POS_MOD - 1)) == (((a1 >> s) - b1) & (POS_MOD - 1)))
+            return true;
+    }
+    return false;
+}
+
+static void pos_check(pos_rec_t *r, int kind)
+{
+    pos_ab_t *ab = &s_pos.ab[kind];
+    if (ab->have_ref && pos_ab_agree(r->a, r->b, ab->ref_a, ab->ref_b)) {
+        r->flags |= POS_CHECK_OK;
+    } else if (!ab->have_ref ||
+               (ab->have_next && pos_ab_agree(r->a, r->b, ab->next_a, ab->next_b))) {
+        r->flags |= POS_LEARN;
+    } else {
+        r->flags |= POS_CHECK_BAD;
+        ab->have_next = true;
+        ab->next_a = r->a;
+        ab->next_b = r->b;
+        return;
+    }
+    ab->have_ref  = true;
+    ab->have_next = false;
+    ab->ref_a = r->a;
+    ab->ref_b = r->b;
+}
+
+static void pos_unwrap(pos_rec_t *r)
+{
+    uint16_t b = r->b & (POS_MOD - 1);
+    if (!b) return;                     /* no position in this message */
+    if (s_pos.have_prev) {
+        int delta = (int)b - s_pos.prev_b;
+        if (delta < -POS_MOD / 2)      s_pos.offset += POS_MOD;
+        else if (delta > POS_MOD / 2)  s_pos.offset -= POS_MOD;
+    }
+    s_pos.prev_b    = b;
+    s_pos.have_prev = true;
+    r->pos    = s_pos.offset + b;
+    r->flags |= POS_VALID;
+}
+
+/* Caller has checked the message classifies as TYPE-B */
+static void pos_decode(const msg_t *m, pos_rec_t *r)
+{
+    const uint8_t *p = m->L + TYPE_B_HEADER_LEN;
+    int np = m->n - TYPE_B_HEADER_LEN;
+
+    memset(r, 0, sizeof(*r));
+    r->t    = m->t;
+    r->door = TB_DOOR_NONE;
+    r->sub  = TB_SUB_NONE;
+    r->light = TB_LIGHT_NONE;
+    r->np   = np < 5 ? np : 5;
+    memcpy(r->p, p, r->np);
+    if (np < 2) return;
+
+    r->door = tb_door_lookup(p);
+    if (np >= 5) {
+        r->sub = tb_sub_lookup(p + 2);
+        if (r->door == TB_DOOR_IDLE_CLOSED || r->door == TB_DOOR_ARRIVED_CLOSED ||
+            r->door == TB_DOOR_NONE) {
+            r->light = tb_light_lookup(p + 1);
+            if (r->light == TB_LIGHT_ON && r->door == TB_DOOR_ARRIVED_CLOSED &&
+                r->sub == TB_SUB_SETTLED)
+                r->door = TB_DOOR_IDLE_CLOSED;
+        }
+    }
+
+    /* Position field */
+    int i0 = TYPE_B_HEADER_LEN + 5, n = m->n;
+    if (n <= i0) return;
+    int ds = 0;
+    if (n - i0 >= 2 && m->L[i0] == 1 && m->L[i0 + 1] == 7) ds = 2;
+    else if (m->L[i0] == 9)                                 ds = 1;
+    int d = -1;
+    for (int i = i0 + ds; i < n - 1; i++) {
+        if ((m->L[i] == 7 || m->L[i] == 9) && m->L[i + 1] == 9) {
+            d = i;
+            break;
+        }
+    }
+    if (d < 0) return;                  /* transitional / endpoint message */
+
+    if (pos_bits(m, i0 + ds, d, &r->a)) r->flags |= POS_A;
+    if (pos_bits(m, d + 2, n, &r->b))   r->flags |= POS_B;
+    if (!(r->flags & POS_B)) return;
+    if (r->flags & POS_A)
+        pos_check(r, m->L[d] == 9);
+    if (!(r->flags & POS_CHECK_BAD))
+        pos_unwrap(r);
+}
+
+#if !OUTPUT_BINARY
+static void json_state(const char *key, uint8_t v, const char *const *names,
+                       const uint8_t *p, int i0, int k, int np)
+{
+    printf(",\"%s\":", key);
+    if (v != 0xFF) {
+        printf("\"%s\"", names[v]);
+    } else if (np < i0 + k) {
+        printf("null");
+    } else if (k == 2) {
+        printf("\"UNKNOWN(%u,%u)\"", p[i0], p[i0 + 1]);
+    } else {
+        printf("\"(%u,%u,%u)\"", p[i0], p[i0 + 1], p[i0 + 2]);
+    }
+}
+#endif
+
+static void pos_emit(const pos_rec_t *r)
+{
+    uint32_t seq = ++s_pos.seq;
+#if OUTPUT_BINARY
+    frame_t *f = &s_out;
+    frame_begin(f, FRAME_POS);
+    put_u32(f, r->t);
+    put_u32(f, seq);
+    put_u8(f, r->flags);
+    put_u8(f, r->door);
+    put_u8(f, r->sub);
+    put_u8(f, r->light);
+    put_u8(f, r->np);
+    for (int i = 0; i < 5; i++) put_u8(f, r->p[i]);
+    put_u32(f, r->a);
+    put_u32(f, r->b);
+    put_u32(f, (uint32_t)r->pos);
+    frame_end(f, portMAX_DELAY);
+#else
+    printf("{\"pos\":%lu,\"t\":%lu", (unsigned long)seq, (unsigned long)r->t);
+    json_state("door", r->door, TB_DOOR_NAMES, r->p, 0, 2, r->np);
+    json_state("sub", r->sub, TB_SUB_NAMES, r->p, 2, 3, r->np);
+    if (r->light != TB_LIGHT_NONE) printf(",\"light\":\"%s\"", TB_LIGHT_NAMES[r->light]);
+    else                           printf(",\"light\":null");
+    if (r->flags & POS_A) printf(",\"a\":%lu", (unsigned long)r->a);
+    if (r->flags & POS_B) printf(",\"b\":%lu", (unsigned long)r->b);
+    if (r->flags & POS_VALID) printf(",\"position\":%ld", (long)r->pos);
+    else                      printf(",\"position\":null");
+    if (r->flags & (POS_LEARN | POS_CHECK_OK | POS_CHECK_BAD))
+        printf(",\"check\":\"%s\"", r->flags & POS_CHECK_OK ? "ok" :
+                                     r->flags & POS_CHECK_BAD ? "bad" : "learn");
+    printf("}\n");
+#endif
+}
+#endif /* MONITOR_MODE && POS_TRACK */
+
+/* ── Traffic generator ─────────────────────────────────────────────
+ * TX_MODE drives CH0/CH1 with RMT TX at 1 µs resolution: each (L,H)
+ * pair becomes one RMT symbol of L·26 µs LOW then H·26 µs HIGH, and a
+ * final H of 0 ends the transmission with the line released HIGH, the
+ * same shape the decoder cuts messages into.
+ *
+ *   TX_MODE 1  generates traffic round-robin from msg_table.h, the table
+ *              the classifier uses: every exact CH0/CH1 pattern, with a
+ *              TYPE-B status message sweeping the position counter
+ *              across the mod-512 wrap in between.  Messages follow
+ *              each other TX_GAP_US apart, many times the bus's own
+ *              message rate.
+ *   TX_MODE 2  replays FRAME_TX frames from the host (replay.py) at the
+ *              times they carry, relative to the first frame.
+ *
+ * With TX_LOOPBACK the outputs are the CH0/CH1 input taps themselves
+ * (open drain, input path left on, receiver unpowered), so the capture
+ * backend and decoder see the traffic exactly as they would see the
+ * bus.  Each transmitted message is queued with its start time and a
+ * hash of its pairs; emit_task matches decoded messages against that
+ * queue and counts them ok / bad (decoded differently) / lost.  Without
+ * loopback the traffic goes out on PIN_TX0/PIN_TX1 to another rig.
+ */
+#if MONITOR_MODE && TX_MODE
+#define TX_RES_HZ      1000000      /* 1 µs per tick */
+#define TX_ECHO_DEPTH  16
+
+typedef struct {
+    uint32_t t;             /* start, esp_timer µs */
+    uint32_t hash;
+} tx_sent_t;
+
+static rmt_channel_handle_t s_tx_ch[2];
+static rmt_encoder_handle_t s_tx_enc;
+static rmt_symbol_word_t    s_tx_buf[2][MAX_PAIRS];
+static uint8_t              s_tx_L[MAX_PAIRS], s_tx_H[MAX_PAIRS];
+static msg_t                s_tx_msg = { .L = s_tx_L, .H = s_tx_H };
+static uint32_t s_tx_sent, s_tx_late;
+#if TX_LOOPBACK
+static QueueHandle_t s_tx_echo_q[2];
+static uint32_t s_tx_ok, s_tx_bad, s_tx_lost;
+#endif
+
+static const rmt_transmit_config_t s_tx_cfg = { .flags.eot_level = 1 };
+
+#if TX_LOOPBACK
+/* FNV-1a over the pairs, enough to tell an echo from its original */
+static uint32_t msg_hash(const msg_t *m)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < m->n; i++) {
+        h = (h ^ m->L[i]) * 16777619u;
+        h = (h ^ m->H[i]) * 16777619u;
+    }
+    return h;
+}
+#endif
+
+static void tx_init(void)
+{
+    static const gpio_num_t pins[2] = {
+        TX_LOOPBACK ? PIN_CH0 : PIN_TX0, TX_LOOPBACK ? PIN_CH1 : PIN_TX1,
+    };
+    for (int c = 0; c < 2; c++) {
+        rmt_tx_channel_config_t cfg = {
+            .gpio_num          = pins[c],
+            .clk_src           = RMT_CLK_SRC_DEFAULT,
+            .resolution_hz     = TX_RES_HZ,
+            .mem_block_symbols = 48,
+            .trans_queue_depth = 2,
+            .flags.io_loop_back = TX_LOOPBACK,
+            .flags.io_od_mode   = TX_LOOPBACK,
+        };
+        ESP_ERROR_CHECK(rmt_new_tx_channel(&cfg, &s_tx_ch[c]));
+        ESP_ERROR_CHECK(rmt_enable(s_tx_ch[c]));
+#if TX_LOOPBACK
+        s_tx_echo_q[c] = xQueueCreate(TX_ECHO_DEPTH, sizeof(tx_sent_t));
+#if !CAPTURE_USE_RMT
+        /* Claiming the pin for TX reconfigures it; keep the any-edge
+         * interrupt the ISR backend set up on it. */
+        gpio_set_intr_type(pins[c], GPIO_INTR_ANYEDGE);
+        gpio_intr_enable(pins[c]);
+#endif
+#endif
+    }
+    rmt_copy_encoder_config_t enc = {};
+    ESP_ERROR_CHECK(rmt_new_copy_encoder(&enc, &s_tx_enc));
+}
+
+/* Send m at esp_timer time `at` (now if already past) */
+static void tx_send(const msg_t *m, int64_t at)
+{
+    int c = m->ch;
+    rmt_symbol_word_t *w = s_tx_buf[c];
+
+    rmt_tx_wait_all_done(s_tx_ch[c], -1);      /* buffer is ours again */
+    for (int i = 0; i < m->n; i++) {
+        /* A zero duration would end the transmission early */
+        uint8_t h = m->H[i] || i == m->n - 1 ? m->H[i] : 1;
+        w[i] = (rmt_symbol_word_t){
+            .duration0 = (m->L[i] ? m->L[i] : 1) * PWM_UNIT_US, .level0 = 0,
+            .duration1 = h * PWM_UNIT_US,                       .level1 = 1,
+        };
+    }
+
+    int64_t left = at - esp_timer_get_time();
+    if (left > 2000)
+        vTaskDelay(pdMS_TO_TICKS((left - 1000) / 1000));
+    while (esp_timer_get_time() < at)
+        ;                                       /* last ms: spin */
+    if (left < 0) s_tx_late++;
+
+#if TX_LOOPBACK
+    tx_sent_t e = { .t = (uint32_t)esp_timer_get_time(), .hash = msg_hash(m) };
+    if (xQueueSend(s_tx_echo_q[c], &e, 0) != pdTRUE) {
+        tx_sent_t old;                          /* echo never came back */
+        xQueueReceive(s_tx_echo_q[c], &old, 0);
+        s_tx_lost++;
+        xQueueSend(s_tx_echo_q[c], &e, 0);
+    }
+#endif
+    rmt_transmit(s_tx_ch[c], s_tx_enc, w, m->n * sizeof(*w), &s_tx_cfg);
+    s_tx_sent++;
+}
+
+#if TX_LOOPBACK
+/* emit_task: match a decoded CH0/CH1 message against what was sent */
+static void tx_echo(const msg_t *m)
+{
+    tx_sent_t e;
+    while (xQueuePeek(s_tx_echo_q[m->ch], &e, 0) == pdTRUE) {
+        int32_t dt = (int32_t)(m->t - e.t);
+        if (dt > TX_ECHO_WIN_US) {              /* older one went missing */
+            xQueueReceive(s_tx_echo_q[m->ch], &e, 0);
+            s_tx_lost++;
+            continue;
+        }
+        if (dt < -TX_ECHO_WIN_US) return;       /* not one of ours */
+        xQueueReceive(s_tx_echo_q[m->ch], &e, 0);
+        if (e.hash == msg_hash(m)) s_tx_ok++;
+        else                       s_tx_bad++;
+        return;
+    }
+}
+#endif
+
+static void tx_stats(void)
+{
+#if TX_LOOPBACK
+    ESP_LOGI(TAG, "tx: %lu sent, %lu late, echo %lu ok / %lu bad / %lu lost",
+             (unsigned long)s_tx_sent, (unsigned long)s_tx_late,
+             (unsigned long)s_tx_ok, (unsigned long)s_tx_bad,
+             (unsigned long)s_tx_lost);
+#else
+    ESP_LOGI(TAG, "tx: %lu sent, %lu late",
+             (unsigned long)s_tx_sent, (unsigned long)s_tx_late);
+#endif
+}
+
+#if TX_MODE == 1
+/* Message length in µs, last HIGH excluded */
+static int64_t tx_duration(const msg_t *m)
+{
+    int64_t u = 0;
+    for (int i = 0; i < m->n; i++)
+        u += m->L[i] + m->H[i];
+    return u * PWM_UNIT_US;
+}
+
+static struct {
+    int      pat;           /* next MSG_PATTERNS entry          */
+    int      door, sub;     /* next TB_DOOR / TB_SUB key        */
+    int      type_b;        /* MSG_PATTERNS index of TYPE-B     */
+    uint16_t pos;
+    int16_t  step;
+    uint32_t n;
+    bool     status;        /* TYPE-B next                      */
+} s_gen = { .pos = 301, .step = 22 };
+
+static void gen_syms(msg_t *m, const uint8_t *s, int n)
+{
+    for (int i = 0; i < n && m->n < MAX_PAIRS; i++) {
+        m->L[m->n] = s[i];
+        m->H[m->n] = 1;
+        m->n++;
+    }
+}
+
+/* v as one (ones, zeros) pair per bit run, LSB first, like pos_bits()
+ * reads it back.  False if v does not start with a 1 or a run is too
+ * long for one pair (ones ≤ 6 keeps L clear of the delimiter). */
+static bool gen_value(msg_t *m, uint32_t v)
+{
+    if (!(v & 1)) return false;
+    while (v) {
+        int ones = __builtin_ctz(~v);
+        v >>= ones;
+        int zeros = v ? __builtin_ctz(v) : 1;
+        if (v) v >>= zeros;
+        if (ones > 6 || zeros > 9 || m->n == MAX_PAIRS) return false;
+        m->L[m->n] = (uint8_t)ones;
+        m->H[m->n] = (uint8_t)zeros;
+        m->n++;
+    }
+    return true;
+}
+
+/* TYPE-B carrying position b in data_B and b + 140 in data_A */
+static bool gen_type_b(msg_t *m, uint32_t b)
+{
+    static const uint8_t prefix[] = { 1, 7 }, delim[] = { 7, 9 };
+    const msg_pattern_t *p = &MSG_PATTERNS[s_gen.type_b];
+
+    m->ch = 1;
+    m->n  = 0;
+    gen_syms(m, &MSG_PATTERN_SYMS[p->off], p->len);
+    gen_syms(m, TB_DOOR_KEYS[s_gen.door], sizeof(TB_DOOR_KEYS[0]));
+    gen_syms(m, TB_SUB_KEYS[s_gen.sub], sizeof(TB_SUB_KEYS[0]));
+    gen_syms(m, prefix, sizeof(prefix));
+    if (!gen_value(m, (b + 140) & 0x1FF)) return false;
+    gen_syms(m, delim, sizeof(delim));
+    return gen_value(m, b);
+}
+
+static void gen_next(msg_t *m)
+{
+    if (s_gen.status) {
+        do {
+            s_gen.pos = (uint16_t)((s_gen.pos + s_gen.step) & 0x1FF);
+        } while (!gen_type_b(m, s_gen.pos));
+        if (++s_gen.n % 64 == 0) s_gen.step = (int16_t)-s_gen.step;
+        s_gen.door = (s_gen.door + 1) % TB_DOOR_COUNT;
+        s_gen.sub  = (s_gen.sub + 1) % TB_SUB_COUNT;
+    } else {
+        /* Exact patterns only; a 0 symbol or < 3 pairs cannot be sent
+         * as a data burst */
+        const msg_pattern_t *p;
+        do {
+            p = &MSG_PATTERNS[s_gen.pat];
+            s_gen.pat = (s_gen.pat + 1) % MSG_NPATTERNS;
+        } while (p->prefix || p->len < 3 ||
+                 memchr(&MSG_PATTERN_SYMS[p->off], 0, p->len));
+        m->ch = p->ch;
+        m->n  = 0;
+        gen_syms(m, &MSG_PATTERN_SYMS[p->off], p->len);
+    }
+    s_gen.status = !s_gen.status;
+    m->H[m->n - 1] = 0;
+}
+
+static void tx_task(void *arg)
+{
+    for (int i = 0; i < MSG_NPATTERNS; i++)
+        if (MSG_PATTERNS[i].id == MSG_TYPE_B) s_gen.type_b = i;
+
+    int64_t at = esp_timer_get_time() + TX_LEAD_US;
+    int64_t stats = at;
+    for (;;) {
+        gen_next(&s_tx_msg);
+        tx_send(&s_tx_msg, at);
+        at += tx_duration(&s_tx_msg) + TX_GAP_US;
+        if (esp_timer_get_time() >= stats) {
+            tx_stats();
+            stats += MONITOR_STATUS_MS * 1000LL;
+        }
+    }
+}
+
+#else /* TX_MODE == 2 */
+static uint8_t s_rx[5 + 5 + 1 + 3 * MAX_PAIRS + 2];
+
+static void rx_read(uint8_t *p, int n)
+{
+    while (n > 0) {
+        int k = usb_serial_jtag_read_bytes(p, n, portMAX_DELAY);
+        if (k > 0) {
+            p += k;
+            n -= k;
+        }
+    }
+}
+
+/* Next CRC-good frame from the host: type byte, payload at s_rx + 3 */
+static int rx_frame(uint16_t *len)
+{
+    for (;;) {
+        rx_read(s_rx, 1);
+        if (s_rx[0] != 0xA5) continue;
+        rx_read(s_rx, 1);
+        if (s_rx[0] != 0x5A) continue;
+        rx_read(s_rx, 3);
+        uint16_t n = s_rx[1] | s_rx[2] << 8;
+        if (3 + n + 2 > sizeof(s_rx)) continue;
+        rx_read(s_rx + 3, n + 2);
+        uint16_t crc = s_rx[3 + n] | s_rx[4 + n] << 8;
+        if (crc16_ccitt(s_rx, 3 + n) != crc) continue;
+        *len = n;
+        return s_rx[0];
+    }
+}
+
+/* put_pairs() format back into m; false if it does not parse */
+static bool rx_pairs(const uint8_t *p, int len, msg_t *m)
+{
+    int n = p[0], i = 1;
+    if (n < 1 || n > MAX_PAIRS) return false;
+    for (int k = 0; k < n; k++) {
+        if (i >= len) return false;
+        if (p[i] == PAIR_ESC) {
+            if (i + 3 > len) return false;
+            m->L[k] = p[i + 1];
+            m->H[k] = p[i + 2];
+            i += 3;
+        } else {
+            m->L[k] = p[i] >> 4;
+            m->H[k] = p[i] & 0x0F;
+            i++;
+        }
+    }
+    m->n = (uint16_t)n;
+    return true;
+}
+
+static void tx_task(void *arg)
+{
+    bool     started = false;
+    uint32_t prev = 0;
+    int64_t  base = 0;
+    int64_t  stats = esp_timer_get_time() + MONITOR_STATUS_MS * 1000LL;
+
+    for (;;) {
+        uint16_t len;
+        if (rx_frame(&len) != FRAME_TX || len < 6) continue;
+        const uint8_t *p = s_rx + 3;
+        uint32_t t = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+        s_tx_msg.ch = p[4];
+        if (s_tx_msg.ch > 1 || !rx_pairs(p + 5, len - 5, &s_tx_msg)) continue;
+
+        /* A time that goes backwards starts a new replay */
+        if (!started || t < prev)
+            base = esp_timer_get_time() + TX_LEAD_US - t;
+        started = true;
+        prev = t;
+        tx_send(&s_tx_msg, base + t);
+
+        if (esp_timer_get_time() >= stats) {
+            tx_stats();
+            stats += MONITOR_STATUS_MS * 1000LL;
+        }
+    }
+}
+#endif /* TX_MODE */
+#endif /* MONITOR_MODE && TX_MODE */
+
+/* ── Network output ────────────────────────────────────────────────
+ * frame_end() queues sealed frames in s_udp_rb instead of writing them
+ * to USB; udp_task packs them into datagrams of at most UDP_MTU bytes
+ * and sends one when the next frame would not fit or UDP_BATCH_MS after
+ * the first frame went in.  Every datagram starts with a FRAME_CLOCK,
+ * so each one can be placed in time and attributed to its rig on its
+ * own, and a lost datagram shows up as a seq gap.
+ *
+ * Sending never blocks (MSG_DONTWAIT): a datagram that cannot go out,
+ * or any frame drained while Wi-Fi is down, is counted in s_udp_lost
+ * and dropped.  Only a full s_udp_rb pushes back on the writers, the
+ * same way a full USB TX buffer does.  UDP rather than TCP: a stalled
+ * connection must not wedge the decoder, and the seq gap is all the
+ * host needs to know what went missing.
+ */
+#if OUTPUT_UDP
+#define CLOCK_FRAME_LEN  (5 + 24 + 2)
+#define UDP_LOG_MS       10000      /* sent/lost counter log period */
+_Static_assert(CLOCK_FRAME_LEN + FRAME_MAX <= UDP_MTU,
+               "UDP_MTU too small for a clock frame plus the largest frame");
+
+static volatile bool s_net_up, s_clock_ok;
+static uint32_t s_rig_id;
+static uint32_t s_udp_sent, s_udp_lost;
+
+static void wifi_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        s_net_up = false;
+        esp_wifi_connect();
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        s_net_up = true;
+        ESP_LOGI(TAG, "Wi-Fi up, sending to %s:%d", UDP_HOST, UDP_PORT);
+    }
+}
+
+static void clock_synced(struct timeval *tv)
+{
+    s_clock_ok = true;
+    ESP_LOGI(TAG, "SNTP synced");
+}
+
+static void wifi_init(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_create_default_wifi_sta();
+
+    wifi_init_config_t icfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&icfg));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event, NULL));
+
+    wifi_config_t wcfg = { .sta = { .ssid = WIFI_SSID, .password = WIFI_PASS } };
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wcfg));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    esp_wifi_set_ps(WIFI_PS_NONE);          /* no 100 ms DTIM sleeps per batch */
+
+    esp_sntp_config_t scfg = ESP_NETIF_SNTP_DEFAULT_CONFIG(SNTP_SERVER);
+    scfg.sync_cb = clock_synced;
+    esp_netif_sntp_init(&scfg);
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    s_rig_id = (uint32_t)mac[3] << 16 | mac[4] << 8 | mac[5];
+
+    s_udp_rb = xRingbufferCreate(UDP_QUEUE_BYTES, RINGBUF_TYPE_NOSPLIT);
+}
+
+static void udp_task(void *arg)
+{
+    static uint8_t dg[UDP_MTU];
+    static frame_t clk;
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(UDP_PORT) };
+    inet_pton(AF_INET, UDP_HOST, &to.sin_addr);
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "udp: no socket (%d)", errno);
+        vTaskDelete(NULL);
+    }
+
+    uint32_t seq = 0;
+    size_t   len = 0;               /* 0 = no datagram open */
+    int      nfr = 0;
+    int64_t  t_open = 0;
+    int64_t  t_log = esp_timer_get_time();
+
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (len) {
+            int64_t left = t_open + UDP_BATCH_MS * 1000LL - esp_timer_get_time();
+            wait = left > 0 ? pdMS_TO_TICKS(left / 1000) : 0;
+        }
+        size_t n;
+        uint8_t *item = xRingbufferReceive(s_udp_rb, &n, wait);
+
+        if (len && (!item || len + n > UDP_MTU)) {
+            if (s_net_up && sendto(sock, dg, len, MSG_DONTWAIT,
+                                   (struct sockaddr *)&to, sizeof(to)) == (int)len)
+                s_udp_sent += nfr;
+            else
+                s_udp_lost += nfr;
+            len = 0;
+        }
+        if (esp_timer_get_time() - t_log >= UDP_LOG_MS * 1000LL) {
+            t_log = esp_timer_get_time();
+            ESP_LOGI(TAG, "udp: %lu frames sent, %lu lost, %lu datagrams%s",
+                     (unsigned long)s_udp_sent, (unsigned long)s_udp_lost,
+                     (unsigned long)seq, s_clock_ok ? "" : " (no SNTP yet)");
+        }
+        if (!item)
+            continue;
+
+        if (!len) {
+            struct timeval tv;
+            int64_t up = esp_timer_get_time();
+            gettimeofday(&tv, NULL);
+            frame_begin(&clk, FRAME_CLOCK);
+            put_u32(&clk, seq++);
+            put_u32(&clk, s_rig_id);
+            put_u64(&clk, (uint64_t)up);
+            put_u64(&clk, s_clock_ok ? (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec : 0);
+            frame_seal(&clk);
+            memcpy(dg, clk.buf, clk.len);
+            len = clk.len;
+            clk.len = 0;
+            nfr = 0;
+            t_open = up;
+        }
+        memcpy(dg + len, item, n);
+        len += n;
+        nfr++;
+        vRingbufferReturnItem(s_udp_rb, item);
+    }
+}
+#endif /* OUTPUT_UDP */
+
 /* ── Main ──────────────────────────────────────────────────────── */
+#if MONITOR_MODE
+/* Sole writer of stdout in monitor mode: messages plus periodic status */
+static void emit_task(void *arg)
+{
+    int64_t next = esp_timer_get_time() + MONITOR_STATUS_MS * 1000LL;
+
+    for (int n = 1;;) {
+        int64_t left = next - esp_timer_get_time();
+        TickType_t wait = left > 0 ? pdMS_TO_TICKS(left / 1000) : 0;
+
+        msg_t *m;
+        if (xQueueReceive(s_msg_q, &m, wait) == pdTRUE) {
+#if OUTPUT_BINARY
+            frame_t *f = &s_out;
+            frame_begin(f, FRAME_MSG);
+            put_u32(f, m->t);
+            put_u8(f, m->ch);
+            put_pairs(f, m);
+            frame_end(f, portMAX_DELAY);
+#else
+            printf("{\"t\":%lu,\"ch\":%d,\"pairs\":",
+                   (unsigned long)m->t, m->ch);
+            json_pairs(m);
+            printf("}\n");
+#endif
+#if POS_TRACK
+            if (m->ch == 1 && m->n > TYPE_B_HEADER_LEN &&
+                msg_classify(1, m->L, m->n) == MSG_TYPE_B) {
+                pos_rec_t r;
+                pos_decode(m, &r);
+                pos_emit(&r);
+            }
+#endif
+#if TX_MODE && TX_LOOPBACK
+            if (m->ch < 2)
+                tx_echo(m);
+#endif
+            s_msg_done = s_msg_done + 1;
+        }
+
+        if (esp_timer_get_time() >= next) {
+#if OUTPUT_BINARY
+            frame_t *f = &s_out;
+            frame_begin(f, FRAME_STATUS);
+            put_u32(f, (uint32_t)(esp_timer_get_time() / 1000));
+            put_u32(f, s_head);
+            put_u32(f, s_msg_total);
+            put_u32(f, s_overflow);
+            put_u32(f, s_msg_drop);
+            put_u16(f, (uint16_t)(s_head - s_tail));
+            put_u16(f, (uint16_t)n++);
+#if OUTPUT_RAW_EDGES
+            put_u32(f, s_stream_drop);
+#else
+            put_u32(f, 0);
+#endif
+            frame_end(f, portMAX_DELAY);
+#else
+            printf("{\"mon\":%d,\"uptime_ms\":%lu,\"edges\":%lu,\"msgs\":%lu,"
+                   "\"overflow\":%lu,\"dropped\":%lu,\"ring\":%lu}\n",
+                   n++, (unsigned long)(esp_timer_get_time() / 1000),
+                   (unsigned long)s_head, (unsigned long)s_msg_total,
+                   (unsigned long)s_overflow, (unsigned long)s_msg_drop,
+                   (unsigned long)(s_head - s_tail));
+#endif
+            stats_emit((uint32_t)(n - 1));
+            next += MONITOR_STATUS_MS * 1000LL;
+        }
+        fflush(stdout);
+    }
+}
+#endif
+
 void app_main(void)
 {
-    ESP_LOGI(TAG, "Handshake capture rig — CH0=GPIO%d CH1=GPIO%d FET=GPIO%d",
-             PIN_CH0, PIN_CH1, PIN_MOSFET);
+    ESP_LOGI(TAG, "Handshake capture rig — %d ch, CH0=GPIO%d CH1=GPIO%d FET=GPIO%d (%s)",
+             NUM_CH, PIN_CH0, PIN_CH1, PIN_MOSFET, CAPTURE_USE_RMT ? "RMT" : "GPIO ISR");
 
+    s_dec_lock = xSemaphoreCreateMutex();
+    s_msg_q    = xQueueCreate(MAX_MSGS, sizeof(msg_t *));
+    output_init();
+#if OUTPUT_UDP
+    wifi_init();
+    xTaskCreate(udp_task, "udp", 4096, NULL, 4, NULL);
+#endif
     hw_init();
+    xTaskCreate(decode_task, "decode", 4096, NULL, 5, NULL);
 
     /* Give USB-CDC time to enumerate so the host sees early output */
     vTaskDelay(pdMS_TO_TICKS(3000));
+#if OUTPUT_UDP
+    for (int i = 0; i < 100 && !s_net_up; i++)     /* ≤ 10 s more for Wi-Fi */
+        vTaskDelay(pdMS_TO_TICKS(100));
+#endif
 
+#if MONITOR_MODE
+    ESP_LOGI(TAG, "Monitor mode — status every %d ms", MONITOR_STATUS_MS);
+    xTaskCreate(emit_task, "emit", 4096, NULL, 4, NULL);
+    decode_reset();
+#if TX_MODE
+    /* Receiver stays unpowered so only the generator drives the lines */
+    ESP_LOGI(TAG, "TX mode %d (%s)", TX_MODE, TX_MODE == 1 ? "generate" : "replay");
+    tx_init();
+    gpio_set_level(PIN_MOSFET, 0);
+    s_run = true;
+    xTaskCreate(tx_task, "tx", 4096, NULL, 3, NULL);
+#else
+    gpio_set_level(PIN_MOSFET, 1);
+    s_run = true;
+#endif
+    while (1) vTaskDelay(pdMS_TO_TICKS(10000));
+#else
     ESP_LOGI(TAG, "Starting capture loop (target: %d good pairs)", TARGET_GOOD);
 
     int cycle = 0, good = 0;
+    sched_init();
 
     while (good < TARGET_GOOD) {
-        cycle++;
-        ESP_LOGI(TAG, "--- Cycle %d  (good so far: %d/%d) ---",
-                 cycle, good, TARGET_GOOD);
+        cycle_t c = {
+            .cycle     = ++cycle,
+            .off_ms    = s_sched.off_ms,
+            .window_ms = sched_window_ms(),
+        };
+        ESP_LOGI(TAG, "--- Cycle %d  (good so far: %d/%d, off %lu ms, window %lu ms) ---",
+                 cycle, good, TARGET_GOOD,
+                 (unsigned long)c.off_ms, (unsigned long)c.window_ms);
 
         /* 1) Power off receiver */
         gpio_set_level(PIN_MOSFET, 0);
-        vTaskDelay(pdMS_TO_TICKS(POWER_OFF_MS));
+        vTaskDelay(pdMS_TO_TICKS(c.off_ms));
 
-        /* 2) Reset ring buffer and start capturing edges */
-        s_head = 0;
+        /* 2) Reset decoder and start capturing edges */
+        xSemaphoreTake(s_dec_lock, portMAX_DELAY);
+        decode_reset();
+        xSemaphoreGive(s_dec_lock);
+        uint32_t head0 = s_head, ovf0 = s_overflow;
         s_run  = true;
         gpio_set_level(PIN_MOSFET, 1);
 
-        /* 3) Wait for boot handshake to complete */
-        vTaskDelay(pdMS_TO_TICKS(CAPTURE_MS));
+        /* 3) Watch decoded messages until the handshake completes or
+         *    the window expires.  A response only counts once a
+         *    challenge has been seen so the pair belongs together. */
+        TickType_t t0 = xTaskGetTickCount();
+        TickType_t t_end = t0 + pdMS_TO_TICKS(c.window_ms);
+        bool got_challenge = false;
+
+        for (;;) {
+            TickType_t left = t_end - xTaskGetTickCount();
+            if ((int32_t)left <= 0) break;
+
+            msg_t *m;
+            if (xQueueReceive(s_msg_q, &m, left) != pdTRUE) continue;
+            if (is_challenge(m)) {
+                got_challenge = true;
+            } else if (got_challenge && is_response(m)) {
+                c.lat_ms = (xTaskGetTickCount() - t0) * portTICK_PERIOD_MS;
+                break;
+            }
+        }
         s_run = false;
+        c.ms = (xTaskGetTickCount() - t0) * portTICK_PERIOD_MS;
+
+        /* Handshake done (or hopeless): cut power right away; the rest of
+         * the cycle's bookkeeping overlaps the next power-off period. */
+        if (ADAPTIVE_SCHED)
+            gpio_set_level(PIN_MOSFET, 0);
+
+        /* 4) Let decode_task drain the ring, flush, then find handshake */
+        while (s_tail != s_head)
+            vTaskDelay(1);
+
+        xSemaphoreTake(s_dec_lock, portMAX_DELAY);
+        c.edges    = s_head - head0;
+        c.overflow = s_overflow - ovf0;
+        ESP_LOGI(TAG, "Captured %lu edges in %lu ms",
+                 (unsigned long)c.edges, (unsigned long)c.ms);
+        decode_flush();
+        bool ok = emit_cycle(&c);
+        stats_emit((uint32_t)c.cycle);
+        xSemaphoreGive(s_dec_lock);
 
-        ESP_LOGI(TAG, "Captured %lu edges", (unsigned long)s_head);
+        sched_update(&c, ok);
+        if (ok) good++;
 
-        /* 4) Process edges → messages, find handshake, output JSON */
-        process();
-        if (emit_json(cycle))
-            good++;
+        uint32_t r = sched_rate_x10();
+        ESP_LOGI(TAG, "%d/%d good, %lu.%lu pairs/min",
+                 good, TARGET_GOOD, (unsigned long)(r / 10), (unsigned long)(r % 10));
 
-        /* 5) Settle before next cycle */
-        vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+        /* 5) Settle before next cycle (fixed timing, or after a miss) */
+        if (!ADAPTIVE_SCHED || !ok)
+            vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
     }
 
     ESP_LOGI(TAG, "=== Done! %d good pairs in %d cycles ===", good, cycle);
     gpio_set_level(PIN_MOSFET, 1);          /* leave receiver on */
 
     while (1) vTaskDelay(pdMS_TO_TICKS(10000));
+#endif
 }
@@ -0,0 +1,493 @@
+/*
+ * msg_table.h — CH0/CH1 message classifier tables
+ *
+ * GENERATED by gen_msg_table.py from the tables in analyze.py; do not
+ * edit.  Rerun the script after changing a message definition, and
+ * `python gen_msg_table.py --check` to confirm the two sides agree.
+ *
+ * One trie per channel: msg_classify() walks the L-symbols once and
+ * returns the exact match ending at the last symbol, else the best
+ * header prefix passed on the way (analyze.classify_ch0/ch1 rules).
+ * Symbols here come from sym(), which never returns 0, so patterns
+ * containing 0 (CMD-INIT) cannot match on the device.
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    MSG_UNKNOWN,         /*  0 UNKNOWN */
+    MSG_CMD_INIT,        /*  1 CMD-INIT */
+    MSG_CMD_A,           /*  2 CMD-A */
+    MSG_CMD_A1,          /*  3 CMD-A1 */
+    MSG_CMD_R,           /*  4 CMD-R */
+    MSG_CMD_L,           /*  5 CMD-L */
+    MSG_CMD_ECHO,        /*  6 CMD-ECHO */
+    MSG_CMD_B,           /*  7 CMD-B */
+    MSG_CMD_B_INIT,      /*  8 CMD-B-INIT */
+    MSG_CMD_B_X,         /*  9 CMD-B-? */
+    MSG_CMD_X,           /* 10 CMD-? */
+    MSG_ACK_A,           /* 11 ACK-A */
+    MSG_ACK_A2,          /* 12 ACK-A2 */
+    MSG_ACK_R,           /* 13 ACK-R */
+    MSG_ACK_L,           /* 14 ACK-L */
+    MSG_ACK_B,           /* 15 ACK-B */
+    MSG_ACK_B2,          /* 16 ACK-B2 */
+    MSG_TYPE_B,          /* 17 TYPE-B */
+    MSG_TYPE_C,          /* 18 TYPE-C */
+    MSG_HANDSHAKE_D,     /* 19 HANDSHAKE-D */
+    MSG_HANDSHAKE_E,     /* 20 HANDSHAKE-E */
+    MSG_BOOT_F,          /* 21 BOOT-F */
+    MSG_ECHO,            /* 22 ECHO */
+    MSG_ACK_X,           /* 23 ACK-? */
+    MSG_BEACON,          /* 24 BEACON */
+    MSG_COUNT
+};
+
+static const char *const MSG_NAMES[MSG_COUNT] = {
+    "UNKNOWN",
+    "CMD-INIT",
+    "CMD-A",
+    "CMD-A1",
+    "CMD-R",
+    "CMD-L",
+    "CMD-ECHO",
+    "CMD-B",
+    "CMD-B-INIT",
+    "CMD-B-?",
+    "CMD-?",
+    "ACK-A",
+    "ACK-A2",
+    "ACK-R",
+    "ACK-L",
+    "ACK-B",
+    "ACK-B2",
+    "TYPE-B",
+    "TYPE-C",
+    "HANDSHAKE-D",
+    "HANDSHAKE-E",
+    "BOOT-F",
+    "ECHO",
+    "ACK-?",
+    "BEACON",
+};
+
+/* Header length per message: exact = whole message, prefix = prefix */
+static const uint8_t MSG_HDR_LEN[MSG_COUNT] = {
+     0,  6, 15, 16, 12, 15, 13, 30,  8,  4,  5, 12,
+    10, 10, 12,  7,  8,  8,  9,  7,  8,  4,  8,  4,
+     3,
+};
+
+typedef struct {
+    uint16_t edge0;     /* first outgoing edge in MSG_EDGES */
+    uint8_t  nedge;
+    uint8_t  exact;     /* message ending exactly here, or 0 */
+    uint8_t  prefix;    /* best prefix match at or above, or 0 */
+} msg_node_t;
+
+typedef struct {
+    uint8_t  sym;
+    uint16_t node;
+} msg_edge_t;
+
+#define MSG_ROOT_CH0  0
+#define MSG_ROOT_CH1  1
+
+static const msg_node_t MSG_NODES[152] = {
+    {   0, 2,  0,  0},  /* 0 */
+    {   2, 2,  0,  0},  /* 1 */
+    {   4, 1,  0,  0},  /* 2 */
+    {   5, 1,  0,  0},  /* 3 */
+    {   6, 1,  0,  0},  /* 4 */
+    {   7, 1,  0,  0},  /* 5 */
+    {   8, 1,  0,  0},  /* 6 */
+    {   9, 2,  0,  0},  /* 7 */
+    {  11, 5,  0,  0},  /* 8 */
+    {  16, 1,  0,  0},  /* 9 */
+    {  17, 1,  0,  0},  /* 10 */
+    {  18, 1,  0,  0},  /* 11 */
+    {  19, 1,  0,  0},  /* 12 */
+    {  20, 1,  0,  0},  /* 13 */
+    {  21, 1,  0,  0},  /* 14 */
+    {  22, 2,  0,  0},  /* 15 */
+    {  24, 1,  0,  0},  /* 16 */
+    {  25, 1,  0,  0},  /* 17 */
+    {  26, 0,  0, 24},  /* 18 */
+    {  26, 1,  0,  0},  /* 19 */
+    {  27, 1,  0,  0},  /* 20 */
+    {  28, 2,  0,  9},  /* 21 */
+    {  30, 1,  0,  0},  /* 22 */
+    {  31, 1,  0,  0},  /* 23 */
+    {  32, 1,  0,  0},  /* 24 */
+    {  33, 3,  0, 23},  /* 25 */
+    {  36, 2,  0,  0},  /* 26 */
+    {  38, 0,  0, 21},  /* 27 */
+    {  38, 1,  0,  0},  /* 28 */
+    {  39, 2,  0, 10},  /* 29 */
+    {  41, 1,  0,  9},  /* 30 */
+    {  42, 1,  0,  9},  /* 31 */
+    {  43, 1,  0,  0},  /* 32 */
+    {  44, 1,  0,  0},  /* 33 */
+    {  45, 1,  0,  0},  /* 34 */
+    {  46, 2,  0, 23},  /* 35 */
+    {  48, 1,  0, 23},  /* 36 */
+    {  49, 2,  0, 23},  /* 37 */
+    {  51, 1,  0,  0},  /* 38 */
+    {  52, 1,  0,  0},  /* 39 */
+    {  53, 0,  1,  0},  /* 40 */
+    {  53, 2,  0, 10},  /* 41 */
+    {  55, 2,  0, 10},  /* 42 */
+    {  57, 1,  0,  9},  /* 43 */
+    {  58, 1,  0,  9},  /* 44 */
+    {  59, 1,  0,  0},  /* 45 */
+    {  60, 1,  0,  0},  /* 46 */
+    {  61, 1,  0,  0},  /* 47 */
+    {  62, 1,  0, 23},  /* 48 */
+    {  63, 2,  0, 23},  /* 49 */
+    {  65, 1,  0, 23},  /* 50 */
+    {  66, 1,  0, 23},  /* 51 */
+    {  67, 1,  0, 23},  /* 52 */
+    {  68, 1,  0,  0},  /* 53 */
+    {  69, 1,  0,  0},  /* 54 */
+    {  70, 1,  0, 10},  /* 55 */
+    {  71, 1,  0, 10},  /* 56 */
+    {  72, 1,  0, 10},  /* 57 */
+    {  73, 1,  0, 10},  /* 58 */
+    {  74, 1,  0,  9},  /* 59 */
+    {  75, 1,  0,  9},  /* 60 */
+    {  76, 1,  0,  0},  /* 61 */
+    {  77, 1,  0,  0},  /* 62 */
+    {  78, 1,  0,  0},  /* 63 */
+    {  79, 1,  0, 23},  /* 64 */
+    {  80, 1,  0, 23},  /* 65 */
+    {  81, 1,  0, 23},  /* 66 */
+    {  82, 0, 15, 23},  /* 67 */
+    {  82, 1,  0, 23},  /* 68 */
+    {  83, 1,  0, 23},  /* 69 */
+    {  84, 1,  0,  0},  /* 70 */
+    {  85, 0,  0, 19},  /* 71 */
+    {  85, 1,  0, 10},  /* 72 */
+    {  86, 1,  0, 10},  /* 73 */
+    {  87, 1,  0, 10},  /* 74 */
+    {  88, 1,  0, 10},  /* 75 */
+    {  89, 0,  0,  8},  /* 76 */
+    {  89, 1,  0,  9},  /* 77 */
+    {  90, 0,  0, 22},  /* 78 */
+    {  90, 0,  0, 17},  /* 79 */
+    {  90, 1,  0,  0},  /* 80 */
+    {  91, 1,  0, 23},  /* 81 */
+    {  92, 1,  0, 23},  /* 82 */
+    {  93, 1,  0, 23},  /* 83 */
+    {  94, 1,  0, 23},  /* 84 */
+    {  95, 0, 16, 23},  /* 85 */
+    {  95, 0,  0, 20},  /* 86 */
+    {  95, 1,  0, 10},  /* 87 */
+    {  96, 2,  0, 10},  /* 88 */
+    {  98, 1,  0, 10},  /* 89 */
+    {  99, 1,  0, 10},  /* 90 */
+    { 100, 1,  0,  9},  /* 91 */
+    { 101, 0,  0, 18},  /* 92 */
+    { 101, 1,  0, 23},  /* 93 */
+    { 102, 1,  0, 23},  /* 94 */
+    { 103, 1,  0, 23},  /* 95 */
+    { 104, 1,  0, 23},  /* 96 */
+    { 105, 1,  0, 10},  /* 97 */
+    { 106, 1,  0, 10},  /* 98 */
+    { 107, 1,  0, 10},  /* 99 */
+    { 108, 1,  0, 10},  /* 100 */
+    { 109, 1,  0, 10},  /* 101 */
+    { 110, 1,  0,  9},  /* 102 */
+    { 111, 1,  0, 23},  /* 103 */
+    { 112, 1,  0, 23},  /* 104 */
+    { 113, 0, 12, 23},  /* 105 */
+    { 113, 0, 13, 23},  /* 106 */
+    { 113, 1,  0, 10},  /* 107 */
+    { 114, 1,  0, 10},  /* 108 */
+    { 115, 1,  0, 10},  /* 109 */
+    { 116, 1,  0, 10},  /* 110 */
+    { 117, 1,  0, 10},  /* 111 */
+    { 118, 1,  0,  9},  /* 112 */
+    { 119, 1,  0, 23},  /* 113 */
+    { 120, 1,  0, 23},  /* 114 */
+    { 121, 1,  0, 10},  /* 115 */
+    { 122, 1,  0, 10},  /* 116 */
+    { 123, 1,  0, 10},  /* 117 */
+    { 124, 1,  0, 10},  /* 118 */
+    { 125, 0,  4, 10},  /* 119 */
+    { 125, 1,  0,  9},  /* 120 */
+    { 126, 0, 14, 23},  /* 121 */
+    { 126, 0, 11, 23},  /* 122 */
+    { 126, 1,  0, 10},  /* 123 */
+    { 127, 1,  0, 10},  /* 124 */
+    { 128, 1,  0, 10},  /* 125 */
+    { 129, 0,  6, 10},  /* 126 */
+    { 129, 1,  0,  9},  /* 127 */
+    { 130, 1,  0, 10},  /* 128 */
+    { 131, 1,  0, 10},  /* 129 */
+    { 132, 1,  0, 10},  /* 130 */
+    { 133, 1,  0,  9},  /* 131 */
+    { 134, 0,  5, 10},  /* 132 */
+    { 134, 1,  0, 10},  /* 133 */
+    { 135, 0,  2, 10},  /* 134 */
+    { 135, 1,  0,  9},  /* 135 */
+    { 136, 0,  3, 10},  /* 136 */
+    { 136, 1,  0,  9},  /* 137 */
+    { 137, 1,  0,  9},  /* 138 */
+    { 138, 1,  0,  9},  /* 139 */
+    { 139, 1,  0,  9},  /* 140 */
+    { 140, 1,  0,  9},  /* 141 */
+    { 141, 1,  0,  9},  /* 142 */
+    { 142, 1,  0,  9},  /* 143 */
+    { 143, 1,  0,  9},  /* 144 */
+    { 144, 1,  0,  9},  /* 145 */
+    { 145, 1,  0,  9},  /* 146 */
+    { 146, 1,  0,  9},  /* 147 */
+    { 147, 1,  0,  9},  /* 148 */
+    { 148, 1,  0,  9},  /* 149 */
+    { 149, 1,  0,  9},  /* 150 */
+    { 150, 0,  7,  9},  /* 151 */
+};
+
+static const msg_edge_t MSG_EDGES[150] = {
+    {0,   2}, {1,   3}, {1,   4}, {8,   5}, {0,   6}, {7,   7},
+    {7,   8}, {5,   9}, {0,  10}, {1,  11}, {3,  12}, {1,  13},
+    {2,  14}, {3,  15}, {4,  16}, {5,  17}, {5,  18}, {0,  19},
+    {1,  20}, {4,  21}, {1,  22}, {1,  23}, {1,  24}, {5,  25},
+    {4,  26}, {3,  27}, {0,  28}, {5,  29}, {1,  30}, {4,  31},
+    {5,  32}, {4,  33}, {3,  34}, {1,  35}, {4,  36}, {5,  37},
+    {2,  38}, {6,  39}, {3,  40}, {1,  41}, {5,  42}, {4,  43},
+    {1,  44}, {5,  45}, {6,  46}, {2,  47}, {3,  48}, {4,  49},
+    {9,  50}, {1,  51}, {9,  52}, {3,  53}, {1,  54}, {3,  55},
+    {4,  56}, {1,  57}, {2,  58}, {1,  59}, {2,  60}, {1,  61},
+    {2,  62}, {3,  63}, {1,  64}, {1,  65}, {9,  66}, {3,  67},
+    {9,  68}, {3,  69}, {1,  70}, {9,  71}, {2,  72}, {2,  73},
+    {9,  74}, {9,  75}, {9,  76}, {6,  77}, {9,  78}, {9,  79},
+    {2,  80}, {9,  81}, {9,  82}, {1,  83}, {3,  84}, {1,  85},
+    {9,  86}, {2,  87}, {9,  88}, {1,  89}, {1,  90}, {1,  91},
+    {9,  92}, {1,  93}, {1,  94}, {1,  95}, {1,  96}, {6,  97},
+    {1,  98}, {2,  99}, {7, 100}, {6, 101}, {7, 102}, {1, 103},
+    {1, 104}, {2, 105}, {1, 106}, {1, 107}, {3, 108}, {3, 109},
+    {2, 110}, {4, 111}, {1, 112}, {1, 113}, {2, 114}, {6, 115},
+    {2, 116}, {2, 117}, {1, 118}, {2, 119}, {1, 120}, {1, 121},
+    {1, 122}, {1, 123}, {1, 124}, {4, 125}, {1, 126}, {5, 127},
+    {1, 128}, {2, 129}, {2, 130}, {1, 131}, {2, 132}, {2, 133},
+    {1, 134}, {5, 135}, {1, 136}, {1, 137}, {1, 138}, {2, 139},
+    {2, 140}, {9, 141}, {3, 142}, {5, 143}, {1, 144}, {3, 145},
+    {1, 146}, {3, 147}, {5, 148}, {1, 149}, {1, 150}, {1, 151},
+};
+
+static inline uint8_t msg_classify(int ch, const uint8_t *sym, int n)
+{
+    const msg_node_t *node = &MSG_NODES[ch ? MSG_ROOT_CH1 : MSG_ROOT_CH0];
+    for (int i = 0; i < n; i++) {
+        const msg_edge_t *e = &MSG_EDGES[node->edge0];
+        const msg_edge_t *end = e + node->nedge;
+        while (e < end && e->sym != sym[i]) e++;
+        if (e == end) return node->prefix;
+        node = &MSG_NODES[e->node];
+    }
+    return node->exact ? node->exact : node->prefix;
+}
+
+/* ── TYPE-B status fields (analyze.decode_type_b_state) ─────────── */
+#define TYPE_B_HEADER_LEN  8
+#define CROSSTALK_THRESH   10
+
+/* ── Crosstalk filter (analyze.suppress_crosstalk) ─────────────── */
+#define XTALK_GLITCH_US    13
+#define XTALK_WIN_US       5
+
+/* Door state: payload symbols 0-1 */
+enum {
+    TB_DOOR_IDLE_CLOSED,
+    TB_DOOR_IDLE_OPEN,
+    TB_DOOR_STARTING,
+    TB_DOOR_OPENING,
+    TB_DOOR_CLOSING,
+    TB_DOOR_STOPPED_MID_OPEN,
+    TB_DOOR_STOPPED_MID_CLOSE,
+    TB_DOOR_ARRIVED_OPEN,
+    TB_DOOR_ARRIVED_CLOSED,
+    TB_DOOR_OBSTRUCTION_REVERSAL,
+    TB_DOOR_IDLE_MID,
+    TB_DOOR_COUNT,
+    TB_DOOR_NONE = 0xFF
+};
+static const uint8_t TB_DOOR_KEYS[TB_DOOR_COUNT][2] = {
+    {2,6},
+    {9,4},
+    {1,6},
+    {1,2},
+    {1,3},
+    {3,1},
+    {2,1},
+    {5,3},
+    {2,2},
+    {1,1},
+    {3,5},
+};
+static const char *const TB_DOOR_NAMES[TB_DOOR_COUNT] = {
+    "IDLE_CLOSED",
+    "IDLE_OPEN",
+    "STARTING",
+    "OPENING",
+    "CLOSING",
+    "STOPPED_MID_OPEN",
+    "STOPPED_MID_CLOSE",
+    "ARRIVED_OPEN",
+    "ARRIVED_CLOSED",
+    "OBSTRUCTION_REVERSAL",
+    "IDLE_MID",
+};
+static inline uint8_t tb_door_lookup(const uint8_t *sym)
+{
+    for (int i = 0; i < TB_DOOR_COUNT; i++)
+        if (!memcmp(sym, TB_DOOR_KEYS[i], 2)) return (uint8_t)i;
+    return TB_DOOR_NONE;
+}
+
+/* Sub-state: payload symbols 2-4 */
+enum {
+    TB_SUB_ACTIVE,
+    TB_SUB_SETTLED,
+    TB_SUB_OBSTRUCTION,
+    TB_SUB_REVERSING,
+    TB_SUB_IDLE_OFF,
+    TB_SUB_AT_ENDPOINT,
+    TB_SUB_AT_ENDPOINT_2,
+    TB_SUB_ACTIVATING,
+    TB_SUB_ACTIVATING_2,
+    TB_SUB_IDLE_OPEN,
+    TB_SUB_REVERSAL_INIT,
+    TB_SUB_REVERSAL_INIT_2,
+    TB_SUB_FORCE_STOPPED,
+    TB_SUB_AT_ENDPOINT_3,
+    TB_SUB_COUNT,
+    TB_SUB_NONE = 0xFF
+};
+static const uint8_t TB_SUB_KEYS[TB_SUB_COUNT][3] = {
+    {3,4,4},
+    {3,4,2},
+    {3,3,3},
+    {3,3,4},
+    {4,2,1},
+    {4,3,1},
+    {4,3,2},
+    {4,4,1},
+    {4,4,9},
+    {3,9,1},
+    {1,3,3},
+    {1,3,4},
+    {3,4,3},
+    {4,3,9},
+};
+static const char *const TB_SUB_NAMES[TB_SUB_COUNT] = {
+    "ACTIVE",
+    "SETTLED",
+    "OBSTRUCTION",
+    "REVERSING",
+    "IDLE_OFF",
+    "AT_ENDPOINT",
+    "AT_ENDPOINT_2",
+    "ACTIVATING",
+    "ACTIVATING_2",
+    "IDLE_OPEN",
+    "REVERSAL_INIT",
+    "REVERSAL_INIT_2",
+    "FORCE_STOPPED",
+    "AT_ENDPOINT_3",
+};
+static inline uint8_t tb_sub_lookup(const uint8_t *sym)
+{
+    for (int i = 0; i < TB_SUB_COUNT; i++)
+        if (!memcmp(sym, TB_SUB_KEYS[i], 3)) return (uint8_t)i;
+    return TB_SUB_NONE;
+}
+
+/* Light: payload symbols 1-4, door closed or unknown only */
+enum {
+    TB_LIGHT_OFF,
+    TB_LIGHT_ON,
+    TB_LIGHT_COUNT,
+    TB_LIGHT_NONE = 0xFF
+};
+static const uint8_t TB_LIGHT_KEYS[TB_LIGHT_COUNT][4] = {
+    {6,4,2,1},
+    {2,3,4,2},
+};
+static const char *const TB_LIGHT_NAMES[TB_LIGHT_COUNT] = {
+    "OFF",
+    "ON",
+};
+static inline uint8_t tb_light_lookup(const uint8_t *sym)
+{
+    for (int i = 0; i < TB_LIGHT_COUNT; i++)
+        if (!memcmp(sym, TB_LIGHT_KEYS[i], 4)) return (uint8_t)i;
+    return TB_LIGHT_NONE;
+}
+
+/* ── Table patterns as symbols, for the traffic generator ───────── */
+typedef struct {
+    uint8_t  id;        /* MSG_* */
+    uint8_t  ch;
+    uint8_t  prefix;    /* 1 = header of a prefix entry, payload follows */
+    uint8_t  len;
+    uint16_t off;       /* into MSG_PATTERN_SYMS */
+} msg_pattern_t;
+
+#define MSG_NPATTERNS  24
+
+static const uint8_t MSG_PATTERN_SYMS[234] = {
+    0,0,0,0,0,3,  /* CMD-INIT */
+    1,7,1,1,5,1,4,2,9,2,3,2,4,2,1,  /* CMD-A */
+    1,7,1,1,5,1,4,2,9,1,3,2,1,2,2,1,  /* CMD-A1 */
+    1,7,1,1,5,5,2,9,1,6,4,2,  /* CMD-R */
+    1,7,1,1,5,1,3,2,2,6,1,6,1,1,2,  /* CMD-L */
+    1,7,1,1,5,5,1,9,1,7,2,1,1,  /* CMD-ECHO */
+    1,7,3,4,4,1,2,6,1,7,1,1,5,1,5,1,1,2,2,9,3,5,1,3,1,3,5,1,1,1,  /* CMD-B */
+    1,7,3,4,1,4,1,9,  /* CMD-B-INIT */
+    1,7,3,4,  /* CMD-B-? */
+    1,7,1,1,5,  /* CMD-? */
+    1,7,3,5,1,4,1,9,1,1,2,1,  /* ACK-A */
+    1,7,3,5,1,4,9,1,1,2,  /* ACK-A2 */
+    1,7,3,5,5,1,9,3,1,1,  /* ACK-R */
+    1,7,3,5,1,3,1,9,1,1,1,1,  /* ACK-L */
+    1,7,3,5,4,9,3,  /* ACK-B */
+    1,7,3,5,5,9,3,1,  /* ACK-B2 */
+    1,7,2,1,4,6,2,9,  /* TYPE-B */
+    1,7,3,1,3,2,3,2,9,  /* TYPE-C */
+    1,7,4,4,6,1,9,  /* HANDSHAKE-D */
+    1,7,4,4,2,3,1,9,  /* HANDSHAKE-E */
+    1,7,5,3,  /* BOOT-F */
+    1,7,1,1,5,5,1,9,  /* ECHO */
+    1,7,3,5,  /* ACK-? */
+    8,5,5,  /* BEACON */
+};
+
+static const msg_pattern_t MSG_PATTERNS[MSG_NPATTERNS] = {
+    {MSG_CMD_INIT, 0, 0, 6, 0},
+    {MSG_CMD_A, 0, 0, 15, 6},
+    {MSG_CMD_A1, 0, 0, 16, 21},
+    {MSG_CMD_R, 0, 0, 12, 37},
+    {MSG_CMD_L, 0, 0, 15, 49},
+    {MSG_CMD_ECHO, 0, 0, 13, 64},
+    {MSG_CMD_B, 0, 0, 30, 77},
+    {MSG_CMD_B_INIT, 0, 1, 8, 107},
+    {MSG_CMD_B_X, 0, 1, 4, 115},
+    {MSG_CMD_X, 0, 1, 5, 119},
+    {MSG_ACK_A, 1, 0, 12, 124},
+    {MSG_ACK_A2, 1, 0, 10, 136},
+    {MSG_ACK_R, 1, 0, 10, 146},
+    {MSG_ACK_L, 1, 0, 12, 156},
+    {MSG_ACK_B, 1, 0, 7, 168},
+    {MSG_ACK_B2, 1, 0, 8, 175},
+    {MSG_TYPE_B, 1, 1, 8, 183},
+    {MSG_TYPE_C, 1, 1, 9, 191},
+    {MSG_HANDSHAKE_D, 1, 1, 7, 200},
+    {MSG_HANDSHAKE_E, 1, 1, 8, 207},
+    {MSG_BOOT_F, 1, 1, 4, 215},
+    {MSG_ECHO, 1, 1, 8, 219},
+    {MSG_ACK_X, 1, 1, 4, 227},
+    {MSG_BEACON, 1, 1, 3, 231},
+};
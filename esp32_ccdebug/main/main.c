@@ -23,20 +23,32 @@
  * Boot sequence:
  *   Phase 1 — Connectivity test (non-destructive sanity checks)
  *   Phase 2 — Enter debug mode + identify chip
- *   Phase 3 — Check debug lock + halt CPU
+ *   Phase 3 — Check debug lock + halt CPU, calibrate debug clock
+ *             (CCDBG_CALIBRATE, off by default),
+ *             then serve host commands (program pages, block CRCs,
+ *             address ranges)
  *   Phase 4 — Read 32 KB flash → Intel HEX over USB serial
  *   Phase 5 — Release chip
  *
- * Output: Intel HEX records over USB serial at 115200 baud.
+ * Output: Intel HEX records over USB serial at 115200 baud, or on
+ *         request CRC-framed binary chunks (host_session() "BIN").
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "driver/usb_serial_jtag.h"
+#include "driver/usb_serial_jtag_vfs.h"
 #include "esp_timer.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "soc/gpio_struct.h"
 #include "rom/ets_sys.h"          /* ets_delay_us() */
 
 static const char *TAG = "ccdebug";
@@ -46,8 +58,32 @@ static const char *TAG = "ccdebug";
 #define PIN_DD    GPIO_NUM_3      /* Debug Data   → CC1110 P2.1 (pin 16) */
 #define PIN_RST   GPIO_NUM_4      /* RESET_N      → CC1110 pin 31 */
 
-/* ── Timing (microseconds) ─────────────────────────────────────── */
-#define T_CLK     10              /* half-clock period (≥ spec's ~1µs) */
+/* ── Timing ────────────────────────────────────────────────────── */
+#define T_CLK     10              /* µs, debug-entry pulses + initial half-clock */
+/*
+ * Calibration probes faster clocks until a read-back fails, i.e. it
+ * deliberately provokes bit errors: one flipped bit 6 turns DEBUG_INSTR
+ * (0x55..0x57) into CHIP_ERASE (0x14..0x17).  Only enable it on a chip
+ * whose flash has already been dumped and verified.
+ */
+#define CCDBG_CALIBRATE  0        /* 1 = search for the fastest reliable clock */
+#define HALF_NS_MIN      250      /* calibration floor: 2 MHz, as CCDBG_SPI_HZ;
+                                     never below the datasheet debug clock limit */
+#define CAL_MARGIN       2        /* run at this multiple of the fastest pass */
+
+/* ── Transport ─────────────────────────────────────────────────── */
+/*
+ * CCDBG_TRANSPORT_SPI = 1 hands DC/DD to the SPI2 peripheral once the
+ * chip has answered GET_CHIP_ID over the bit-banged bus: 3-wire
+ * half-duplex, DC as SCLK, DD as the shared data line, SPI mode 1
+ * (data changes on the rising edge, sampled on the falling edge — the
+ * same as write_bit()/read_bit()).  Debug entry always bit-bangs, since
+ * it needs DC edges while RESET_N is low.  The clock is fixed, so
+ * CCDBG_CALIBRATE only applies to the bit-banged bus.
+ */
+#define CCDBG_TRANSPORT_SPI  0
+#define CCDBG_SPI_HZ         2000000
+#define CCDBG_SPI_HOST       SPI2_HOST
 
 /* ── CC1110 debug opcodes (instruction table v2!) ──────────────── */
 #define CMD_READ_STATUS     0x34
@@ -75,29 +111,111 @@ static const char *TAG = "ccdebug";
 /* ── CC1110 SFR / register addresses ──────────────────────────── */
 #define SFR_MEMCTR  0xC7          /* memory control */
 #define SFR_FCTL    0xAE          /* flash control  */
+#define SFR_FADDRL  0xAC          /* flash word address */
+#define SFR_FADDRH  0xAD
+#define SFR_FWT     0xAB          /* flash write timing */
+#define SFR_CLKCON  0xC6          /* clock control */
+#define SFR_DMAARM  0xD6
+#define SFR_DMAIRQ  0xD1
+#define SFR_DMA0CFGL 0xD4         /* DMA channel 0 descriptor pointer */
+#define SFR_DMA0CFGH 0xD5
+#define SFR_DPS     0x92          /* data pointer select */
+#define SFR_DPL0    0x82          /* DPTR0 / DPTR1 */
+#define SFR_DPH0    0x83
+#define SFR_DPL1    0x84
+#define SFR_DPH1    0x85
+#define SFR_IE      0xA8          /* interrupt enable, EA = bit 7 */
+#define SFR_RNDL    0xBC          /* CRC / random: low byte, seed */
+#define SFR_RNDH    0xBD          /*   ...high byte, CRC input */
+#define XDATA_FWDATA 0xDFAF       /* FWDATA as seen by DMA (SFRs at 0xDF80+) */
+#define XDATA_RADIO 0xDF00        /* radio configuration registers */
+#define RADIO_SIZE  0x80
+#define XDATA_SRAM  0xF000        /* 4 KB SRAM */
+#define SRAM_SIZE   0x1000
+
+#define FCTL_BUSY   0x80
+#define FCTL_SWBSY  0x40
+#define FCTL_WRITE  0x02
+#define FCTL_ERASE  0x01
+
+#define CFG_DMA_PAUSE  0x04       /* debug config bit, see Phase 2f */
 
 /* ── Flash geometry ────────────────────────────────────────────── */
 #define FLASH_SIZE   (32 * 1024)  /* 32 KB */
 #define FLASH_BASE   0x0000
 #define BLOCK_SIZE   64           /* bytes per read iteration */
+#define PAGE_SIZE    1024         /* erase/program unit */
+
+/* ── Host commands (see host_session()) ────────────────────────── */
+#define CCDBG_HOST_CMDS  1        /* 1 = accept host commands after Phase 3 */
+#define CCDBG_PROGRAM    1        /* 1 = offer PROG mode (needs CCDBG_HOST_CMDS) */
+#define CMD_WAIT_MS      5000     /* wait this long for a command before dumping */
+#define PROG_IDLE_MS     30000    /* leave the session after this much silence */
+#define CRC_PER_LINE     8        /* block CRCs per "; CRC" line */
+#define BIN_CHUNK        256      /* data bytes per binary frame */
+#define BIN_BUFS         2        /* chunk buffers shared by reader and sender */
+#define PROF_MAX_WATCH   4        /* SFR/XDATA bytes recorded per PROF sample */
+#define XDATA_PAGE_BUF   0xF000   /* CC1110 SRAM: one page of image data */
+#define XDATA_DMA_DESC   0xF400   /*   ...followed by the DMA descriptor */
+
+/* ── SRAM helper stubs (see stub_run()) ────────────────────────── */
+#define CCDBG_STUB       1        /* 1 = compute block CRCs on the CC1110 itself */
+#define XDATA_STUB       0xF410   /* stub code, after the DMA descriptor */
+#define XDATA_STUB_OUT   0xF000   /* stub results (shares the page buffer) */
+#define STUB_WAIT_MS     2000     /* 16 KB at the slowest CLKSPD takes ~1 s */
+
+#if CCDBG_PROGRAM && !CCDBG_HOST_CMDS
+#error "CCDBG_PROGRAM needs CCDBG_HOST_CMDS"
+#endif
+#if CCDBG_STUB && !CCDBG_HOST_CMDS
+#error "CCDBG_STUB needs CCDBG_HOST_CMDS"
+#endif
 
 /* ── Low-level bit-bang ────────────────────────────────────────── */
 
-static inline void dc_high(void) { gpio_set_level(PIN_DC, 1); }
-static inline void dc_low(void)  { gpio_set_level(PIN_DC, 0); }
-static inline void dd_high(void) { gpio_set_level(PIN_DD, 1); }
-static inline void dd_low(void)  { gpio_set_level(PIN_DD, 0); }
-static inline int  dd_read(void) { return gpio_get_level(PIN_DD); }
-static inline void wait(void)    { ets_delay_us(T_CLK); }
+/*
+ * Pins are driven through the GPIO set/clear registers and DD changes
+ * direction through its output-enable bit only (the pad is configured
+ * INPUT_OUTPUT, so the input path is always live).  Half-clock delays
+ * spin on the CPU cycle counter, so the clock can run well below the
+ * 1 µs granularity of ets_delay_us().
+ */
+static uint32_t s_half_ns  = T_CLK * 1000;
+static uint32_t s_half_cyc;       /* s_half_ns in CPU cycles */
+static int      s_dd_out   = -1;  /* cached DD direction, -1 = unknown */
+
+static void set_half_ns(uint32_t ns)
+{
+    s_half_ns  = ns;
+    s_half_cyc = ns * esp_rom_get_cpu_ticks_per_us() / 1000;
+}
+
+static inline void dc_high(void) { GPIO.out_w1ts.val = 1u << PIN_DC; }
+static inline void dc_low(void)  { GPIO.out_w1tc.val = 1u << PIN_DC; }
+static inline void dd_high(void) { GPIO.out_w1ts.val = 1u << PIN_DD; }
+static inline void dd_low(void)  { GPIO.out_w1tc.val = 1u << PIN_DD; }
+static inline int  dd_read(void) { return (GPIO.in.val >> PIN_DD) & 1; }
+
+static inline void wait(void)
+{
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    while (esp_cpu_get_cycle_count() - t0 < s_half_cyc) { }
+}
 
 static void dd_output(void)
 {
-    gpio_set_direction(PIN_DD, GPIO_MODE_OUTPUT);
+    if (s_dd_out != 1) {
+        GPIO.enable_w1ts.val = 1u << PIN_DD;
+        s_dd_out = 1;
+    }
 }
 
 static void dd_input(void)
 {
-    gpio_set_direction(PIN_DD, GPIO_MODE_INPUT);
+    if (s_dd_out != 0) {
+        GPIO.enable_w1tc.val = 1u << PIN_DD;
+        s_dd_out = 0;
+    }
 }
 
 /*
@@ -131,23 +249,134 @@ static int read_bit(void)
     return b;
 }
 
+/* Clock out a byte MSB-first; DD must already be an output */
+static void clock_out(uint8_t v)
+{
+    for (int i = 7; i >= 0; i--)
+        write_bit((v >> i) & 1);
+}
+
+/* Clock in a byte MSB-first; DD must already be an input */
+static uint8_t clock_in(void)
+{
+    uint8_t v = 0;
+    for (int i = 7; i >= 0; i--)
+        v |= (read_bit() << i);
+    return v;
+}
+
+/* ── SPI transport ─────────────────────────────────────────────── */
+
+#if CCDBG_TRANSPORT_SPI
+static spi_device_handle_t s_spi;
+static bool s_spi_active;
+
+/*
+ * Transfers are a few bytes each, so they use the in-descriptor
+ * tx_data/rx_data buffers (≤ 4 bytes) and polling; longer ones go
+ * through the bus's DMA channel.  Transmit and receive are separate
+ * transactions: a dummy phase would clock DC, which the CC1110 counts.
+ */
+static void spi_tx(const uint8_t *b, int n)
+{
+    spi_transaction_t t = { .length = n * 8 };
+    if (n <= 4) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t.tx_data, b, n);
+    } else {
+        t.tx_buffer = b;
+    }
+    ESP_ERROR_CHECK(spi_device_polling_transmit(s_spi, &t));
+}
+
+static void spi_rx(uint8_t *b, int n)
+{
+    spi_transaction_t t = { .rxlength = n * 8 };
+    if (n <= 4)
+        t.flags = SPI_TRANS_USE_RXDATA;
+    else
+        t.rx_buffer = b;
+    ESP_ERROR_CHECK(spi_device_polling_transmit(s_spi, &t));
+    if (n <= 4)
+        memcpy(b, t.rx_data, n);
+}
+
+/* Route DC/DD to SPI2; from here on every debug command goes through it */
+static void spi_transport_init(void)
+{
+    spi_bus_config_t bus = {
+        .mosi_io_num     = PIN_DD,
+        .miso_io_num     = -1,
+        .sclk_io_num     = PIN_DC,
+        .quadwp_io_num   = -1,
+        .quadhd_io_num   = -1,
+        .max_transfer_sz = 64,
+    };
+    ESP_ERROR_CHECK(spi_bus_initialize(CCDBG_SPI_HOST, &bus, SPI_DMA_CH_AUTO));
+
+    spi_device_interface_config_t dev = {
+        .mode           = 1,
+        .clock_speed_hz = CCDBG_SPI_HZ,
+        .spics_io_num   = -1,
+        .flags          = SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX,
+        .queue_size     = 1,
+    };
+    ESP_ERROR_CHECK(spi_bus_add_device(CCDBG_SPI_HOST, &dev, &s_spi));
+    s_spi_active = true;
+}
+#endif
+
 /* Write a byte MSB-first */
 static void write_byte(uint8_t v)
 {
+#if CCDBG_TRANSPORT_SPI
+    if (s_spi_active) {
+        spi_tx(&v, 1);
+        return;
+    }
+#endif
     dd_output();
-    for (int i = 7; i >= 0; i--)
-        write_bit((v >> i) & 1);
+    clock_out(v);
 }
 
 /* Read a byte MSB-first */
 static uint8_t read_byte(void)
 {
+#if CCDBG_TRANSPORT_SPI
+    if (s_spi_active) {
+        uint8_t v;
+        ets_delay_us(2);  /* turnaround time for CC1110 to drive DD */
+        spi_rx(&v, 1);
+        return v;
+    }
+#endif
     dd_input();
     ets_delay_us(2);  /* turnaround time for CC1110 to drive DD */
-    uint8_t v = 0;
-    for (int i = 7; i >= 0; i--)
-        v |= (read_bit() << i);
-    return v;
+    return clock_in();
+}
+
+/*
+ * One debug command as a single bus transaction: command + operand bytes
+ * back to back, one turnaround, then the response bytes.  DD changes
+ * direction once each way instead of once per byte.
+ */
+static void debug_cmd(const uint8_t *tx, int ntx, uint8_t *rx, int nrx)
+{
+#if CCDBG_TRANSPORT_SPI
+    if (s_spi_active) {
+        spi_tx(tx, ntx);
+        ets_delay_us(2);  /* turnaround time for CC1110 to drive DD */
+        spi_rx(rx, nrx);
+        return;
+    }
+#endif
+    dd_output();
+    for (int i = 0; i < ntx; i++)
+        clock_out(tx[i]);
+    dd_input();
+    ets_delay_us(2);  /* turnaround time for CC1110 to drive DD */
+    for (int i = 0; i < nrx; i++)
+        rx[i] = clock_in();
 }
 
 /* ── Debug protocol commands ───────────────────────────────────── */
@@ -221,28 +450,28 @@ static uint8_t rd_config(void)
 /* Execute a 1-byte 8051 instruction, return accumulator */
 static uint8_t debug_instr_1(uint8_t b0)
 {
-    write_byte(CMD_DEBUG_INSTR_1);
-    write_byte(b0);
-    return read_byte();
+    const uint8_t tx[] = { CMD_DEBUG_INSTR_1, b0 };
+    uint8_t a;
+    debug_cmd(tx, sizeof(tx), &a, 1);
+    return a;
 }
 
 /* Execute a 2-byte 8051 instruction, return accumulator */
 static uint8_t debug_instr_2(uint8_t b0, uint8_t b1)
 {
-    write_byte(CMD_DEBUG_INSTR_2);
-    write_byte(b0);
-    write_byte(b1);
-    return read_byte();
+    const uint8_t tx[] = { CMD_DEBUG_INSTR_2, b0, b1 };
+    uint8_t a;
+    debug_cmd(tx, sizeof(tx), &a, 1);
+    return a;
 }
 
 /* Execute a 3-byte 8051 instruction, return accumulator */
 static uint8_t debug_instr_3(uint8_t b0, uint8_t b1, uint8_t b2)
 {
-    write_byte(CMD_DEBUG_INSTR_3);
-    write_byte(b0);
-    write_byte(b1);
-    write_byte(b2);
-    return read_byte();
+    const uint8_t tx[] = { CMD_DEBUG_INSTR_3, b0, b1, b2 };
+    uint8_t a;
+    debug_cmd(tx, sizeof(tx), &a, 1);
+    return a;
 }
 
 /* ── 8051 instruction helpers ──────────────────────────────────── */
@@ -271,18 +500,18 @@ static uint8_t movc_a_dptr(void)
     return debug_instr_1(0x93);
 }
 
-/* INC DPTR  →  0xA3 */
-static void inc_dptr(void)
-{
-    debug_instr_1(0xA3);
-}
-
 /* MOV direct, #imm  →  0x75  addr  imm */
 static void mov_sfr(uint8_t sfr_addr, uint8_t val)
 {
     debug_instr_3(0x75, sfr_addr, val);
 }
 
+/* MOV A, direct  →  0xE5  addr */
+static uint8_t rd_sfr(uint8_t sfr_addr)
+{
+    return debug_instr_2(0xE5, sfr_addr);
+}
+
 /* ── Flash reading ─────────────────────────────────────────────── */
 
 static uint8_t read_flash_byte(uint16_t addr)
@@ -294,18 +523,105 @@ static uint8_t read_flash_byte(uint16_t addr)
 
 /*
  * Read a block of flash via MOVC A,@A+DPTR.
- * Sets DPTR once, then reads sequential bytes using A=0 + INC DPTR.
+ *
+ * DPTR is set once per 256-byte window and A carries the offset, so
+ * each byte costs one MOV A,#off plus one MOVC — 7 bytes on the wire
+ * instead of 9 for CLR A / MOVC / INC DPTR.  The accumulator value is
+ * tracked across commands: the MOV is dropped when the byte just read
+ * already equals the next offset, and offset 0 uses the shorter CLR A.
  */
 static void read_flash_block(uint16_t addr, uint8_t *buf, int len)
 {
-    set_dptr(addr);
+    int win = -1;
+    int acc = -1;                       /* known A value, -1 = unknown */
     for (int i = 0; i < len; i++) {
-        clr_a();
+        uint16_t a = addr + i;
+        if ((a >> 8) != win) {
+            win = a >> 8;
+            set_dptr(a & 0xFF00);       /* leaves A untouched */
+        }
+        uint8_t off = a & 0xFF;
+        if (acc != off) {
+            if (off == 0) clr_a(); else mov_a_imm(off);
+        }
         buf[i] = movc_a_dptr();
-        if (i < len - 1)
-            inc_dptr();
+        acc = buf[i];
+    }
+}
+
+/* ── Clock calibration ─────────────────────────────────────────── */
+
+#if CCDBG_CALIBRATE && !CCDBG_TRANSPORT_SPI
+#define CAL_REF_LEN 16
+
+/*
+ * Known-answer check at the current clock: chip ID, accumulator echo of
+ * bit patterns, and a flash read compared against one taken at the slow
+ * clock.  Only read-type commands are sent.
+ */
+static bool bus_verify(uint16_t chip_id, const uint8_t *ref)
+{
+    static const uint8_t pat[] = { 0x00, 0xFF, 0x55, 0xAA, 0x0F, 0xF0, 0x81 };
+    uint8_t buf[CAL_REF_LEN];
+
+    if (get_chip_id() != chip_id)
+        return false;
+    for (int i = 0; i < (int)sizeof(pat); i++)
+        if (debug_instr_2(0x74, pat[i]) != pat[i])      /* MOV A,#pat */
+            return false;
+    read_flash_block(0x0000, buf, CAL_REF_LEN);
+    return memcmp(buf, ref, CAL_REF_LEN) == 0;
+}
+
+/*
+ * After a failed check the debug state machine may be out of frame, so
+ * nothing more is sent until the chip has been put back into debug mode
+ * (RESET_N + two DC edges) at the given clock and halted again.  This
+ * resets the receiver firmware.
+ */
+static void bus_resync(uint32_t half_ns)
+{
+    set_half_ns(half_ns);
+    enter_debug();
+    halt_cpu();
+}
+
+/*
+ * Halve the half-clock from the current (slow, known-good) setting until
+ * a read-back check fails or HALF_NS_MIN is reached, then settle at
+ * CAL_MARGIN × the fastest passing value.  Falls back to the starting
+ * clock if the chosen one does not verify.  Returns the chosen half-ns,
+ * or 0 if the bus no longer verifies even at the starting clock.
+ */
+static uint32_t calibrate_clock(uint16_t chip_id)
+{
+    uint32_t slow = s_half_ns, best = s_half_ns;
+    uint8_t ref[CAL_REF_LEN];
+
+    read_flash_block(0x0000, ref, CAL_REF_LEN);
+    for (uint32_t ns = slow / 2; ns >= HALF_NS_MIN; ns /= 2) {
+        set_half_ns(ns);
+        bool ok = true;
+        for (int rep = 0; rep < 4 && ok; rep++)
+            ok = bus_verify(chip_id, ref);
+        if (!ok) {
+            bus_resync(slow);
+            break;
+        }
+        best = ns;
+    }
+
+    uint32_t pick = best * CAL_MARGIN < slow ? best * CAL_MARGIN : slow;
+    set_half_ns(pick);
+    if (pick != slow && !bus_verify(chip_id, ref)) {
+        bus_resync(slow);
+        pick = slow;
     }
+    if (pick == slow && !bus_verify(chip_id, ref))
+        return 0;
+    return pick;
 }
+#endif
 
 /* ── Intel HEX output ──────────────────────────────────────────── */
 
@@ -327,6 +643,832 @@ static void emit_hex_eof(void)
     printf(":00000001FF\n");
 }
 
+/* Read [start, start+len) in BLOCK_SIZE pieces as 16-byte HEX records */
+static void emit_range_hex(uint16_t start, uint32_t len, bool progress)
+{
+    uint8_t block[BLOCK_SIZE];
+    int pct_last = -1;
+    int64_t t_start = esp_timer_get_time();
+
+    for (uint32_t done = 0; done < len; done += BLOCK_SIZE) {
+        uint32_t addr = start + done;
+        int n = BLOCK_SIZE;
+        if (done + n > len)
+            n = len - done;
+
+        read_flash_block((uint16_t)addr, block, n);
+
+        for (int off = 0; off < n; off += 16) {
+            int rec_len = (n - off > 16) ? 16 : (n - off);
+            emit_hex_record(0x00, (uint16_t)(addr + off),
+                            &block[off], rec_len);
+        }
+        fflush(stdout);
+
+        if (!progress)
+            continue;
+        int pct = (int)((done + n) * 100 / len);
+        if (pct != pct_last) {
+            int64_t elapsed = esp_timer_get_time() - t_start;
+            int secs = (int)(elapsed / 1000000);
+            ESP_LOGI(TAG, "Progress: %3d%%  (%5lu / %lu bytes)  [%d:%02d elapsed]",
+                     pct,
+                     (unsigned long)(done + n), (unsigned long)len,
+                     secs / 60, secs % 60);
+            pct_last = pct;
+        }
+    }
+}
+
+/* ── XDATA access ──────────────────────────────────────────────── */
+
+#if CCDBG_PROGRAM || CCDBG_STUB
+/* Write n bytes to XDATA via MOV A,#b / MOVX @DPTR,A / INC DPTR */
+static void xdata_write(uint16_t addr, const uint8_t *buf, int n)
+{
+    int acc = -1;
+    set_dptr(addr);
+    for (int i = 0; i < n; i++) {
+        if (acc != buf[i]) {
+            mov_a_imm(buf[i]);
+            acc = buf[i];
+        }
+        debug_instr_1(0xF0);        /* MOVX @DPTR, A */
+        debug_instr_1(0xA3);        /* INC DPTR */
+    }
+}
+
+#endif
+
+#if CCDBG_HOST_CMDS
+/*
+ * Set once the receiver's own RAM has been overwritten — the SRAM stub
+ * and its results (stub_run), the page buffer and DMA descriptor (PROG)
+ * — after which letting its firmware run again means nothing; PROF
+ * refuses from then on.
+ */
+static bool s_sram_clobbered;
+
+/* Read n bytes of XDATA via MOVX A,@DPTR / INC DPTR */
+static void read_xdata_block(uint16_t addr, uint8_t *buf, int n)
+{
+    set_dptr(addr);
+    for (int i = 0; i < n; i++) {
+        buf[i] = debug_instr_1(0xE0);   /* MOVX A, @DPTR */
+        debug_instr_1(0xA3);            /* INC DPTR */
+    }
+}
+#endif
+
+/* ── SRAM helper stubs ─────────────────────────────────────────── */
+
+#if CCDBG_STUB
+/*
+ * A stub is 8051 code written into SRAM (mapped into CODE space at
+ * 0xF000), entered with a debug LJMP + RESUME, and ended with the 0xA5
+ * trap opcode, which halts the CPU back into debug mode.  EA is cleared
+ * first so the halted firmware's interrupt handlers stay out of it.
+ *
+ * The CPU state the stub was entered with — PC, IE, A, DPS, both DPTRs,
+ * R6/R7 and the RNDH:RNDL CRC register — is saved first and put back
+ * once the trap halts it, with a debug LJMP back to the saved PC, so
+ * READ_STATUS / RESUME see the firmware where it was halted.  What stays
+ * clobbered is SRAM: the stub at XDATA_STUB and its results at
+ * XDATA_STUB_OUT, both inside the receiver's own RAM.
+ *
+ * The debug protocol has no burst read — results still come back one
+ * MOVX at a time — so a stub only pays off when it shrinks the data:
+ * the CRC stub turns 64 flash bytes into 2 result bytes.
+ */
+typedef struct {
+    uint16_t pc, dptr[2];
+    uint8_t  ie, a, dps, r6, r7, rndh, rndl;
+} cpu_ctx_t;
+
+static void cpu_save(cpu_ctx_t *x)
+{
+    x->pc   = get_pc();
+    x->a    = debug_instr_1(0x00);              /* NOP returns A */
+    x->r6   = debug_instr_1(0xEE);              /* MOV A, R6 */
+    x->r7   = debug_instr_1(0xEF);              /* MOV A, R7 */
+    x->ie   = rd_sfr(SFR_IE);
+    x->dps  = rd_sfr(SFR_DPS);
+    x->dptr[0] = (uint16_t)(rd_sfr(SFR_DPH0) << 8 | rd_sfr(SFR_DPL0));
+    x->dptr[1] = (uint16_t)(rd_sfr(SFR_DPH1) << 8 | rd_sfr(SFR_DPL1));
+    x->rndh = rd_sfr(SFR_RNDH);
+    x->rndl = rd_sfr(SFR_RNDL);
+}
+
+static void cpu_restore(const cpu_ctx_t *x)
+{
+    mov_sfr(SFR_RNDL, x->rndh);                 /* each write shifts RNDL → RNDH */
+    mov_sfr(SFR_RNDL, x->rndl);
+    mov_sfr(SFR_DPL0, x->dptr[0] & 0xFF);
+    mov_sfr(SFR_DPH0, x->dptr[0] >> 8);
+    mov_sfr(SFR_DPL1, x->dptr[1] & 0xFF);
+    mov_sfr(SFR_DPH1, x->dptr[1] >> 8);
+    mov_sfr(SFR_DPS, x->dps);
+    debug_instr_2(0x7E, x->r6);                 /* MOV R6, #imm */
+    debug_instr_2(0x7F, x->r7);                 /* MOV R7, #imm */
+    mov_sfr(SFR_IE, x->ie);
+    mov_a_imm(x->a);
+    debug_instr_3(0x02, x->pc >> 8, x->pc & 0xFF);             /* LJMP */
+}
+
+static bool stub_run(const uint8_t *code, int n, int timeout_ms)
+{
+    cpu_ctx_t ctx;
+    bool ok = true;
+
+    cpu_save(&ctx);
+    s_sram_clobbered = true;
+    xdata_write(XDATA_STUB, code, n);
+    debug_instr_2(0xC2, 0xAF);                  /* CLR EA */
+    debug_instr_3(0x02, XDATA_STUB >> 8, XDATA_STUB & 0xFF);   /* LJMP */
+    resume_cpu();
+
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (!(read_status() & STATUS_CPU_HALTED)) {
+        if (esp_timer_get_time() > deadline) {
+            halt_cpu();
+            ESP_LOGW(TAG, "      Stub did not halt (PC=0x%04X)", get_pc());
+            ok = false;
+            break;
+        }
+    }
+    cpu_restore(&ctx);
+    return ok;
+}
+
+/*
+ * CRC of nblocks (1..256) BLOCK_SIZE blocks from flash at src, written
+ * as RNDH,RNDL pairs to XDATA at out.  DPTR0 walks flash, DPTR1 the
+ * output.
+ */
+static const uint8_t s_crc_stub[] = {
+    0x75, SFR_DPS, 0x00,        /*  0      MOV  DPS,#0          */
+    0x90, 0x00, 0x00,           /*  3      MOV  DPTR,#src       */
+    0x75, SFR_DPS, 0x01,        /*  6      MOV  DPS,#1          */
+    0x90, 0x00, 0x00,           /*  9      MOV  DPTR,#out       */
+    0x7F, 0x00,                 /* 12      MOV  R7,#nblocks     */
+    0x75, SFR_DPS, 0x00,        /* 14 blk: MOV  DPS,#0          */
+    0x75, SFR_RNDL, 0xFF,       /* 17      MOV  RNDL,#0FFh      */
+    0x75, SFR_RNDL, 0xFF,       /* 20      MOV  RNDL,#0FFh      */
+    0x7E, BLOCK_SIZE,           /* 23      MOV  R6,#BLOCK_SIZE  */
+    0xE4,                       /* 25 byt: CLR  A               */
+    0x93,                       /* 26      MOVC A,@A+DPTR       */
+    0xF5, SFR_RNDH,             /* 27      MOV  RNDH,A          */
+    0xA3,                       /* 29      INC  DPTR            */
+    0xDE, 0xF9,                 /* 30      DJNZ R6,byt          */
+    0x75, SFR_DPS, 0x01,        /* 32      MOV  DPS,#1          */
+    0xE5, SFR_RNDH,             /* 35      MOV  A,RNDH          */
+    0xF0,                       /* 37      MOVX @DPTR,A         */
+    0xA3,                       /* 38      INC  DPTR            */
+    0xE5, SFR_RNDL,             /* 39      MOV  A,RNDL          */
+    0xF0,                       /* 41      MOVX @DPTR,A         */
+    0xA3,                       /* 42      INC  DPTR            */
+    0xDF, 0xE1,                 /* 43      DJNZ R7,blk          */
+    0x75, SFR_DPS, 0x00,        /* 45      MOV  DPS,#0          */
+    0xA5,                       /* 48      trap → halt          */
+};
+
+/* Fill crcs[] for the whole flash, 256 blocks per stub run */
+static bool stub_crc_blocks(uint16_t *crcs)
+{
+    static uint8_t out[2 * 256];
+    uint8_t code[sizeof(s_crc_stub)];
+    const int nblocks = FLASH_SIZE / BLOCK_SIZE;
+
+    for (int first = 0; first < nblocks; first += 256) {
+        int n = (nblocks - first > 256) ? 256 : nblocks - first;
+        uint16_t src = (uint16_t)(first * BLOCK_SIZE);
+
+        memcpy(code, s_crc_stub, sizeof(code));
+        code[4]  = src >> 8;            code[5]  = src & 0xFF;
+        code[10] = XDATA_STUB_OUT >> 8; code[11] = XDATA_STUB_OUT & 0xFF;
+        code[13] = (uint8_t)n;          /* 256 → 0, DJNZ wraps */
+        if (!stub_run(code, sizeof(code), STUB_WAIT_MS))
+            return false;
+
+        read_xdata_block(XDATA_STUB_OUT, out, 2 * n);
+        for (int i = 0; i < n; i++)
+            crcs[first + i] = (uint16_t)(out[2 * i] << 8 | out[2 * i + 1]);
+    }
+    return true;
+}
+#endif /* CCDBG_STUB */
+
+/* ── Flash programming ─────────────────────────────────────────── */
+
+#if CCDBG_PROGRAM
+/*
+ * Pages are programmed the way the CC1110 flash controller expects bulk
+ * writes: the image is written into SRAM at XDATA_PAGE_BUF with debug
+ * MOVX instructions, the page is erased, then DMA channel 0 feeds it to
+ * FWDATA (trigger 18 = FLASH) while FCTL.WRITE runs.  The CPU stays
+ * halted throughout; only DMA must not be paused (debug config bit 2).
+ */
+
+/* Poll FCTL until BUSY/SWBSY clear; false on timeout */
+static bool flash_wait_idle(int timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (rd_sfr(SFR_FCTL) & (FCTL_BUSY | FCTL_SWBSY)) {
+        if (esp_timer_get_time() > deadline)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * One-time setup before the first page: DMA descriptor for
+ * SRAM → FWDATA, DMA not paused while halted, and FWT for the current
+ * system clock (FWT = 21·f / 16 MHz, f = 26 MHz >> CLKCON.CLKSPD).
+ */
+static void flash_prog_init(void)
+{
+    const uint8_t desc[8] = {
+        XDATA_PAGE_BUF >> 8, XDATA_PAGE_BUF & 0xFF,     /* SRCADDR */
+        XDATA_FWDATA >> 8, XDATA_FWDATA & 0xFF,         /* DESTADDR */
+        (PAGE_SIZE >> 8) & 0x1F, PAGE_SIZE & 0xFF,      /* VLEN=0, LEN */
+        0x12,           /* WORDSIZE=byte, TMODE=single, TRIG=18 (FLASH) */
+        0x42,           /* SRCINC=+1, DESTINC=0, no IRQ, PRIORITY=high */
+    };
+    s_sram_clobbered = true;
+    xdata_write(XDATA_DMA_DESC, desc, sizeof(desc));
+    mov_sfr(SFR_DMA0CFGH, XDATA_DMA_DESC >> 8);
+    mov_sfr(SFR_DMA0CFGL, XDATA_DMA_DESC & 0xFF);
+
+    wr_config(rd_config() & ~CFG_DMA_PAUSE);
+
+    uint32_t f_khz = 26000 >> (rd_sfr(SFR_CLKCON) & 0x07);
+    uint8_t fwt = (uint8_t)((21 * f_khz + 15999) / 16000);
+    mov_sfr(SFR_FWT, fwt);
+    ESP_LOGI(TAG, "      Flash programming ready (FWT=0x%02X @ %lu kHz)",
+             fwt, (unsigned long)f_khz);
+}
+
+/* Erase, program and verify one page; returns NULL or an error string */
+static const char *flash_program_page(int page, const uint8_t *data)
+{
+    static uint8_t verify[PAGE_SIZE];
+    uint16_t waddr = (uint16_t)(page * PAGE_SIZE / 2);  /* word address */
+
+    xdata_write(XDATA_PAGE_BUF, data, PAGE_SIZE);
+
+    if (!flash_wait_idle(100))
+        return "controller busy";
+    mov_sfr(SFR_FADDRH, waddr >> 8);
+    mov_sfr(SFR_FADDRL, waddr & 0xFF);
+    mov_sfr(SFR_FCTL, FCTL_ERASE);
+    if (!flash_wait_idle(100))
+        return "erase timeout";
+
+    mov_sfr(SFR_DMAIRQ, 0x00);
+    mov_sfr(SFR_DMAARM, 0x01);          /* arm channel 0 */
+    mov_sfr(SFR_FCTL, FCTL_WRITE);
+    if (!flash_wait_idle(100))
+        return "write timeout";
+
+    read_flash_block((uint16_t)(page * PAGE_SIZE), verify, PAGE_SIZE);
+    if (memcmp(verify, data, PAGE_SIZE) != 0)
+        return "verify mismatch";
+    return NULL;
+}
+
+#endif /* CCDBG_PROGRAM */
+
+/* ── Host command channel ──────────────────────────────────────── */
+
+#if CCDBG_HOST_CMDS
+/*
+ * Block CRC as the CC1110's own CRC unit computes it: RNDL written twice
+ * with 0xFF seeds 0xFFFF, each byte written to RNDH is shifted in MSB
+ * first through x^16 + x^15 + x^2 + 1, and RNDH:RNDL reads the result.
+ * crc_blocks() has the chip do it with the SRAM stub; this is the
+ * reference for checking the stub and the fallback without it.
+ */
+static uint16_t crc16_rndh(const uint8_t *p, int n)
+{
+    uint16_t crc = 0xFFFF;
+    while (n--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+    return crc;
+}
+
+/* CRC-16/CCITT-FALSE, as binascii.crc_hqx(data, crc) on the host */
+static uint16_t crc16_ccitt(uint16_t crc, const uint8_t *p, int n)
+{
+    while (n--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static int hexval(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* Parse 2·n hex digits into buf; false on a bad digit */
+static bool parse_hex(const char *s, uint8_t *buf, int n)
+{
+    for (int i = 0; i < n; i++) {
+        int hi = hexval(s[2 * i]), lo = hexval(s[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        buf[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+/* Read one '\n'-terminated line (CR dropped); -1 on timeout */
+static int read_line(char *buf, int max, int timeout_ms)
+{
+    int n = 0;
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (esp_timer_get_time() < deadline) {
+        char c;
+        if (usb_serial_jtag_read_bytes(&c, 1, pdMS_TO_TICKS(20)) != 1)
+            continue;
+        if (c == '\r')
+            continue;
+        if (c == '\n') {
+            buf[n] = '\0';
+            return n;
+        }
+        if (n < max - 1)
+            buf[n++] = c;
+    }
+    return -1;
+}
+
+/*
+ * "CRC": one CRC per BLOCK_SIZE block, CRC_PER_LINE to a line:
+ *     ; CRC BEGIN block=64 size=32768
+ *     ; CRC <addr hex4> <crc hex4> <crc hex4> ...
+ *     ; CRC END
+ */
+static void crc_blocks(void)
+{
+    static uint16_t crcs[FLASH_SIZE / BLOCK_SIZE];
+    uint8_t block[BLOCK_SIZE];
+    bool on_chip = false;
+    int64_t t_start = esp_timer_get_time();
+
+#if CCDBG_STUB
+    /* Trust the stub only if block 0 matches a direct read */
+    on_chip = stub_crc_blocks(crcs);
+    if (on_chip) {
+        read_flash_block(0x0000, block, BLOCK_SIZE);
+        if (crc16_rndh(block, BLOCK_SIZE) != crcs[0]) {
+            ESP_LOGW(TAG, "      Stub CRC 0x%04X != 0x%04X — computing here",
+                     crcs[0], crc16_rndh(block, BLOCK_SIZE));
+            on_chip = false;
+        }
+    }
+#endif
+    if (!on_chip) {
+        for (int b = 0; b < FLASH_SIZE / BLOCK_SIZE; b++) {
+            read_flash_block((uint16_t)(b * BLOCK_SIZE), block, BLOCK_SIZE);
+            crcs[b] = crc16_rndh(block, BLOCK_SIZE);
+        }
+    }
+
+    printf("; CRC BEGIN block=%d size=%d\n", BLOCK_SIZE, FLASH_SIZE);
+    for (int b = 0; b < FLASH_SIZE / BLOCK_SIZE; b++) {
+        if (b % CRC_PER_LINE == 0)
+            printf("; CRC %04X", b * BLOCK_SIZE);
+        printf(" %04X", crcs[b]);
+        if (b % CRC_PER_LINE == CRC_PER_LINE - 1 || b == FLASH_SIZE / BLOCK_SIZE - 1)
+            printf("\n");
+    }
+    printf("; CRC END\n");
+    fflush(stdout);
+    ESP_LOGI(TAG, "      %d block CRCs %s in %lld ms", FLASH_SIZE / BLOCK_SIZE,
+             on_chip ? "on-chip" : "via debug reads",
+             (long long)((esp_timer_get_time() - t_start) / 1000));
+}
+
+/*
+ * "BIN aaaa nnnn": the range as binary frames instead of HEX text,
+ *     ; BIN BEGIN addr=aaaa len=n chunk=256 space=code
+ *     frame × ceil(n / chunk):  A5 'B' <addr u16> <len u16> <data> <crc u16>
+ *     ; BIN END frames=k
+ * all little-endian, crc = CRC-16/CCITT-FALSE over addr..data.  Frames
+ * go straight to the USB driver (stdout would expand '\n' to CRLF).
+ * The debug-bus reader and a sender task hand BIN_BUFS chunk buffers
+ * back and forth, so chunk N+1 is read while chunk N drains over USB.
+ */
+typedef struct {
+    uint8_t  kind;                      /* 'B' data, 'P' profiler samples */
+    uint16_t addr;
+    uint16_t len;
+    uint8_t  data[BIN_CHUNK];
+} bin_chunk_t;
+
+static bin_chunk_t   s_bin_chunks[BIN_BUFS];
+static QueueHandle_t s_bin_free, s_bin_full;
+
+static void bin_sender_task(void *arg)
+{
+    for (;;) {
+        bin_chunk_t *c;
+        xQueueReceive(s_bin_full, &c, portMAX_DELAY);
+
+        uint8_t hdr[6] = { 0xA5, c->kind, c->addr & 0xFF, c->addr >> 8,
+                           c->len & 0xFF, c->len >> 8 };
+        uint16_t crc = crc16_ccitt(0xFFFF, hdr + 2, 4);
+        crc = crc16_ccitt(crc, c->data, c->len);
+        uint8_t tail[2] = { crc & 0xFF, crc >> 8 };
+
+        usb_serial_jtag_write_bytes(hdr, sizeof(hdr), portMAX_DELAY);
+        usb_serial_jtag_write_bytes(c->data, c->len, portMAX_DELAY);
+        usb_serial_jtag_write_bytes(tail, sizeof(tail), portMAX_DELAY);
+
+        xQueueSend(s_bin_free, &c, portMAX_DELAY);
+    }
+}
+
+static void bin_init(void)
+{
+    if (s_bin_free)
+        return;
+    s_bin_free = xQueueCreate(BIN_BUFS, sizeof(bin_chunk_t *));
+    s_bin_full = xQueueCreate(BIN_BUFS, sizeof(bin_chunk_t *));
+    for (int i = 0; i < BIN_BUFS; i++) {
+        bin_chunk_t *c = &s_bin_chunks[i];
+        xQueueSend(s_bin_free, &c, 0);
+    }
+    xTaskCreate(bin_sender_task, "bin_tx", 2048, NULL, 5, NULL);
+}
+
+/* Wait for the sender to hand every buffer back */
+static void bin_drain(void)
+{
+    bin_chunk_t *held[BIN_BUFS];
+    for (int i = 0; i < BIN_BUFS; i++)
+        xQueueReceive(s_bin_free, &held[i], portMAX_DELAY);
+    for (int i = 0; i < BIN_BUFS; i++)
+        xQueueSend(s_bin_free, &held[i], 0);
+}
+
+static void bin_range(uint16_t start, uint32_t len, bool xdata)
+{
+    bin_init();
+
+    printf("; BIN BEGIN addr=%04X len=%lu chunk=%d space=%s\n",
+           start, (unsigned long)len, BIN_CHUNK, xdata ? "xdata" : "code");
+    fflush(stdout);
+
+    int frames = 0;
+    int64_t t_start = esp_timer_get_time();
+    for (uint32_t done = 0; done < len; done += BIN_CHUNK) {
+        bin_chunk_t *c;
+        xQueueReceive(s_bin_free, &c, portMAX_DELAY);
+        c->kind = 'B';
+        c->addr = (uint16_t)(start + done);
+        c->len  = (uint16_t)((len - done > BIN_CHUNK) ? BIN_CHUNK : len - done);
+        if (xdata)
+            read_xdata_block(c->addr, c->data, c->len);
+        else
+            read_flash_block(c->addr, c->data, c->len);
+        xQueueSend(s_bin_full, &c, portMAX_DELAY);
+        frames++;
+    }
+
+    bin_drain();
+
+    int64_t t_total = esp_timer_get_time() - t_start;
+    printf("; BIN END frames=%d\n", frames);
+    fflush(stdout);
+    ESP_LOGI(TAG, "      BIN %lu bytes in %lld ms (%lu B/s)", (unsigned long)len,
+             (long long)(t_total / 1000),
+             (unsigned long)((int64_t)len * 1000000 / (t_total ? t_total : 1)));
+}
+
+/*
+ * "PROF tttt pppp [Saa|Xaaaa]...": sampling profiler.  For tttt ms the
+ * CPU runs, and every pppp µs (±50 % random jitter, so periodic code is
+ * not aliased) it is halted, its PC and up to PROF_MAX_WATCH SFR (S) or
+ * XDATA (X) bytes are read, and it is resumed.  A and the selected
+ * DPTR are saved and restored around the watch reads; DPS is only read,
+ * to find which DPTR that is.  Records are
+ *     <dt µs u16> <pc u16> <watch u8 × n>
+ * with dt the time since the previous sample, packed into 'P' frames
+ * (addr = index of the first record) with the BIN framing:
+ *     ; PROF BEGIN period=pppp watches=S80,XF0A0 rec=6
+ *     'P' frames
+ *     ; PROF END samples=k pause_avg=us pause_max=us
+ * The CPU is left halted afterwards, as the rest of the session expects.
+ *
+ * PROF must come before CRC and PROG: both overwrite the receiver's RAM
+ * (s_sram_clobbered), and its firmware run on top of that would give a
+ * plausible-looking but meaningless profile, so PROF then answers
+ *     ; PROF ERR state
+ * and the chip has to be reset (a new session) to profile it.
+ */
+typedef struct {
+    bool     xdata;
+    uint16_t addr;
+} watch_t;
+
+static uint32_t prof_rand(void)
+{
+    static uint32_t x = 0x2545F491;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static void profile(char *args)
+{
+    watch_t w[PROF_MAX_WATCH];
+    int nw = 0;
+    bool any_x = false;
+
+    char *tok = strtok(args, " ");
+    uint32_t ms = tok ? strtoul(tok, NULL, 16) : 0;
+    tok = strtok(NULL, " ");
+    uint32_t period = tok ? strtoul(tok, NULL, 16) : 0;
+    while ((tok = strtok(NULL, " ")) != NULL) {
+        if (nw == PROF_MAX_WATCH || (tok[0] != 'S' && tok[0] != 'X')) {
+            printf("; PROF ERR watch %s\n", tok);
+            return;
+        }
+        w[nw].xdata = tok[0] == 'X';
+        w[nw].addr  = (uint16_t)strtoul(tok + 1, NULL, 16);
+        any_x |= w[nw].xdata;
+        nw++;
+    }
+    if (ms == 0 || period == 0) {
+        printf("; PROF ERR args\n");
+        return;
+    }
+    if (s_sram_clobbered) {
+        printf("; PROF ERR state\n");
+        return;
+    }
+
+    bin_init();
+    const int rec = 4 + nw;
+    printf("; PROF BEGIN period=%lu watches=", (unsigned long)period);
+    for (int i = 0; i < nw; i++)
+        printf(w[i].xdata ? "%sX%04X" : "%sS%02X", i ? "," : "", w[i].addr);
+    printf(" rec=%d\n", rec);
+    fflush(stdout);
+
+    const uint32_t cyc_per_us = esp_rom_get_cpu_ticks_per_us();
+    uint32_t samples = 0, pause_max = 0;
+    uint64_t pause_sum = 0;
+    int64_t t_end = esp_timer_get_time() + (int64_t)ms * 1000;
+    int64_t t_prev = esp_timer_get_time();
+    bin_chunk_t *c = NULL;
+
+    resume_cpu();
+    while (esp_timer_get_time() < t_end) {
+        ets_delay_us(period / 2 + prof_rand() % (period + 1));
+
+        if (!c) {
+            xQueueReceive(s_bin_free, &c, portMAX_DELAY);
+            c->kind = 'P';
+            c->addr = (uint16_t)samples;
+            c->len  = 0;
+        }
+        uint8_t *r = c->data + c->len;
+
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        halt_cpu();
+        uint16_t pc = get_pc();
+        if (nw) {
+            uint8_t a = debug_instr_1(0x00);            /* NOP returns A */
+            uint8_t dps = 0, dpl = 0, dph = 0;
+            if (any_x) {
+                dps = rd_sfr(SFR_DPS) & 1;
+                dpl = rd_sfr(dps ? SFR_DPL1 : SFR_DPL0);
+                dph = rd_sfr(dps ? SFR_DPH1 : SFR_DPH0);
+            }
+            for (int i = 0; i < nw; i++) {
+                if (w[i].xdata) {
+                    set_dptr(w[i].addr);
+                    r[4 + i] = debug_instr_1(0xE0);     /* MOVX A, @DPTR */
+                } else {
+                    r[4 + i] = rd_sfr((uint8_t)w[i].addr);
+                }
+            }
+            if (any_x)
+                set_dptr((uint16_t)(dph << 8 | dpl));
+            mov_a_imm(a);
+        }
+        resume_cpu();
+        uint32_t pause = (esp_cpu_get_cycle_count() - t0) / cyc_per_us;
+
+        int64_t now = esp_timer_get_time();
+        uint32_t dt = (uint32_t)(now - t_prev);
+        t_prev = now;
+        if (dt > 0xFFFF)
+            dt = 0xFFFF;
+        r[0] = dt & 0xFF;  r[1] = dt >> 8;
+        r[2] = pc & 0xFF;  r[3] = pc >> 8;
+
+        samples++;
+        pause_sum += pause;
+        if (pause > pause_max)
+            pause_max = pause;
+        c->len += rec;
+        if (c->len + rec > BIN_CHUNK) {
+            xQueueSend(s_bin_full, &c, portMAX_DELAY);
+            c = NULL;
+        }
+    }
+    halt_cpu();
+    if (c && c->len)
+        xQueueSend(s_bin_full, &c, portMAX_DELAY);
+    else if (c)
+        xQueueSend(s_bin_free, &c, portMAX_DELAY);
+    bin_drain();
+
+    printf("; PROF END samples=%lu pause_avg=%lu pause_max=%lu\n",
+           (unsigned long)samples,
+           (unsigned long)(samples ? pause_sum / samples : 0),
+           (unsigned long)pause_max);
+    fflush(stdout);
+    ESP_LOGI(TAG, "      PROF %lu samples, pause avg %lu µs / max %lu µs",
+             (unsigned long)samples,
+             (unsigned long)(samples ? pause_sum / samples : 0),
+             (unsigned long)pause_max);
+}
+
+/*
+ * "SNAP": the halted receiver's state, before anything else touches SRAM
+ * (PROG and the CRC stub both use it):
+ *     ; SNAP BEGIN
+ *     ; SFR <base hex2> <16 values>      × 8, 0x80..0xFF
+ *     BIN reply, space=xdata: radio registers 0xDF00..0xDF7F
+ *     BIN reply, space=xdata: SRAM 0xF000..0xFFFF
+ *     ; SNAP END
+ * A, DPTR and DPS hold the debugger's values by now, not the firmware's.
+ * SFRs whose read pops a FIFO (U0DBUF, RFD, U1DBUF) print as "--".
+ */
+static void snapshot(void)
+{
+    static const uint8_t skip[] = { 0xC1, 0xD9, 0xF9 };
+
+    printf("; SNAP BEGIN\n");
+    for (int base = 0x80; base < 0x100; base += 16) {
+        printf("; SFR %02X", base);
+        for (int a = base; a < base + 16; a++) {
+            if (memchr(skip, a, sizeof(skip)))
+                printf(" --");
+            else
+                printf(" %02X", rd_sfr((uint8_t)a));
+        }
+        printf("\n");
+    }
+    bin_range(XDATA_RADIO, RADIO_SIZE, true);
+    bin_range(XDATA_SRAM, SRAM_SIZE, true);
+    printf("; SNAP END\n");
+    fflush(stdout);
+}
+
+#if CCDBG_PROGRAM
+/*
+ * In PROG mode each line is one page:
+ *     W <page hex2> <PAGE_SIZE bytes as hex> <crc16 hex4>
+ * answered by "; W pp OK" or "; W pp ERR <reason>" once the page is
+ * erased, programmed and verified.  "END" returns to the command prompt,
+ * where the host can check the result with CRC.
+ */
+static void prog_session(char *line, int max)
+{
+    static uint8_t page_buf[PAGE_SIZE];
+
+    flash_prog_init();
+    printf("; PROG READY page=%d\n", PAGE_SIZE);
+    fflush(stdout);
+
+    int pages = 0, errors = 0;
+    for (;;) {
+        int n = read_line(line, max, PROG_IDLE_MS);
+        if (n < 0) {
+            ESP_LOGW(TAG, "      Host went quiet — leaving PROG mode.");
+            break;
+        }
+        if (strcmp(line, "END") == 0)
+            break;
+
+        uint8_t page = 0, crc_be[2];
+        const char *err = NULL;
+        if (n != 2 + 2 + 1 + 2 * PAGE_SIZE + 1 + 4 || line[0] != 'W' ||
+            !parse_hex(line + 2, &page, 1) ||
+            !parse_hex(line + 5, page_buf, PAGE_SIZE) ||
+            !parse_hex(line + 6 + 2 * PAGE_SIZE, crc_be, 2)) {
+            err = "bad line";
+        } else if (page >= FLASH_SIZE / PAGE_SIZE) {
+            err = "bad page";
+        } else if (crc16_ccitt(0xFFFF, page_buf, PAGE_SIZE) != ((crc_be[0] << 8) | crc_be[1])) {
+            err = "bad crc";
+        } else {
+            err = flash_program_page(page, page_buf);
+        }
+
+        if (err) {
+            errors++;
+            printf("; W %02X ERR %s\n", page, err);
+        } else {
+            pages++;
+            printf("; W %02X OK\n", page);
+        }
+        fflush(stdout);
+    }
+
+    printf("; PROG DONE pages=%d errors=%d\n", pages, errors);
+    fflush(stdout);
+    ESP_LOGI(TAG, "      PROG mode done: %d pages written, %d errors.", pages, errors);
+}
+#endif
+
+/*
+ * After Phase 3 the host gets CMD_WAIT_MS to answer the first "; CMD?"
+ * prompt; silence means an ordinary full dump.  Commands, one per line:
+ *     PROG         program pages (see prog_session)
+ *     CRC          per-block CRCs (see crc_blocks)
+ *     R aaaa nnnn  HEX records for nnnn bytes from aaaa, then "; R END"
+ *     BIN aaaa nnnn  the same range as binary frames (see bin_range)
+ *     SNAP         SFR, radio register and SRAM snapshot (see snapshot)
+ *     PROF ...     sampling profiler (see profile); only before CRC/PROG
+ *     DUMP         leave and run the full Phase 4 dump
+ *     DONE         leave without dumping ("; BYE")
+ * Replies start with ';' so dump_collect.py treats them as comments.
+ * Returns true if Phase 4 should run.
+ */
+static bool host_session(void)
+{
+    static char line[2 * PAGE_SIZE + 32];
+    int timeout = CMD_WAIT_MS;
+
+    ESP_LOGI(TAG, "[3j] Waiting %d ms for host command...", CMD_WAIT_MS);
+    printf("; CMD? PROG|CRC|R|BIN|SNAP|PROF|DUMP|DONE within %d ms, else dumping\n", CMD_WAIT_MS);
+    fflush(stdout);
+
+    for (;;) {
+        if (read_line(line, sizeof(line), timeout) < 0) {
+            ESP_LOGI(TAG, "      No host command — dumping.");
+            return true;
+        }
+        timeout = PROG_IDLE_MS;
+
+        uint8_t ab[2], nb[2];
+        if (strcmp(line, "DUMP") == 0) {
+            return true;
+        } else if (strcmp(line, "DONE") == 0) {
+            printf("; BYE\n");
+            fflush(stdout);
+            return false;
+        } else if (strcmp(line, "CRC") == 0) {
+            crc_blocks();
+        } else if (strcmp(line, "SNAP") == 0) {
+            snapshot();
+        } else if (strncmp(line, "PROF ", 5) == 0) {
+            profile(line + 5);
+#if CCDBG_PROGRAM
+        } else if (strcmp(line, "PROG") == 0) {
+            prog_session(line, sizeof(line));
+#endif
+        } else if (strlen(line) == 11 && line[0] == 'R' &&
+                   parse_hex(line + 2, ab, 2) && parse_hex(line + 7, nb, 2)) {
+            uint32_t addr = (ab[0] << 8) | ab[1], len = (nb[0] << 8) | nb[1];
+            if (len == 0 || addr + len > FLASH_SIZE) {
+                printf("; R ERR range\n");
+            } else {
+                emit_range_hex((uint16_t)addr, len, false);
+                printf("; R END\n");
+            }
+        } else if (strlen(line) == 13 && strncmp(line, "BIN ", 4) == 0 &&
+                   parse_hex(line + 4, ab, 2) && parse_hex(line + 9, nb, 2)) {
+            uint32_t addr = (ab[0] << 8) | ab[1], len = (nb[0] << 8) | nb[1];
+            if (len == 0 || addr + len > FLASH_SIZE)
+                printf("; BIN ERR range\n");
+            else
+                bin_range((uint16_t)addr, len, false);
+        } else {
+            printf("; ERR unknown command\n");
+        }
+        printf("; CMD?\n");
+        fflush(stdout);
+    }
+}
+#endif /* CCDBG_HOST_CMDS */
+
 /* ── GPIO init ─────────────────────────────────────────────────── */
 
 static void hw_init(void)
@@ -343,13 +1485,16 @@ static void hw_init(void)
 
     gpio_config_t dd_cfg = {
         .pin_bit_mask = (1ULL << PIN_DD),
-        .mode         = GPIO_MODE_OUTPUT,
+        .mode         = GPIO_MODE_INPUT_OUTPUT,   /* direction via enable bit */
         .pull_up_en   = GPIO_PULLUP_DISABLE,   /* CC1110 has its own pull-up */
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type    = GPIO_INTR_DISABLE,
     };
     gpio_config(&dd_cfg);
     gpio_set_level(PIN_DD, 1);
+    s_dd_out = 1;
+
+    set_half_ns(T_CLK * 1000);
 
     gpio_config_t rst_cfg = {
         .pin_bit_mask = (1ULL << PIN_RST),
@@ -360,6 +1505,16 @@ static void hw_init(void)
     };
     gpio_config(&rst_cfg);
     gpio_set_level(PIN_RST, 1);
+
+#if CCDBG_HOST_CMDS
+    /* Host commands arrive on the same USB serial port; point the
+     * console at the driver so printf and reads share it. */
+    usb_serial_jtag_driver_config_t usb_cfg = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+    usb_cfg.rx_buffer_size = 4096;
+    usb_cfg.tx_buffer_size = 4096;
+    ESP_ERROR_CHECK(usb_serial_jtag_driver_install(&usb_cfg));
+    usb_serial_jtag_vfs_use_driver();
+#endif
 }
 
 /* ── Status printer ────────────────────────────────────────────── */
@@ -615,6 +1770,19 @@ void app_main(void)
         ESP_LOGW(TAG, "      Proceeding cautiously...");
     }
 
+#if CCDBG_TRANSPORT_SPI
+    ESP_LOGI(TAG, "[2d] Switching debug transport to SPI2 @ %d kHz...",
+             CCDBG_SPI_HZ / 1000);
+    spi_transport_init();
+    uint16_t spi_id = get_chip_id();
+    if (spi_id != chip_id) {
+        ESP_LOGE(TAG, "      Chip ID over SPI = 0x%04X (bit-bang read 0x%04X)",
+                 spi_id, chip_id);
+        stop_with_error("SPI transport does not match bit-banged bus");
+    }
+    ESP_LOGI(TAG, "      ✓ Chip ID 0x%04X confirmed over SPI.", spi_id);
+#endif
+
     /* Read status */
     ESP_LOGI(TAG, "[2e] Sending READ_STATUS command (0x%02X)...", CMD_READ_STATUS);
     uint8_t status = read_status();
@@ -724,6 +1892,20 @@ void app_main(void)
         ESP_LOGI(TAG, "      First bytes: %02X %02X %02X", probe, probe1, probe2);
     }
 
+#if CCDBG_CALIBRATE && !CCDBG_TRANSPORT_SPI
+    ESP_LOGI(TAG, "[3i] Calibrating debug clock (read-back verified)...");
+    uint32_t half_ns = calibrate_clock(chip_id);
+    if (!half_ns)
+        stop_with_error("Debug bus does not verify at the starting clock");
+    ESP_LOGI(TAG, "      Half-clock = %lu ns (%lu kHz debug clock)",
+             (unsigned long)half_ns, (unsigned long)(500000 / half_ns));
+#endif
+
+    bool full_dump = true;
+#if CCDBG_HOST_CMDS
+    full_dump = host_session();
+#endif
+
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "Phase 3 DONE. Ready to dump flash.");
     vTaskDelay(pdMS_TO_TICKS(500));
@@ -732,60 +1914,37 @@ void app_main(void)
     phase_hdr(4, "READING FLASH (32 KB)");
     /* ════════════════════════════════════════════════════════════ */
 
-    ESP_LOGI(TAG, "Dumping %d bytes (%d KB) as Intel HEX over USB serial...",
-             FLASH_SIZE, FLASH_SIZE / 1024);
-    ESP_LOGI(TAG, "Block size = %d bytes. Total blocks = %d.",
-             BLOCK_SIZE, FLASH_SIZE / BLOCK_SIZE);
-    ESP_LOGI(TAG, "HEX records start with ':' — other lines are log messages.");
-    ESP_LOGI(TAG, "");
-
-    /* Emit Intel HEX header comments */
-    printf("; CC1110F32 flash dump — %d bytes\n", FLASH_SIZE);
-    printf("; Chip ID: 0x%04X  Status: 0x%02X\n", chip_id, status);
-    printf("; Probe: flash[0]=0x%02X flash[1]=0x%02X flash[2]=0x%02X\n",
-           probe, probe1, probe2);
-    fflush(stdout);
-
-    uint8_t block[BLOCK_SIZE];
-    int pct_last = -1;
-    int64_t t_start = esp_timer_get_time();
-
-    for (uint32_t addr = 0; addr < FLASH_SIZE; addr += BLOCK_SIZE) {
-        int len = BLOCK_SIZE;
-        if (addr + len > FLASH_SIZE)
-            len = FLASH_SIZE - addr;
-
-        read_flash_block((uint16_t)addr, block, len);
-
-        /* Emit as 16-byte HEX records */
-        for (int off = 0; off < len; off += 16) {
-            int rec_len = (len - off > 16) ? 16 : (len - off);
-            emit_hex_record(0x00, (uint16_t)(addr + off),
-                            &block[off], rec_len);
-        }
+    int total_secs = 0;
+    if (full_dump) {
+        ESP_LOGI(TAG, "Dumping %d bytes (%d KB) as Intel HEX over USB serial...",
+                 FLASH_SIZE, FLASH_SIZE / 1024);
+        ESP_LOGI(TAG, "Block size = %d bytes. Total blocks = %d.",
+                 BLOCK_SIZE, FLASH_SIZE / BLOCK_SIZE);
+        ESP_LOGI(TAG, "HEX records start with ':' — other lines are log messages.");
+        ESP_LOGI(TAG, "");
+
+        /* Emit Intel HEX header comments */
+        printf("; CC1110F32 flash dump — %d bytes\n", FLASH_SIZE);
+        printf("; Chip ID: 0x%04X  Status: 0x%02X\n", chip_id, status);
+        printf("; Probe: flash[0]=0x%02X flash[1]=0x%02X flash[2]=0x%02X\n",
+               probe, probe1, probe2);
         fflush(stdout);
 
-        int pct = (int)((addr + len) * 100 / FLASH_SIZE);
-        if (pct != pct_last) {
-            int64_t elapsed = esp_timer_get_time() - t_start;
-            int secs = (int)(elapsed / 1000000);
-            ESP_LOGI(TAG, "Progress: %3d%%  (%5lu / %d bytes)  [%d:%02d elapsed]",
-                     pct,
-                     (unsigned long)(addr + len), FLASH_SIZE,
-                     secs / 60, secs % 60);
-            pct_last = pct;
-        }
-    }
-
-    emit_hex_eof();
-    fflush(stdout);
+        int64_t t_start = esp_timer_get_time();
+        emit_range_hex(FLASH_BASE, FLASH_SIZE, true);
+        emit_hex_eof();
+        fflush(stdout);
 
-    int64_t t_total = esp_timer_get_time() - t_start;
-    int total_secs = (int)(t_total / 1000000);
+        int64_t t_total = esp_timer_get_time() - t_start;
+        total_secs = (int)(t_total / 1000000);
 
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "Phase 4 DONE. All %d bytes read in %d:%02d.",
-             FLASH_SIZE, total_secs / 60, total_secs % 60);
+        ESP_LOGI(TAG, "");
+        ESP_LOGI(TAG, "Phase 4 DONE. All %d bytes read in %d:%02d (%lu B/s).",
+                 FLASH_SIZE, total_secs / 60, total_secs % 60,
+                 (unsigned long)((int64_t)FLASH_SIZE * 1000000 / (t_total ? t_total : 1)));
+    } else {
+        ESP_LOGI(TAG, "Phase 4 skipped — host ended the session with DONE.");
+    }
     vTaskDelay(pdMS_TO_TICKS(500));
 
     /* ════════════════════════════════════════════════════════════ */
@@ -800,9 +1959,13 @@ void app_main(void)
 
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "╔══════════════════════════════════════╗");
-    ESP_LOGI(TAG, "║        FLASH DUMP COMPLETE!          ║");
-    ESP_LOGI(TAG, "║  Total: %5d bytes in %d:%02d          ║",
-             FLASH_SIZE, total_secs / 60, total_secs % 60);
+    if (full_dump) {
+        ESP_LOGI(TAG, "║        FLASH DUMP COMPLETE!          ║");
+        ESP_LOGI(TAG, "║  Total: %5d bytes in %d:%02d          ║",
+                 FLASH_SIZE, total_secs / 60, total_secs % 60);
+    } else {
+        ESP_LOGI(TAG, "║       HOST SESSION COMPLETE!         ║");
+    }
     ESP_LOGI(TAG, "╚══════════════════════════════════════╝");
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "On PC: python dump_collect.py COMx");
@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+"""gcap.py — Compact binary capture format for the garage protocol tools.
+
+A .gcap file holds the same per-channel transition lists that
+analyze.parse_capture() builds from a logic-analyzer CSV, stored as
+fixed-point tick counts so loading needs no per-line parsing:
+
+    offset  size
+    0       4    magic "GCAP"
+    4       2    version (1)
+    6       1    decimals  — ticks per second = 10**decimals
+    7       1    col_count — 2 or 3, as parse_capture reports it
+    8       1    n_ch
+    9       3    reserved
+    12      24×n per-channel directory:
+                   u8 ch, u8 init value, u8 delta width (4|8), pad,
+                   u32 count, i64 base tick, u32 offset, u32 reserved
+    ...          delta arrays, 8-byte aligned, little-endian
+
+Each channel's transitions alternate in value (parse_capture drops
+repeats), so only the first value is stored.  Times are the first tick
+plus a running sum of count-1 unsigned deltas.
+
+Times are kept as integer ticks at the CSV's own decimal precision and
+rebuilt as ticks / 10**decimals on load.  Both that and float() of the
+original text are correctly rounded, so loaded floats are bit-identical
+to what parse_capture() returns from the CSV.
+
+numpy is optional: with it, delta arrays are np.memmap'd; without it,
+the array module does the same job a little slower.
+
+Usage:
+    python gcap.py convert [files...]   # CSV → .gcap next to each CSV
+    python gcap.py info X.gcap          # print header and channel stats
+    python gcap.py --check [files...]   # verify .gcap loads == CSV parse
+"""
+
+import os
+import sys
+import glob
+import struct
+from array import array
+from itertools import accumulate
+
+try:
+    import numpy as np
+except ImportError:         # pure-Python fallback below
+    np = None
+
+MAGIC = b"GCAP"
+VERSION = 1
+HEADER = struct.Struct("<4sHBBB3x")
+CHANNEL = struct.Struct("<BBBxIqII")
+
+
+# ── CSV → ticks ─────────────────────────────────────────────────────
+
+def _split_time(field):
+    """'-5.1437107' → (sign, int_digits, frac_digits) without float()."""
+    field = field.strip()
+    sign = -1 if field.startswith("-") else 1
+    field = field.lstrip("+-")
+    whole, _, frac = field.partition(".")
+    return sign, whole or "0", frac
+
+
+def parse_csv_ticks(filepath):
+    """Parse an LA CSV the way analyze.parse_capture does, in integer ticks.
+
+    Returns: (channels, col_count, decimals)
+        channels: {0: [(tick, val), ...], 1: [...]}
+    """
+    rows = []
+    col_count = 3
+    ch_map = {0: 0, 1: 1}
+    decimals = 0
+
+    with open(filepath) as f:
+        header = f.readline().strip()
+        if "Channel 0" in header and "Channel 1" in header:
+            col_count = 3
+        elif "Channel 0" in header:
+            col_count = 2
+            ch_map = {0: 0}
+        elif "Channel 1" in header:
+            col_count = 2
+            ch_map = {0: 1}
+        else:
+            col_count = 3
+
+        for line in f:
+            parts = line.strip().split(",")
+            if len(parts) < 2:
+                continue
+            float(parts[0])     # same rejection of non-numeric lines as parse_capture
+            sign, whole, frac = _split_time(parts[0])
+            decimals = max(decimals, len(frac))
+            if col_count == 3 and len(parts) >= 3:
+                vals = (int(parts[1].strip()), int(parts[2].strip()))
+            elif col_count == 2:
+                vals = (int(parts[1].strip()),)
+            else:
+                continue
+            rows.append((sign, whole, frac, vals))
+
+    channels = {0: [], 1: []}
+    prev = {0: None, 1: None}
+    for sign, whole, frac, vals in rows:
+        tick = sign * int(whole + frac.ljust(decimals, "0"))
+        for col, val in enumerate(vals):
+            ch = ch_map[col]
+            if prev[ch] is None or val != prev[ch]:
+                channels[ch].append((tick, val))
+                prev[ch] = val
+
+    return channels, col_count, decimals
+
+
+# ── Writer ──────────────────────────────────────────────────────────
+
+def write_gcap(path, channels, col_count, decimals):
+    """Write {ch: [(tick, val), ...]} to a .gcap file."""
+    chs = sorted(channels)
+    offset = HEADER.size + CHANNEL.size * len(chs)
+    dirs, blobs = [], []
+
+    for ch in chs:
+        trans = channels[ch]
+        for (_, a), (_, b) in zip(trans, trans[1:]):
+            if a == b:
+                raise ValueError(f"channel {ch}: repeated value, not a transition list")
+        if any(v not in (0, 1) for _, v in trans):
+            raise ValueError(f"channel {ch}: non-binary value")
+        ticks = [t for t, _ in trans]
+        deltas = [b - a for a, b in zip(ticks, ticks[1:])]
+        if any(d < 0 for d in deltas):
+            raise ValueError(f"channel {ch}: timestamps go backwards")
+        width = 4 if not deltas or max(deltas) <= 0xFFFFFFFF else 8
+        blob = array("I" if width == 4 else "Q", deltas)
+        if blob.itemsize != width:      # platform without 4-byte 'I'
+            blob = array("L" if width == 4 else "Q", deltas)
+        if sys.byteorder != "little":
+            blob.byteswap()
+        blob = blob.tobytes()
+
+        offset = (offset + 7) & ~7
+        dirs.append(CHANNEL.pack(ch, trans[0][1] if trans else 0, width,
+                                 len(trans), ticks[0] if ticks else 0, offset, 0))
+        blobs.append((offset, blob))
+        offset += len(blob)
+
+    out = bytearray(HEADER.pack(MAGIC, VERSION, decimals, col_count, len(chs)))
+    out += b"".join(dirs)
+    for off, blob in blobs:
+        out += b"\0" * (off - len(out))
+        out += blob
+
+    tmp = path + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(out)
+    os.replace(tmp, path)
+
+
+class GcapWriter:
+    """Accumulate transitions one at a time, write the file on close().
+
+    Used by collect.py --raw to record rig edge streams straight to
+    .gcap.  Repeated values on a channel are dropped as in the CSV path.
+    """
+
+    def __init__(self, path, n_ch=2, decimals=6, col_count=3):
+        self.path = path
+        self.decimals = decimals
+        self.col_count = col_count
+        self.channels = {c: [] for c in range(n_ch)}
+
+    def add(self, ch, tick, val):
+        trans = self.channels[ch]
+        if not trans or trans[-1][1] != val:
+            trans.append((tick, val))
+
+    def close(self):
+        write_gcap(self.path, self.channels, self.col_count, self.decimals)
+
+
+def convert(csv_path, gcap_path=None):
+    gcap_path = gcap_path or gcap_path_for(csv_path)
+    channels, col_count, decimals = parse_csv_ticks(csv_path)
+    write_gcap(gcap_path, channels, col_count, decimals)
+    return gcap_path
+
+
+# ── Loader ──────────────────────────────────────────────────────────
+
+def gcap_path_for(csv_path):
+    return os.path.splitext(csv_path)[0] + ".gcap"
+
+
+def fresh_gcap_for(csv_path):
+    """Path of a .gcap sibling at least as new as the CSV, else None."""
+    g = gcap_path_for(csv_path)
+    try:
+        if os.path.getmtime(g) >= os.path.getmtime(csv_path):
+            return g
+    except OSError:
+        pass
+    return None
+
+
+def _read_header(buf):
+    magic, version, decimals, col_count, n_ch = HEADER.unpack_from(buf, 0)
+    if magic != MAGIC:
+        raise ValueError("not a .gcap file")
+    if version != VERSION:
+        raise ValueError(f"unsupported .gcap version {version}")
+    dirs = [CHANNEL.unpack_from(buf, HEADER.size + i * CHANNEL.size)
+            for i in range(n_ch)]
+    return decimals, col_count, dirs
+
+
+def load_gcap_ticks(path):
+    """Load integer ticks without building Python tuples.
+
+    Returns: (chans, col_count, decimals)
+        chans: {ch: (ticks, init)} where ticks is an int64 ndarray if
+        numpy is available, otherwise a list of ints.
+    """
+    with open(path, "rb") as f:
+        head = f.read(HEADER.size + CHANNEL.size * 8)
+    decimals, col_count, dirs = _read_header(head)
+
+    chans = {}
+    if np is not None:
+        mm = np.memmap(path, dtype=np.uint8, mode="r")
+        for ch, init, width, count, base, off, _ in dirs:
+            ticks = np.empty(count, dtype=np.int64)
+            if count:
+                ticks[0] = base
+                d = mm[off:off + (count - 1) * width].view("<u4" if width == 4 else "<u8")
+                np.cumsum(d, dtype=np.int64, out=ticks[1:])
+                ticks[1:] += base
+            chans[ch] = (ticks, init)
+        del mm
+    else:
+        with open(path, "rb") as f:
+            buf = f.read()
+        for ch, init, width, count, base, off, _ in dirs:
+            d = array("I" if width == 4 else "Q")
+            if d.itemsize != width:
+                d = array("L" if width == 4 else "Q")
+            d.frombytes(buf[off:off + (count - 1) * width] if count else b"")
+            if sys.byteorder != "little":
+                d.byteswap()
+            ticks = list(accumulate(d, initial=base)) if count else []
+            chans[ch] = (ticks, init)
+    return chans, col_count, decimals
+
+
+def load_gcap(path):
+    """Load a .gcap file in parse_capture's return shape.
+
+    Returns: (channels_dict, column_count), channels_dict always has
+    keys 0 and 1 like parse_capture.
+    """
+    chans, col_count, decimals = load_gcap_ticks(path)
+    scale = 10 ** decimals
+    channels = {0: [], 1: []}
+    for ch, (ticks, init) in chans.items():
+        if np is not None:
+            times = (ticks.astype(np.float64) / float(scale)).tolist()
+        else:
+            times = [t / scale for t in ticks]
+        vals = [init, 1 - init] * (len(times) // 2 + 1)
+        channels[ch] = list(zip(times, vals))
+    return channels, col_count
+
+
+# ── CLI ─────────────────────────────────────────────────────────────
+
+def _default_files():
+    base = os.path.dirname(os.path.abspath(__file__))
+    return sorted(glob.glob(os.path.join(base, "*.txt")))
+
+
+def _check(files):
+    import time
+    from analyze import parse_capture
+    ok = True
+    for path in files:
+        try:
+            ref = parse_capture(path, use_gcap=False)
+        except (ValueError, IndexError) as e:
+            print(f"  skip {os.path.basename(path)}: not a capture ({e})")
+            continue
+        g = gcap_path_for(path)
+        tmp = None
+        if not os.path.exists(g):
+            tmp = g = path + ".check.gcap"
+            convert(path, g)
+        try:
+            t0 = time.perf_counter()
+            got = load_gcap(g)
+            dt = time.perf_counter() - t0
+        finally:
+            if tmp:
+                os.remove(tmp)
+        same = got == ref
+        ok &= same
+        n = sum(len(v) for v in ref[0].values())
+        print(f"  {'PASS' if same else 'FAIL'} {os.path.basename(path):<42s}"
+              f" {n:6d} transitions, load {dt * 1000:6.1f} ms")
+    return ok
+
+
+def main():
+    args = sys.argv[1:]
+    if not args:
+        print(__doc__.split("Usage:")[1])
+        sys.exit(1)
+
+    cmd, files = args[0], args[1:]
+    if cmd == "convert":
+        for path in files or _default_files():
+            try:
+                out = convert(path)
+            except (ValueError, IndexError) as e:
+                print(f"  skip {os.path.basename(path)}: not a capture ({e})")
+                continue
+            a, b = os.path.getsize(path), os.path.getsize(out)
+            print(f"  {os.path.basename(path):<42s} {a:9d} → {b:8d} bytes")
+    elif cmd == "info":
+        for path in files:
+            with open(path, "rb") as f:
+                decimals, col_count, dirs = _read_header(f.read(512))
+            print(f"{path}: 10^-{decimals} s ticks, {col_count} columns")
+            for ch, init, width, count, base, off, _ in dirs:
+                print(f"  ch{ch}: {count} transitions from tick {base}, "
+                      f"init={init}, u{width * 8} deltas @ {off}")
+    elif cmd == "--check":
+        sys.exit(0 if _check(files or _default_files()) else 1)
+    else:
+        print(f"Unknown command {cmd!r}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
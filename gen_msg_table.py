@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""gen_msg_table.py — Generate esp32_capture/main/msg_table.h from analyze.py.
+
+The CH0/CH1 exact and prefix tables in analyze.py are the one message
+definition source.  analyze.py compiles them into a trie per channel at
+import; this script flattens the same tries into static C tables plus a
+msg_classify() walker, so the firmware classifies with the same rules.
+The TYPE-B door / sub-state / light tables and position constants are
+emitted too, for the firmware's live position tracker, and every table
+pattern as plain symbols for its traffic generator (TX_MODE).
+
+Usage:
+    python gen_msg_table.py            # rewrite the header
+    python gen_msg_table.py --check    # fail if the header is stale or
+                                       # the C walk disagrees with analyze.py
+"""
+
+import os
+import sys
+import random
+
+import analyze as A
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                      "esp32_capture", "main", "msg_table.h")
+
+
+def enum_name(name):
+    return "MSG_" + name.upper().replace("-", "_").replace("?", "X")
+
+
+def message_names():
+    """Every message name, in table order; id 0 is MSG_UNKNOWN."""
+    names = ["UNKNOWN"]
+    for table in (A.CH0_COMMANDS.values(), [(n, d) for _, n, d in A.CH0_PREFIXES],
+                  A.CH1_RESPONSES.values(), [(n, d) for _, n, d in A.CH1_PREFIXES]):
+        for name, _ in table:
+            if name not in names:
+                names.append(name)
+    return names
+
+
+def flatten(roots, ids):
+    """Breadth-first node/edge arrays; returns (nodes, edges, root indices).
+
+    node = (first edge, edge count, exact id, prefix id)
+    edge = (symbol, child node)
+    """
+    order, index = [], {}
+    for root in roots:
+        index[id(root)] = len(order)
+        order.append(root)
+    i = 0
+    while i < len(order):
+        for sym in sorted(order[i].next):
+            child = order[i].next[sym]
+            index[id(child)] = len(order)
+            order.append(child)
+        i += 1
+
+    nodes, edges = [], []
+    for node in order:
+        exact = ids[node.exact[0]] if node.exact else 0
+        prefix = ids[node.prefix[1][0]] if node.prefix else 0
+        nodes.append((len(edges), len(node.next), exact, prefix))
+        for sym in sorted(node.next):
+            edges.append((sym, index[id(node.next[sym])]))
+    return nodes, edges, [index[id(r)] for r in roots]
+
+
+def hdr_lens(names):
+    lens = {0: 0}
+    ids = {n: i for i, n in enumerate(names)}
+    for key, (name, _) in list(A.CH0_COMMANDS.items()) + list(A.CH1_RESPONSES.items()):
+        lens[ids[name]] = len(key)
+    for prefix, name, _ in A.CH0_PREFIXES + A.CH1_PREFIXES:
+        lens[ids[name]] = len(prefix)
+    return [lens[i] for i in range(len(names))]
+
+
+def state_table(w, prefix, table):
+    """{symbols: NAME} → enum + key/name arrays, in dict order."""
+    names = list(table.values())
+    klen = max(len(k) for k in table)
+    w("enum {")
+    for i, name in enumerate(names):
+        w(f"    {prefix}_{name},")
+    w(f"    {prefix}_COUNT,")
+    w(f"    {prefix}_NONE = 0xFF")
+    w("};")
+    lower = prefix.lower()
+    w(f"static const uint8_t {prefix}_KEYS[{prefix}_COUNT][{klen}] = {{")
+    for key in table:
+        w("    {" + ",".join(str(v) for v in key) + "},")
+    w("};")
+    w(f"static const char *const {prefix}_NAMES[{prefix}_COUNT] = {{")
+    for name in names:
+        w(f'    "{name}",')
+    w("};")
+    w(f"static inline uint8_t {lower}_lookup(const uint8_t *sym)")
+    w("{")
+    w(f"    for (int i = 0; i < {prefix}_COUNT; i++)")
+    w(f"        if (!memcmp(sym, {prefix}_KEYS[i], {klen})) return (uint8_t)i;")
+    w(f"    return {prefix}_NONE;")
+    w("}")
+    w("")
+
+
+def patterns(ids):
+    """(id, ch, is_prefix, symbols) for every table entry, in table order."""
+    out = []
+    for ch, exact, prefixes in ((0, A.CH0_COMMANDS, A.CH0_PREFIXES),
+                                (1, A.CH1_RESPONSES, A.CH1_PREFIXES)):
+        out += [(ids[name], ch, 0, key) for key, (name, _) in exact.items()]
+        out += [(ids[name], ch, 1, key) for key, name, _ in prefixes]
+    return out
+
+
+def generate():
+    names = message_names()
+    ids = {n: i for i, n in enumerate(names)}
+    nodes, edges, roots = flatten([A.CH0_TRIE, A.CH1_TRIE], ids)
+    assert len(names) < 256 and len(nodes) < 65536 and len(edges) < 65536
+
+    out = []
+    w = out.append
+    w("/*")
+    w(" * msg_table.h — CH0/CH1 message classifier tables")
+    w(" *")
+    w(" * GENERATED by gen_msg_table.py from the tables in analyze.py; do not")
+    w(" * edit.  Rerun the script after changing a message definition, and")
+    w(" * `python gen_msg_table.py --check` to confirm the two sides agree.")
+    w(" *")
+    w(" * One trie per channel: msg_classify() walks the L-symbols once and")
+    w(" * returns the exact match ending at the last symbol, else the best")
+    w(" * header prefix passed on the way (analyze.classify_ch0/ch1 rules).")
+    w(" * Symbols here come from sym(), which never returns 0, so patterns")
+    w(" * containing 0 (CMD-INIT) cannot match on the device.")
+    w(" */")
+    w("#pragma once")
+    w("#include <stdint.h>")
+    w("#include <string.h>")
+    w("")
+    w("enum {")
+    for i, name in enumerate(names):
+        w(f"    {enum_name(name) + ',':<20s} /* {i:2d} {name} */")
+    w("    MSG_COUNT")
+    w("};")
+    w("")
+    w("static const char *const MSG_NAMES[MSG_COUNT] = {")
+    for name in names:
+        w(f'    "{name}",')
+    w("};")
+    w("")
+    w("/* Header length per message: exact = whole message, prefix = prefix */")
+    w("static const uint8_t MSG_HDR_LEN[MSG_COUNT] = {")
+    lens = hdr_lens(names)
+    for i in range(0, len(lens), 12):
+        w("    " + " ".join(f"{n:2d}," for n in lens[i:i + 12]))
+    w("};")
+    w("")
+    w("typedef struct {")
+    w("    uint16_t edge0;     /* first outgoing edge in MSG_EDGES */")
+    w("    uint8_t  nedge;")
+    w("    uint8_t  exact;     /* message ending exactly here, or 0 */")
+    w("    uint8_t  prefix;    /* best prefix match at or above, or 0 */")
+    w("} msg_node_t;")
+    w("")
+    w("typedef struct {")
+    w("    uint8_t  sym;")
+    w("    uint16_t node;")
+    w("} msg_edge_t;")
+    w("")
+    w(f"#define MSG_ROOT_CH0  {roots[0]}")
+    w(f"#define MSG_ROOT_CH1  {roots[1]}")
+    w("")
+    w(f"static const msg_node_t MSG_NODES[{len(nodes)}] = {{")
+    for i, (e0, ne, ex, pf) in enumerate(nodes):
+        w(f"    {{{e0:4d}, {ne}, {ex:2d}, {pf:2d}}},  /* {i} */")
+    w("};")
+    w("")
+    w(f"static const msg_edge_t MSG_EDGES[{len(edges)}] = {{")
+    for i in range(0, len(edges), 6):
+        w("    " + " ".join(f"{{{s},{n:4d}}}," for s, n in edges[i:i + 6]))
+    w("};")
+    w("")
+    w("static inline uint8_t msg_classify(int ch, const uint8_t *sym, int n)")
+    w("{")
+    w("    const msg_node_t *node = &MSG_NODES[ch ? MSG_ROOT_CH1 : MSG_ROOT_CH0];")
+    w("    for (int i = 0; i < n; i++) {")
+    w("        const msg_edge_t *e = &MSG_EDGES[node->edge0];")
+    w("        const msg_edge_t *end = e + node->nedge;")
+    w("        while (e < end && e->sym != sym[i]) e++;")
+    w("        if (e == end) return node->prefix;")
+    w("        node = &MSG_NODES[e->node];")
+    w("    }")
+    w("    return node->exact ? node->exact : node->prefix;")
+    w("}")
+    w("")
+    w("/* ── TYPE-B status fields (analyze.decode_type_b_state) ─────────── */")
+    w(f"#define TYPE_B_HEADER_LEN  {A.TYPE_B_HEADER_LEN}")
+    w(f"#define CROSSTALK_THRESH   {A.CROSSTALK_THRESH}")
+    w("")
+    w("/* ── Crosstalk filter (analyze.suppress_crosstalk) ─────────────── */")
+    w(f"#define XTALK_GLITCH_US    {A.XTALK_GLITCH_US}")
+    w(f"#define XTALK_WIN_US       {A.XTALK_WIN_US}")
+    w("")
+    w("/* Door state: payload symbols 0-1 */")
+    state_table(w, "TB_DOOR", A.DOOR_STATE_MAP)
+    w("/* Sub-state: payload symbols 2-4 */")
+    state_table(w, "TB_SUB", A.SUB_STATE_MAP)
+    w("/* Light: payload symbols 1-4, door closed or unknown only */")
+    state_table(w, "TB_LIGHT", A.LIGHT_PATTERNS)
+    w("/* ── Table patterns as symbols, for the traffic generator ───────── */")
+    w("typedef struct {")
+    w("    uint8_t  id;        /* MSG_* */")
+    w("    uint8_t  ch;")
+    w("    uint8_t  prefix;    /* 1 = header of a prefix entry, payload follows */")
+    w("    uint8_t  len;")
+    w("    uint16_t off;       /* into MSG_PATTERN_SYMS */")
+    w("} msg_pattern_t;")
+    w("")
+    pats = patterns(ids)
+    w(f"#define MSG_NPATTERNS  {len(pats)}")
+    w("")
+    w(f"static const uint8_t MSG_PATTERN_SYMS[{sum(len(k) for *_, k in pats)}] = {{")
+    for pid, ch, pre, key in pats:
+        w("    " + ",".join(str(v) for v in key) + f",  /* {names[pid]} */")
+    w("};")
+    w("")
+    w("static const msg_pattern_t MSG_PATTERNS[MSG_NPATTERNS] = {")
+    off = 0
+    for pid, ch, pre, key in pats:
+        w(f"    {{{enum_name(names[pid])}, {ch}, {pre}, {len(key)}, {off}}},")
+        off += len(key)
+    w("};")
+    return "\n".join(out) + "\n", names, nodes, edges, roots
+
+
+def c_walk(nodes, edges, root, syms):
+    """Python copy of msg_classify(), run on the flattened tables."""
+    e0, ne, ex, pf = nodes[root]
+    for s in syms:
+        for sym, child in edges[e0:e0 + ne]:
+            if sym == s:
+                break
+        else:
+            return pf
+        e0, ne, ex, pf = nodes[child]
+    return ex or pf
+
+
+def check(text, names, nodes, edges, roots):
+    ok = True
+    if not os.path.exists(HEADER) or open(HEADER, encoding="utf-8").read() != text:
+        print(f"  FAIL: {os.path.relpath(HEADER)} is stale — rerun gen_msg_table.py")
+        ok = False
+    else:
+        print(f"  PASS: {os.path.relpath(HEADER)} up to date")
+
+    rng = random.Random(7030)
+    keys = (list(A.CH0_COMMANDS) + [p for p, _, _ in A.CH0_PREFIXES] +
+            list(A.CH1_RESPONSES) + [p for p, _, _ in A.CH1_PREFIXES])
+    bad = 0
+    for _ in range(20000):
+        k = list(rng.choice(keys))
+        op = rng.random()
+        if op < 0.3:
+            k = k[:rng.randrange(len(k) + 1)]
+        elif op < 0.6:
+            k += [rng.randrange(1, 10) for _ in range(rng.randrange(6))]
+        elif op < 0.8 and k:
+            k[rng.randrange(len(k))] = rng.randrange(10)
+        for ch, classify in ((0, A.classify_ch0), (1, A.classify_ch1)):
+            name = classify(k)[0]
+            want = 0 if name.endswith("-UNKNOWN") else names.index(name)
+            bad += c_walk(nodes, edges, roots[ch], k) != want
+    print(f"  {'PASS' if not bad else 'FAIL'}: C walk == analyze.classify_ch0/ch1 "
+          f"on 20000 mutated patterns{f' ({bad} mismatches)' if bad else ''}")
+    return ok and not bad
+
+
+def main():
+    text, names, nodes, edges, roots = generate()
+    if "--check" in sys.argv[1:]:
+        sys.exit(0 if check(text, names, nodes, edges, roots) else 1)
+    with open(HEADER, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print(f"Wrote {os.path.relpath(HEADER)}: {len(names)} messages, "
+          f"{len(nodes)} nodes, {len(edges)} edges")
+
+
+if __name__ == "__main__":
+    main()
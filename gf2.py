@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+"""gf2.py — Packed GF(2) linear algebra for the handshake linearity tests.
+
+A row is a Python int used as a bit vector (bit i = column i), so one
+XOR updates a whole row — ~140-bit challenge‖response rows are three
+machine words, well below the size where numpy's per-call overhead pays
+off.  On top of that:
+
+  rref()              batch elimination, Method of Four Russians: per
+                      block of M4RI_K columns, one table lookup + XOR
+                      per row instead of one XOR per pivot
+  rank(), kernel()    built on rref(); rank_many() for several matrices
+  GF2Basis            row basis grown one vector at a time, O(rank)
+  LinearityTracker    incremental form of gf2_linearity_test's rank and
+                      per-bit tests, fed one challenge/response pair at
+                      a time (gf2_linearity_test.py --follow)
+
+Usage:
+    python gf2.py --test        # cross-check against naive elimination
+"""
+
+import sys
+import time
+import random
+
+M4RI_K = 8                  # columns per Four-Russians block (table of 2^K rows)
+
+
+# ── Batch elimination ───────────────────────────────────────────────
+
+def _width(rows):
+    return max((r.bit_length() for r in rows), default=0)
+
+
+def _block(mat, r, c0, k, full):
+    """Eliminate columns c0..c0+k-1 below (and, if full, above) row r.
+
+    Returns (new mat, pivot columns found).  Pivots are searched on the
+    k-bit slice of each row; the pivot rows are kept in reduced form on
+    their columns, so every other row is cleared with a single lookup of
+    its own slice in the 2^k table of pivot-row combinations.
+    """
+    mask = (1 << k) - 1
+    piv = []                    # [local col, slice, row]
+    rest = []
+    for i in range(r, len(mat)):
+        v = mat[i]
+        if len(piv) == k:
+            rest.append(v)
+            continue
+        s = (v >> c0) & mask
+        for pc, ps, pv in piv:
+            if s >> pc & 1:
+                s ^= ps
+                v ^= pv
+        if not s:
+            rest.append(mat[i])
+            continue
+        pc = (s & -s).bit_length() - 1
+        for p in piv:
+            if p[1] >> pc & 1:
+                p[1] ^= s
+                p[2] ^= v
+        piv.append([pc, s, v])
+    if not piv:
+        return mat, []
+    piv.sort()
+
+    by_bit = {1 << pc: pv for pc, _, pv in piv}
+    table = [0] * (1 << k)
+    for pat in range(1, 1 << k):
+        low = pat & -pat
+        table[pat] = table[pat ^ low] ^ by_bit.get(low, 0)
+
+    rest = [v ^ table[(v >> c0) & mask] for v in rest]
+    if full:
+        head = [v ^ table[(v >> c0) & mask] for v in mat[:r]]
+    else:
+        head = mat[:r]
+        rest = [v for v in rest if v]
+    return head + [pv for _, _, pv in piv] + rest, [c0 + pc for pc, _, _ in piv]
+
+
+def rref(rows, width=None, k=M4RI_K, full=True):
+    """Row-reduce rows over GF(2).
+
+    Returns (rank, reduced rows, pivot columns).  With full=True the
+    result is the reduced row echelon form (pivot rows in pivot column
+    order, then zero rows), the same rows gf2_linearity_test's original
+    column-by-column elimination produced.  full=False only clears
+    below the pivots and drops zero rows, which is enough for rank.
+    """
+    mat = list(rows)
+    if width is None:
+        width = _width(mat)
+    r, pivots = 0, []
+    for c0 in range(0, width, k):
+        if r == len(mat):
+            break
+        mat, found = _block(mat, r, c0, min(k, width - c0), full)
+        pivots += found
+        r += len(found)
+    if full:
+        mat = mat[:r] + [0] * (len(rows) - r)
+    return r, mat, pivots
+
+
+def rank(rows, width=None, k=M4RI_K):
+    return rref(rows, width, k, full=False)[0]
+
+
+def rank_many(matrices, width=None, k=M4RI_K):
+    """Ranks of several matrices, e.g. one per response bit or subset."""
+    return [rank(m, width, k) for m in matrices]
+
+
+def kernel(rows, width=None, k=M4RI_K):
+    """Basis of {x : row·x = 0 for every row}, as ints over width columns."""
+    if width is None:
+        width = _width(rows)
+    r, mat, pivots = rref(rows, width, k)
+    basis = []
+    pivot_set = set(pivots)
+    for f in range(width):
+        if f in pivot_set:
+            continue
+        x = 1 << f
+        for row, pc in zip(mat[:r], pivots):
+            if row >> f & 1:
+                x |= 1 << pc
+        basis.append(x)
+    return basis
+
+
+def dot(a, b):
+    """GF(2) inner product of two packed vectors."""
+    return bin(a & b).count("1") & 1
+
+
+# ── Incremental basis ───────────────────────────────────────────────
+
+class GF2Basis:
+    """Row-space basis grown one vector at a time.
+
+    Kept fully reduced: every basis row's pivot (its highest set bit) is
+    clear in all other rows, so reducing a vector is one pass over the
+    basis in any order.  Each row carries a tag that is XORed along with
+    it; a vector that reduces to zero returns, as its tag, the same
+    combination of the tags that were added.
+    """
+
+    def __init__(self):
+        self.rows = {}          # pivot bit → [vec, tag]
+
+    def __len__(self):
+        return len(self.rows)
+
+    def reduce(self, v, tag=0):
+        for p, (b, t) in self.rows.items():
+            if v >> p & 1:
+                v ^= b
+                tag ^= t
+        return v, tag
+
+    def add(self, v, tag=0):
+        """Insert v; returns its (residual, tag).  residual 0 = dependent."""
+        v, tag = self.reduce(v, tag)
+        if v:
+            p = v.bit_length() - 1
+            for row in self.rows.values():
+                if row[0] >> p & 1:
+                    row[0] ^= v
+                    row[1] ^= tag
+            self.rows[p] = [v, tag]
+        return v, tag
+
+    def __contains__(self, v):
+        return self.reduce(v)[0] == 0
+
+
+class LinearityTracker:
+    """Evidence for R = M·C ⊕ b over GF(2), updated one pair at a time.
+
+    Pairs are differenced against the first (b cancels).  Challenge
+    differences go into a GF2Basis tagged with their response
+    differences.  A challenge difference that is already in the span is
+    a dependency: the response must follow the same combination, so any
+    bit left in its tag proves that response bit is not affine in C.
+
+      rank_c            rank of the challenge differences
+      rank_aug          rank of [C|R]; == rank_c while consistent
+      nonlinear         mask of response bits proven non-affine
+      deps              dependencies seen (each is a test of the model)
+    """
+
+    def __init__(self):
+        self.ref = None
+        self.c = GF2Basis()
+        self.resid = GF2Basis()
+        self.nonlinear = 0
+        self.deps = 0
+        self.n = 0
+
+    def add(self, c, r):
+        """Feed one pair; returns the response residual (0 = consistent)."""
+        self.n += 1
+        if self.ref is None:
+            self.ref = (c, r)
+            return 0
+        res, rr = self.c.add(c ^ self.ref[0], r ^ self.ref[1])
+        if res:
+            return 0
+        self.deps += 1
+        if rr:
+            self.nonlinear |= rr
+            self.resid.add(rr)
+        return rr
+
+    @property
+    def rank_c(self):
+        return len(self.c)
+
+    @property
+    def rank_aug(self):
+        return len(self.c) + len(self.resid)
+
+    def predict(self, c):
+        """Response the pairs so far imply for c, or None if not in span."""
+        if self.ref is None:
+            return None
+        res, rr = self.c.reduce(c ^ self.ref[0])
+        return None if res else self.ref[1] ^ rr
+
+
+# ── Self-test ───────────────────────────────────────────────────────
+
+def _rref_naive(matrix, n_cols):
+    """gf2_linearity_test's original elimination, the reference."""
+    mat = list(matrix)
+    rank = 0
+    for col in range(n_cols):
+        pivot = None
+        for row in range(rank, len(mat)):
+            if (mat[row] >> col) & 1:
+                pivot = row
+                break
+        if pivot is None:
+            continue
+        mat[rank], mat[pivot] = mat[pivot], mat[rank]
+        for row in range(len(mat)):
+            if row != rank and (mat[row] >> col) & 1:
+                mat[row] ^= mat[rank]
+        rank += 1
+    return rank, mat
+
+
+def self_test():
+    print("=== gf2.py self-test ===\n")
+    rng = random.Random(7030)
+    ok_rref = ok_rank = ok_ker = True
+    for trial in range(300):
+        n = rng.randrange(0, 40)
+        w = rng.randrange(1, 150)
+        rank_lim = rng.randrange(1, w + 1)
+        basis = [rng.getrandbits(w) for _ in range(rank_lim)]
+        rows = []
+        for _ in range(n):                      # rank-deficient mixes
+            v = 0
+            for b in basis:
+                if rng.random() < 0.5:
+                    v ^= b
+            rows.append(v)
+        k = rng.choice([1, 3, 8])
+        want_r, want = _rref_naive(rows, w)
+        got_r, got, piv = rref(rows, w, k)
+        ok_rref &= (got_r, got) == (want_r, want) and len(piv) == got_r
+        ok_rank &= rank(rows, w, k) == want_r
+        ker = kernel(rows, w, k)
+        ok_ker &= len(ker) == w - want_r and all(dot(x, v) == 0 for x in ker for v in rows)
+    print(f"  {'PASS' if ok_rref else 'FAIL'}: rref == naive elimination (300 random)")
+    print(f"  {'PASS' if ok_rank else 'FAIL'}: rank (below-pivot only)")
+    print(f"  {'PASS' if ok_ker else 'FAIL'}: kernel basis size and orthogonality")
+
+    # Affine map with two corrupted response bits
+    cw, rw = 89, 48
+    M = [rng.getrandbits(cw) for _ in range(rw)]
+    b = rng.getrandbits(rw)
+    bad = (1 << 5) | (1 << 40)
+
+    def resp(c):
+        r = b
+        for j, row in enumerate(M):
+            r ^= dot(row, c) << j
+        if bin(c).count("1") & 1:               # nonlinear in the bad bits
+            r ^= bad & (c >> 3)
+        return r
+
+    pairs = [(c, resp(c)) for c in (rng.getrandbits(cw) for _ in range(200))]
+    tr = LinearityTracker()
+    for c, r in pairs:
+        tr.add(c, r)
+    dc = [c ^ pairs[0][0] for c, _ in pairs[1:]]
+    aug = [(c ^ pairs[0][0]) << rw | (r ^ pairs[0][1]) for c, r in pairs[1:]]
+    ok_tr = (tr.rank_c == rank(dc, cw) and tr.rank_aug == rank(aug, cw + rw)
+             and tr.nonlinear == bad and tr.deps == len(pairs) - 1 - tr.rank_c)
+    print(f"  {'PASS' if ok_tr else 'FAIL'}: tracker ranks / nonlinear bits "
+          f"(rank_c {tr.rank_c}, rank_aug {tr.rank_aug}, bits {bin(tr.nonlinear)})")
+
+    lin = LinearityTracker()
+    for c, _ in pairs[:120]:
+        lin.add(c, resp(c) & ~bad)
+    c_new = pairs[150][0]
+    ok_pred = lin.predict(c_new) == resp(c_new) & ~bad and lin.nonlinear == 0
+    print(f"  {'PASS' if ok_pred else 'FAIL'}: predict() on a linear map")
+
+    rows = [rng.getrandbits(137) for _ in range(3000)]
+    t0 = time.perf_counter()
+    r_fast = rank(rows, 137)
+    t1 = time.perf_counter()
+    r_slow = _rref_naive(rows, 137)[0]
+    t2 = time.perf_counter()
+    print(f"\n  3000×137 rank: M4RI {1e3 * (t1 - t0):.1f} ms, "
+          f"naive {1e3 * (t2 - t1):.1f} ms")
+
+    ok = ok_rref and ok_rank and ok_ker and ok_tr and ok_pred and r_fast == r_slow
+    print(f"\n=== Self-test {'PASSED' if ok else 'FAILED'} ===")
+    return ok
+
+
+if __name__ == "__main__":
+    if "--test" in sys.argv[1:]:
+        sys.exit(0 if self_test() else 1)
+    print(__doc__)
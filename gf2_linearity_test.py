@@ -12,10 +12,23 @@ For an affine function R = M·C ⊕ b:
   R1 ⊕ R2 = M·(C1 ⊕ C2)   (constant b cancels)
 
 We test both.
+
+The eliminations run on gf2.py's packed Four-Russians engine.  --follow
+tails collect.py's captures.jsonl instead and updates the rank and
+per-bit evidence incrementally (gf2.LinearityTracker) as pairs arrive,
+separately per rig for collect_multi.py output.
+
+Usage:
+    python gf2_linearity_test.py                          # LA captures
+    python gf2_linearity_test.py --follow captures.jsonl  # live, rig captures
 """
 
+import sys
+import json
+import time
+
 import analyze as A
-from itertools import combinations
+import gf2
 
 CMD_B_INIT_HDR = 8
 HANDSHAKE_E_HDR = 8
@@ -33,7 +46,17 @@ def lh_to_bitstream(lh_pairs):
 
 def bitstream_to_int(bits):
     """Convert LSB-first bitstream to integer."""
-    return sum(bit << i for i, bit in enumerate(bits))
+    return int("".join(map(str, reversed(bits))) or "0", 2)
+
+
+def lh_to_int(lh_pairs):
+    """(L,H) pairs straight to (value, n_bits), same as
+    bitstream_to_int(lh_to_bitstream(...)) without the bit list."""
+    val = pos = 0
+    for l, h in lh_pairs:
+        val |= ((1 << l) - 1) << pos
+        pos += l + max(h, 0)
+    return val, pos
 
 
 def int_to_bits(val, n):
@@ -54,40 +77,24 @@ def extract_pairs():
     boot_sequences = []
     for path, info in A.TEST_FILES.items():
         try:
-            channels, _ = A.parse_capture(path)
+            analysis = A.load_analysis(path)
         except:
             continue
-        all_msgs = []
-        for ch_idx in range(len(channels)):
-            ch = channels[ch_idx]
-            if ch is None or not isinstance(ch, list) or len(ch) == 0:
-                continue
-            if not isinstance(ch[0], (tuple, list)):
-                continue
-            bursts = A.find_bursts(ch)
-            for burst in bursts:
-                if A.classify_burst(burst) != 'data':
-                    continue
-                syms, _ = A.decode_pwm(burst)
-                if ch_idx == 0:
-                    name, _, _, _ = A.classify_ch0(syms)
-                else:
-                    name, _, _, _ = A.classify_ch1(syms)
-                t = burst[0][0]
-                all_msgs.append((t, ch_idx, name, syms, burst, path))
+        all_msgs = [(m.time, m.channel, m.name, m.symbols, m.pairs, path)
+                    for m in analysis.messages]
         if not all_msgs:
             continue
         all_msgs.sort(key=lambda x: x[0])
         cycle = None
         last_t = -999
-        for t, ch_idx, name, syms, burst, p in all_msgs:
+        for t, ch_idx, name, syms, lh, p in all_msgs:
             if name in ('CMD-B-INIT', 'HANDSHAKE-D', 'HANDSHAKE-E'):
                 if cycle is None or (t - last_t) > 10:
                     cycle = {'file': path, 'msgs': []}
                     boot_sequences.append(cycle)
                 cycle['msgs'].append({
                     'time': t, 'channel': ch_idx, 'name': name,
-                    'syms': syms, 'burst': burst,
+                    'syms': syms, 'pairs': lh,
                 })
                 last_t = t
 
@@ -98,8 +105,8 @@ def extract_pairs():
         if cmd_b_long and handshake_e:
             c = cmd_b_long[0]
             r = handshake_e[0]
-            c_lh = A.burst_to_lh_pairs(c['burst'])[CMD_B_INIT_HDR:]
-            r_lh = A.burst_to_lh_pairs(r['burst'])[HANDSHAKE_E_HDR:]
+            c_lh = c['pairs'][CMD_B_INIT_HDR:]
+            r_lh = r['pairs'][HANDSHAKE_E_HDR:]
             pairs.append({
                 'cycle': len(pairs) + 1,
                 'file': cycle['file'],
@@ -111,27 +118,51 @@ def extract_pairs():
 
 def gf2_row_reduce(matrix, n_cols):
     """Gaussian elimination over GF(2). Matrix is list of integers (bitmasks).
-    Returns (rank, reduced_matrix)."""
-    mat = list(matrix)
-    rank = 0
-    for col in range(n_cols):
-        # Find pivot row
-        pivot = None
-        for row in range(rank, len(mat)):
-            if (mat[row] >> col) & 1:
-                pivot = row
-                break
-        if pivot is None:
-            continue
-        mat[rank], mat[pivot] = mat[pivot], mat[rank]
-        # Eliminate in all other rows
-        for row in range(len(mat)):
-            if row != rank and (mat[row] >> col) & 1:
-                mat[row] ^= mat[rank]
-        rank += 1
+    Returns (rank, reduced_matrix) — pivot rows in column order, then zeros."""
+    rank, mat, _ = gf2.rref(matrix, n_cols)
     return rank, mat
 
 
+def follow(path, poll_s=1.0):
+    """Tail captures.jsonl and report linearity evidence as pairs arrive."""
+    trackers = {}
+    r_width = {}
+    print(f"Following {path} (Ctrl+C to stop)\n")
+    with open(path, encoding="utf-8") as f:
+        try:
+            while True:
+                pos = f.tell()
+                line = f.readline()
+                if not line.endswith("\n"):
+                    f.seek(pos)                 # partial line: wait for the rest
+                    time.sleep(poll_s)
+                    continue
+                try:
+                    rec = json.loads(line)
+                except json.JSONDecodeError:
+                    continue
+                if not rec.get("ok") or "challenge" not in rec:
+                    continue
+                c, _ = lh_to_int(rec["challenge"][CMD_B_INIT_HDR:])
+                r, rn = lh_to_int(rec["response"][HANDSHAKE_E_HDR:])
+                rig = rec.get("rig", "-")
+                tr = trackers.setdefault(rig, gf2.LinearityTracker())
+                r_width[rig] = max(r_width.get(rig, 0), rn)
+                resid = tr.add(c, r)
+                note = f"  ✗ inconsistent bits {bin(resid)}" if resid else ""
+                print(f"  [{rig}] n={tr.n:4d}  rank(C)={tr.rank_c:3d}  "
+                      f"rank([C|R])={tr.rank_aug:3d}  deps={tr.deps:4d}  "
+                      f"non-affine bits {bin(tr.nonlinear).count('1')}/{r_width[rig]}{note}")
+        except KeyboardInterrupt:
+            pass
+    print()
+    for rig, tr in trackers.items():
+        verdict = ("no dependency yet — need more pairs" if not tr.deps else
+                   "consistent with R = M·C ⊕ b" if not tr.nonlinear else
+                   "NONLINEAR")
+        print(f"  [{rig}] {tr.n} pairs, {tr.deps} dependencies tested: {verdict}")
+
+
 def main():
     print("=" * 90)
     print("GF(2) LINEARITY TEST — Handshake Challenge-Response")
@@ -418,4 +449,7 @@ def main():
 
 
 if __name__ == "__main__":
-    main()
+    if len(sys.argv) >= 3 and sys.argv[1] == "--follow":
+        follow(sys.argv[2])
+    else:
+        main()
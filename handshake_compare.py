@@ -11,28 +11,12 @@ def extract_handshake_messages():
 
     for path, info in A.TEST_FILES.items():
         try:
-            channels, _ = A.parse_capture(path)
+            analysis = A.load_analysis(path)
         except:
             continue
 
-        all_msgs = []
-        for ch_idx in range(len(channels)):
-            ch = channels[ch_idx]
-            if ch is None or not isinstance(ch, list) or len(ch) == 0:
-                continue
-            if not isinstance(ch[0], (tuple, list)):
-                continue
-            bursts = A.find_bursts(ch)
-            for burst in bursts:
-                if A.classify_burst(burst) != 'data':
-                    continue
-                syms, _ = A.decode_pwm(burst)
-                if ch_idx == 0:
-                    name, _, _, _ = A.classify_ch0(syms)
-                else:
-                    name, _, _, _ = A.classify_ch1(syms)
-                t = burst[0][0]
-                all_msgs.append((t, ch_idx, name, syms, burst, path))
+        all_msgs = [(m.time, m.channel, m.name, m.symbols, m.pairs, path)
+                    for m in analysis.messages]
 
         if not all_msgs:
             continue
@@ -41,7 +25,7 @@ def extract_handshake_messages():
         cycle = None
         last_handshake_t = -999
 
-        for t, ch_idx, name, syms, burst, p in all_msgs:
+        for t, ch_idx, name, syms, lh, p in all_msgs:
             if name in ('CMD-B-INIT', 'HANDSHAKE-D', 'HANDSHAKE-E'):
                 if cycle is None or (t - last_handshake_t) > 10:
                     cycle = {'file': path, 'msgs': []}
@@ -51,7 +35,7 @@ def extract_handshake_messages():
                     'channel': ch_idx,
                     'name': name,
                     'syms': syms,
-                    'burst': burst,
+                    'pairs': lh,
                 })
                 last_handshake_t = t
 
@@ -118,7 +102,7 @@ def main():
 
         for msg in all_in_cycle:
             ch_label = "CH0→" if msg['channel'] == 0 else "←CH1"
-            pairs = A.burst_to_lh_pairs(msg['burst'])
+            pairs = msg['pairs']
             is_variable = (msg['name'] == 'CMD-B-INIT' and len(msg['syms']) > 22) or msg['name'] == 'HANDSHAKE-E'
             marker = " *** VARIABLE ***" if is_variable else " (constant)"
 
@@ -136,7 +120,7 @@ def main():
 
     for ex in variable_exchanges:
         for msg in ex['cmd_b_long']:
-            pairs = A.burst_to_lh_pairs(msg['burst'])
+            pairs = msg['pairs']
             syms = msg['syms']
             var_syms = syms[CMD_B_INIT_HDR:]
 
@@ -151,7 +135,7 @@ def main():
 
     for ex in variable_exchanges:
         for msg in ex['handshake_e']:
-            pairs = A.burst_to_lh_pairs(msg['burst'])
+            pairs = msg['pairs']
             syms = msg['syms']
             var_syms = syms[HANDSHAKE_E_HDR:]
 
@@ -172,8 +156,8 @@ def main():
         challenge = ex['cmd_b_long'][0]
         response = ex['handshake_e'][0]
 
-        c_pairs = A.burst_to_lh_pairs(challenge['burst'])
-        r_pairs = A.burst_to_lh_pairs(response['burst'])
+        c_pairs = challenge['pairs']
+        r_pairs = response['pairs']
 
         c_syms = challenge['syms'][CMD_B_INIT_HDR:]
         r_syms = response['syms'][HANDSHAKE_E_HDR:]
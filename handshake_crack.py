@@ -1,6 +1,19 @@
 #!/usr/bin/env python3
-"""handshake_crack.py — Numeric analysis of challenge-response pairs to find the transform."""
+"""handshake_crack.py — Numeric analysis of challenge-response pairs to find the transform.
 
+The printed report shows the pairs under the various encodings; the
+invariants themselves are tested only by the @hypothesis registry (see
+"Hypothesis search"), whose survivors end the report.
+
+Usage:
+    python handshake_crack.py                  # full printed report
+    python handshake_crack.py -j 8             # ...search with 8 processes
+    python handshake_crack.py --search -j 8    # hypothesis search only
+    python handshake_crack.py --test           # search self-test (no captures)
+"""
+
+import os
+import sys
 import analyze as A
 import itertools
 import math
@@ -16,28 +29,12 @@ def extract_pairs():
 
     for path, info in A.TEST_FILES.items():
         try:
-            channels, _ = A.parse_capture(path)
+            analysis = A.load_analysis(path)
         except:
             continue
 
-        all_msgs = []
-        for ch_idx in range(len(channels)):
-            ch = channels[ch_idx]
-            if ch is None or not isinstance(ch, list) or len(ch) == 0:
-                continue
-            if not isinstance(ch[0], (tuple, list)):
-                continue
-            bursts = A.find_bursts(ch)
-            for burst in bursts:
-                if A.classify_burst(burst) != 'data':
-                    continue
-                syms, _ = A.decode_pwm(burst)
-                if ch_idx == 0:
-                    name, _, _, _ = A.classify_ch0(syms)
-                else:
-                    name, _, _, _ = A.classify_ch1(syms)
-                t = burst[0][0]
-                all_msgs.append((t, ch_idx, name, syms, burst, path))
+        all_msgs = [(m.time, m.channel, m.name, m.symbols, m.pairs, path)
+                    for m in analysis.messages]
 
         if not all_msgs:
             continue
@@ -45,14 +42,14 @@ def extract_pairs():
 
         cycle = None
         last_t = -999
-        for t, ch_idx, name, syms, burst, p in all_msgs:
+        for t, ch_idx, name, syms, lh, p in all_msgs:
             if name in ('CMD-B-INIT', 'HANDSHAKE-D', 'HANDSHAKE-E'):
                 if cycle is None or (t - last_t) > 10:
                     cycle = {'file': path, 'msgs': []}
                     boot_sequences.append(cycle)
                 cycle['msgs'].append({
                     'time': t, 'channel': ch_idx, 'name': name,
-                    'syms': syms, 'burst': burst,
+                    'syms': syms, 'pairs': lh,
                 })
                 last_t = t
 
@@ -63,8 +60,8 @@ def extract_pairs():
         if cmd_b_long and handshake_e:
             c = cmd_b_long[0]
             r = handshake_e[0]
-            c_lh = A.burst_to_lh_pairs(c['burst'])[CMD_B_INIT_HDR:]  # variable portion
-            r_lh = A.burst_to_lh_pairs(r['burst'])[HANDSHAKE_E_HDR:]  # variable portion
+            c_lh = c['pairs'][CMD_B_INIT_HDR:]  # variable portion
+            r_lh = r['pairs'][HANDSHAKE_E_HDR:]  # variable portion
             c_syms = c['syms'][CMD_B_INIT_HDR:]
             r_syms = r['syms'][HANDSHAKE_E_HDR:]
             pairs.append({
@@ -154,61 +151,24 @@ def try_xor_relationship(pairs_data):
                   f"ratio={c_sum/r_sum:.3f}" if r_sum else "")
 
 
-def check_sum_invariants(pairs_data):
-    """Check if sum(challenge) + sum(response) = constant, or other sum relationships."""
+def print_sums(pairs_data):
+    """Per-pair challenge/response sums under each encoding (the modular
+    invariants on them are sum_*_mod in the hypothesis search)."""
     print("\n" + "=" * 100)
-    print("TEST: Sum-based invariants")
+    print("Sums per encoding")
     print("=" * 100)
 
     methods = ['L_only', 'H_only', 'L+H', 'L*9+H', 'L*10+H']
 
     for method in methods:
         print(f"\n--- Encoding: {method} ---")
-        c_sums = []
-        r_sums = []
-        totals = []
-        products_mod = []
-        for p in pairs_data:
-            c_vals = pairs_to_values(p['c_lh'], method)
-            r_vals = pairs_to_values(p['r_lh'], method)
-            cs = sum(c_vals)
-            rs = sum(r_vals)
-            c_sums.append(cs)
-            r_sums.append(rs)
-            totals.append(cs + rs)
-
-            # Product of all values mod various primes
-            cp = 1
-            for v in c_vals:
-                if v != 0:
-                    cp = (cp * v)
-            rp = 1
-            for v in r_vals:
-                if v != 0:
-                    rp = (rp * v)
-            products_mod.append((cp, rp))
-
+        c_sums = [sum(pairs_to_values(p['c_lh'], method)) for p in pairs_data]
+        r_sums = [sum(pairs_to_values(p['r_lh'], method)) for p in pairs_data]
         print(f"  Challenge sums: {c_sums}")
         print(f"  Response  sums: {r_sums}")
-        print(f"  C+R totals:     {totals}")
+        print(f"  C+R totals:     {[c + r for c, r in zip(c_sums, r_sums)]}")
         print(f"  C-R diffs:      {[c - r for c, r in zip(c_sums, r_sums)]}")
 
-        # Check if any modular operation gives a constant
-        for mod in [7, 8, 9, 10, 13, 16, 17, 19, 23, 31, 32, 37, 41, 64, 127, 128, 255, 256]:
-            c_mod = [s % mod for s in c_sums]
-            r_mod = [s % mod for s in r_sums]
-            t_mod = [s % mod for s in totals]
-            if len(set(t_mod)) == 1:
-                print(f"  *** CONSTANT (C+R) mod {mod} = {t_mod[0]} ***")
-            if len(set(c_mod)) == 1:
-                print(f"  *** CONSTANT C_sum mod {mod} = {c_mod[0]} ***")
-            d_mod = [(c - r) % mod for c, r in zip(c_sums, r_sums)]
-            if len(set(d_mod)) == 1:
-                print(f"  *** CONSTANT (C-R) mod {mod} = {d_mod[0]} ***")
-            xor_mod = [(c ^ r) % mod for c, r in zip(c_sums, r_sums)]
-            if len(set(xor_mod)) == 1:
-                print(f"  *** CONSTANT (C^R) mod {mod} = {xor_mod[0]} ***")
-
 
 def check_symbol_sums(pairs_data):
     """Check sums of L-symbols and H-symbols separately."""
@@ -404,10 +364,11 @@ def check_lh_as_nibble_bytes(pairs_data):
         print(f"    C_sum%256=0x{c_sum:02x}  R_sum%256=0x{r_sum:02x}  (C+R)%256=0x{(c_sum+r_sum)%256:02x}")
 
 
-def check_last_symbol_checksum(pairs_data):
-    """Check if the last (L,H) pair is a checksum of the preceding ones."""
+def print_last_symbol(pairs_data):
+    """Last (L,H) pair next to sums/XORs of the preceding ones (tested as
+    last_*_checksum in the hypothesis search)."""
     print("\n" + "=" * 100)
-    print("TEST: Last symbol as checksum of preceding payload?")
+    print("Last symbol vs. preceding payload")
     print("=" * 100)
 
     for p in pairs_data:
@@ -440,16 +401,15 @@ def check_last_symbol_checksum(pairs_data):
         print(f"    R last=({r_last[0]},{r_last[1]})  L_sum%10={r_l_sum}  H_sum%10={r_h_sum}  L_xor={r_l_xor}  H_xor={r_h_xor}")
 
 
-def check_bigint_modular(pairs_data):
-    """Pack challenge/response as big integers, check modular relationships."""
+def print_bigints(pairs_data):
+    """Challenge/response packed as base-N integers (the XOR and
+    difference invariants are bigint_* in the hypothesis search)."""
     print("\n" + "=" * 100)
-    print("TEST: Big-integer modular relationships")
+    print("Big-integer packing")
     print("=" * 100)
 
     for method in ['L_only', 'L+H', 'L*9+H']:
         print(f"\n--- Encoding: {method} ---")
-        c_ints = []
-        r_ints = []
         for p in pairs_data:
             c_vals = pairs_to_values(p['c_lh'], method)
             r_vals = pairs_to_values(p['r_lh'], method)
@@ -463,9 +423,6 @@ def check_bigint_modular(pairs_data):
             for v in r_vals:
                 r_num = r_num * base + v
 
-            c_ints.append(c_num)
-            r_ints.append(r_num)
-
             print(f"  Cycle {p['cycle']}: base={base}")
             print(f"    C = {c_num}")
             print(f"    R = {r_num}")
@@ -473,20 +430,221 @@ def check_bigint_modular(pairs_data):
             print(f"    C XOR R = {c_num ^ r_num}")
             print(f"    C - R   = {c_num - r_num}")
 
-        # Check if (C XOR R) is constant
-        xors = [c ^ r for c, r in zip(c_ints, r_ints)]
-        if len(set(xors)) == 1:
-            print(f"\n  *** CONSTANT XOR FOUND: {xors[0]} ***")
 
-        # Check if (C - R) mod N is constant for various N
-        diffs = [c - r for c, r in zip(c_ints, r_ints)]
-        for mod in [256, 65536, 2**32, 2**64]:
-            d_mod = [(d % mod) for d in diffs]
-            if len(set(d_mod)) == 1:
-                print(f"  *** CONSTANT (C-R) mod {mod} = {d_mod[0]} ***")
+# ── Hypothesis search ───────────────────────────────────────────────
+# A hypothesis is a function of one decoded pair that a fixed transform
+# would keep constant across every pair (an invariant), e.g. the sum
+# C+R mod m.  @hypothesis registers it with its parameter space; the
+# search expands hypothesis × method × parameters into independent tasks
+# and fans them out over a process pool.  Each task walks the pairs in
+# order and stops at the first pair that disagrees with the first one,
+# so a wrong guess usually costs two or three pairs.
+#
+# Pairs are decoded once per method in the parent (pairs_to_values and
+# pairs_to_bigint) and handed to the workers when the pool starts.
+# Both the printed report and --search run this registry, so a new
+# invariant is one @hypothesis function.
+
+METHODS = ['L_only', 'H_only', 'L+H', 'L*10+H', 'L*9+H', 'L-1_base9',
+           'LH_concat_bin', 'L*8+H', 'pack_3bit', 'H*9+L']
+MODS = [7, 8, 9, 10, 13, 16, 17, 19, 23, 31, 32, 37, 41, 64, 127, 128, 255, 256]
+
+HYPOTHESES = {}         # name → (fn, methods, {param: values})
+
+
+def hypothesis(methods=METHODS, **space):
+    """Register fn(d, **params) → invariant.  d is one decoded pair:
+    d.c / d.r value lists, d.cn / d.rn packed big integers."""
+    def reg(fn):
+        HYPOTHESES[fn.__name__] = (fn, methods, space)
+        return fn
+    return reg
+
+
+class Decoded:
+    __slots__ = ('c', 'r', 'cn', 'rn')
+
+    def __init__(self, p, method):
+        self.c = pairs_to_values(p['c_lh'], method)
+        self.r = pairs_to_values(p['r_lh'], method)
+        self.cn = pairs_to_bigint(p['c_lh'], method)
+        self.rn = pairs_to_bigint(p['r_lh'], method)
+
+
+def _xor_all(vals):
+    x = 0
+    for v in vals:
+        x ^= v
+    return x
+
+
+@hypothesis(m=MODS)
+def sum_total_mod(d, m):
+    return (sum(d.c) + sum(d.r)) % m
+
+
+@hypothesis(m=MODS)
+def sum_diff_mod(d, m):
+    return (sum(d.c) - sum(d.r)) % m
+
+
+@hypothesis(m=MODS)
+def sum_xor_mod(d, m):
+    return (sum(d.c) ^ sum(d.r)) % m
+
+
+@hypothesis(m=MODS)
+def sum_challenge_mod(d, m):
+    return sum(d.c) % m
+
+
+@hypothesis()
+def value_xor(d):
+    return _xor_all(d.c) ^ _xor_all(d.r)
+
+
+@hypothesis()
+def bigint_xor(d):
+    return d.cn ^ d.rn
+
+
+@hypothesis(n=[256, 65536, 2**32, 2**64])
+def bigint_diff_mod(d, n):
+    return (d.cn - d.rn) % n
+
+
+@hypothesis(side=['c', 'r'], m=[8, 9, 10, 16, 256])
+def last_sum_checksum(d, side, m):
+    v = d.c if side == 'c' else d.r
+    return (v[-1] - sum(v[:-1])) % m
+
+
+@hypothesis(side=['c', 'r'])
+def last_xor_checksum(d, side):
+    v = d.c if side == 'c' else d.r
+    return v[-1] ^ _xor_all(v[:-1])
+
+
+@hypothesis(m=[251, 256, 257])
+def product_ratio_mod(d, m):
+    cp = math.prod(v for v in d.c if v) % m
+    rp = math.prod(v for v in d.r if v) % m
+    return (cp * pow(rp, -1, m)) % m if math.gcd(rp, m) == 1 else ('nc', cp, rp)
+
+
+def search_tasks(names=None):
+    """(name, method, params) for every registered hypothesis."""
+    tasks = []
+    for name, (_, methods, space) in HYPOTHESES.items():
+        if names and name not in names:
+            continue
+        keys = list(space)
+        for method in methods:
+            for vals in itertools.product(*(space[k] for k in keys)):
+                tasks.append((name, method, dict(zip(keys, vals))))
+    return tasks
+
+
+_DECODED = None         # method → [Decoded, ...], set per worker
+
+
+def _init_worker(decoded):
+    global _DECODED
+    _DECODED = decoded
+
+
+def run_task(task):
+    """→ (task, survived, pairs checked, invariant or None)."""
+    name, method, params = task
+    fn = HYPOTHESES[name][0]
+    rows = _DECODED[method]
+    try:
+        first = fn(rows[0], **params)
+        for i in range(1, len(rows)):
+            if fn(rows[i], **params) != first:
+                return task, False, i + 1, None
+    except (ValueError, ZeroDivisionError, IndexError):
+        return task, False, 0, None
+    return task, True, len(rows), first
+
+
+def search(pairs_data, jobs=1, names=None):
+    """Run every task; results come back in task order."""
+    tasks = search_tasks(names)
+    methods = sorted({m for _, m, _ in tasks})
+    decoded = {m: [Decoded(p, m) for p in pairs_data] for m in methods}
+    jobs = jobs or os.cpu_count() or 1
+    if jobs == 1 or len(tasks) < 2:
+        _init_worker(decoded)
+        return [run_task(t) for t in tasks]
+    from concurrent.futures import ProcessPoolExecutor
+    with ProcessPoolExecutor(max_workers=jobs, initializer=_init_worker,
+                             initargs=(decoded,)) as pool:
+        return list(pool.map(run_task, tasks,
+                             chunksize=max(1, len(tasks) // (jobs * 8))))
+
+
+def report_search(results, n_pairs):
+    print("\n" + "=" * 100)
+    print(f"HYPOTHESIS SEARCH — {len(results)} tasks over {n_pairs} pairs")
+    print("=" * 100)
+    if n_pairs < 3:
+        print("  (fewer than 3 pairs: survivors below mean very little)")
+    dead = [k for _, ok, k, _ in results if not ok]
+    if dead:
+        print(f"\n  Falsified: {len(dead)}  (mean {sum(dead) / len(dead):.1f} pairs checked, "
+              f"{sum(k <= 3 for k in dead)} within 3)")
+    alive = [(t, k, v) for t, ok, k, v in results if ok]
+    print(f"  Survived:  {len(alive)}")
+    for (name, method, params), k, v in alive:
+        ps = ' '.join(f"{a}={b}" for a, b in params.items())
+        print(f"  *** {name:<20s} {method:<14s} {ps:<14s} = {v}  (all {k} pairs) ***")
+
+
+def self_test():
+    print("=== handshake_crack.py search self-test ===\n")
+    import random
+    rng = random.Random(7030)
+    pairs = []
+    for i in range(12):
+        c = [(rng.randint(1, 6), rng.randint(0, 8)) for _ in range(23)]
+        r = [(rng.randint(1, 6), rng.randint(0, 8)) for _ in range(13)]
+        k = (5 - sum(l for l, _ in c) - sum(l for l, _ in r)) % 16
+        r[-1] = (r[-1][0] + k if r[-1][0] + k <= 16 else r[-1][0] + k - 16, r[-1][1])
+        pairs.append({'cycle': i + 1, 'c_lh': c, 'r_lh': r})
+    seq = search(pairs, jobs=1)
+    par = search(pairs, jobs=2)
+    planted = [(t, v) for t, ok, _, v in seq
+               if ok and t == ('sum_total_mod', 'L_only', {'m': 16})]
+    dead = [k for _, ok, k, _ in seq if not ok]
+    checks = [
+        ("planted invariant found", planted and planted[0][1] == 5),
+        ("parallel == sequential", seq == par),
+        ("early exit", dead and sum(dead) / len(dead) < 4),
+    ]
+    ok = True
+    for name, passed in checks:
+        print(f"  {'PASS' if passed else 'FAIL'}: {name}")
+        ok &= bool(passed)
+    print(f"\n=== Self-test {'PASSED' if ok else 'FAILED'} ===")
+    return ok
 
 
 def main():
+    if "--test" in sys.argv[1:]:
+        sys.exit(0 if self_test() else 1)
+    jobs = 1
+    for flag in ("--jobs", "-j"):
+        if flag in sys.argv:
+            jobs = int(sys.argv[sys.argv.index(flag) + 1])
+    if "--search" in sys.argv[1:]:
+        pairs_data = extract_pairs()
+        if not pairs_data:
+            print("No challenge-response pairs found")
+            return
+        report_search(search(pairs_data, jobs), len(pairs_data))
+        return
+
     print("Extracting challenge-response pairs...")
     pairs_data = extract_pairs()
     print(f"Found {len(pairs_data)} paired challenge-response cycles\n")
@@ -495,13 +653,14 @@ def main():
     estimate_entropy(pairs_data)
     check_symbol_sums(pairs_data)
     check_value_distribution(pairs_data)
-    check_sum_invariants(pairs_data)
+    print_sums(pairs_data)
     check_total_duration_invariant(pairs_data)
-    check_last_symbol_checksum(pairs_data)
+    print_last_symbol(pairs_data)
     pack_as_bytes(pairs_data)
     check_lh_as_nibble_bytes(pairs_data)
-    check_bigint_modular(pairs_data)
+    print_bigints(pairs_data)
     try_xor_relationship(pairs_data)
+    report_search(search(pairs_data, jobs), len(pairs_data))
 
     print("\n" + "=" * 100)
     print("FEASIBILITY ASSESSMENT: Breaking with ~100 captures")
@@ -4,7 +4,8 @@ Key insight: data_B sum appears CONSTANT while data_A sum changes with position.
 """
 import sys, os
 sys.path.insert(0, os.path.dirname(__file__))
-from analyze import parse_capture, find_bursts, BURST_GAP_S
+from analyze import (parse_capture, suppress_crosstalk, find_bursts, BURST_GAP_S,
+                     CROSSTALK_THRESH)
 
 PWM_UNIT_US = 26.0
 HDR_L = [1,7,2,1,4,6,2,9]
@@ -28,7 +29,7 @@ def burst_to_pairs(burst):
     return pairs
 
 def extract(filepath):
-    channels, _ = parse_capture(filepath)
+    channels, _ = suppress_crosstalk(parse_capture(filepath)[0])
     ch1 = channels.get(1, [])
     if not ch1: return []
     msgs = []
@@ -104,12 +105,12 @@ def analyze_file(filepath, label, expected):
         # Compute pair sums: sum of (L + H) for A and B data regions
         a_pairs_sum = sum(pos_pairs[data_start + i][0] + pos_pairs[data_start + i][1]
                          for i in range(len(a_l))
-                         if pos_pairs[data_start + i][1] <= 10)  # exclude crosstalk
+                         if pos_pairs[data_start + i][1] <= CROSSTALK_THRESH)  # exclude crosstalk
         
         b_start = delim_idx + 2 if delim_idx is not None else len(pos_pairs)
         b_pairs_sum = sum(pos_pairs[b_start + i][0] + pos_pairs[b_start + i][1]
                          for i in range(len(b_l))
-                         if b_start + i < len(pos_pairs) and pos_pairs[b_start + i][1] <= 10)
+                         if b_start + i < len(pos_pairs) and pos_pairs[b_start + i][1] <= CROSSTALK_THRESH)
         
         total = a_pairs_sum + b_pairs_sum
         
@@ -118,8 +119,8 @@ def analyze_file(filepath, label, expected):
         times.append(t)
         
         # Filter crosstalk from display  
-        a_h_clean = [h if h <= 10 else f"*{h}*" for h in a_h]
-        b_h_clean = [h if h <= 10 else f"*{h}*" for h in b_h]
+        a_h_clean = [h if h <= CROSSTALK_THRESH else f"*{h}*" for h in a_h]
+        b_h_clean = [h if h <= CROSSTALK_THRESH else f"*{h}*" for h in b_h]
         
         print(f"  {t:8.3f}s {str(state):>5s} {prefix:>4s} {str(delim_type):>4s}"
               f" {str(a_l):>20s} {str(a_h_clean):>20s} {a_pairs_sum:>5d}"
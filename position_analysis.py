@@ -8,8 +8,7 @@ import os
 import sys
 import io
 from analyze import (
-    parse_capture, find_bursts, classify_burst, burst_pulses,
-    decode_pwm, TYPE_B_HEADER, TYPE_B_HEADER_LEN, PWM_UNIT_US,
+    load_analysis, TYPE_B_HEADER, TYPE_B_HEADER_LEN, PWM_UNIT_US,
     DOOR_STATE_MAP, DIRECTION_MAP
 )
 
@@ -26,18 +25,13 @@ def extract_type_b_raw(filepath):
         time, symbols, raw_us, header_syms, payload_syms,
         header_raw, payload_raw, door_state, direction
     """
-    channels, _ = parse_capture(filepath)
     results = []
     
-    if not channels[1]:
-        return results
-    
-    bursts = find_bursts(channels[1])
-    for burst in bursts:
-        if classify_burst(burst) != "data":
+    for m in load_analysis(filepath).messages:
+        if m.channel != 1:
             continue
         
-        symbols, raw_us = decode_pwm(burst)
+        symbols, raw_us = m.symbols, m.low_us
         
         # Check if it's a Type B message
         if len(symbols) < TYPE_B_HEADER_LEN + 2:
@@ -57,7 +51,7 @@ def extract_type_b_raw(filepath):
             direction = DIRECTION_MAP.get(tuple(payload_syms[5:7]))
         
         results.append({
-            "time": burst[0][0],
+            "time": m.time,
             "symbols": symbols,
             "raw_us": raw_us,
             "header_syms": symbols[:TYPE_B_HEADER_LEN],
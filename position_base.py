@@ -25,7 +25,7 @@ if sys.platform == "win32":
     sys.stdout.reconfigure(encoding="utf-8", errors="replace")
 
 sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
-from analyze import (parse_capture, find_bursts, classify_burst, decode_pwm,
+from analyze import (load_analysis,
                      TYPE_B_HEADER, TYPE_B_HEADER_LEN, DOOR_STATE_MAP)
 
 
@@ -61,14 +61,11 @@ def syms_to_bits_be(syms):
 
 def extract_messages(filepath):
     """Extract Type B messages with full payload."""
-    channels, _ = parse_capture(filepath)
-    if not channels or not channels.get(1):
-        return []
     messages = []
-    for burst in find_bursts(channels[1]):
-        if classify_burst(burst) != "data":
+    for m in load_analysis(filepath).messages:
+        if m.channel != 1:
             continue
-        symbols, raw_us = decode_pwm(burst)
+        symbols, raw_us = m.symbols, m.low_us
         if len(symbols) < TYPE_B_HEADER_LEN + 7:
             continue
         if tuple(symbols[:TYPE_B_HEADER_LEN]) != TYPE_B_HEADER:
@@ -78,7 +75,7 @@ def extract_messages(filepath):
         state_key = tuple(payload[0:2])
         state_name = DOOR_STATE_MAP.get(state_key, f"UNK{state_key}")
         messages.append({
-            "time": burst[0][0],
+            "time": m.time,
             "payload": payload,
             "payload_us": payload_us,
             "state": state_name,
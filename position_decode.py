@@ -20,22 +20,17 @@ if sys.platform == "win32":
     sys.stdout.reconfigure(encoding="utf-8", errors="replace")
 
 sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
-from analyze import (parse_capture, find_bursts, classify_burst, burst_pulses,
-                     decode_pwm, TYPE_B_HEADER, TYPE_B_HEADER_LEN, PWM_UNIT_US,
+from analyze import (load_analysis, TYPE_B_HEADER, TYPE_B_HEADER_LEN, PWM_UNIT_US,
                      DOOR_STATE_MAP, DIRECTION_MAP)
 
 
 def extract_messages(filepath):
     """Extract Type B messages with full payload and raw µs."""
-    channels, col_count = parse_capture(filepath)
-    if not channels or not channels.get(1):
-        return []
-    bursts = find_bursts(channels[1])
     messages = []
-    for burst in bursts:
-        if classify_burst(burst) != "data":
+    for m in load_analysis(filepath).messages:
+        if m.channel != 1:
             continue
-        symbols, raw_us = decode_pwm(burst)
+        symbols, raw_us = m.symbols, m.low_us
         if len(symbols) < TYPE_B_HEADER_LEN + 2:
             continue
         if tuple(symbols[:TYPE_B_HEADER_LEN]) != TYPE_B_HEADER:
@@ -46,7 +41,7 @@ def extract_messages(filepath):
         state_key = tuple(payload[0:2]) if len(payload) >= 2 else None
         state_name = DOOR_STATE_MAP.get(state_key, f"UNK{state_key}")
         messages.append({
-            "time": burst[0][0],  # seconds (already in seconds)
+            "time": m.time,  # seconds
             "payload": payload,
             "payload_us": payload_us,
             "state": state_name,
@@ -0,0 +1,273 @@
+#!/usr/bin/env python3
+"""replay.py — Play a logic-analyzer capture back through the capture rig.
+
+For firmware built with MONITOR_MODE=1 TX_MODE=2 (see "Traffic
+generator" in esp32_capture/main/main.c).  Every data burst in the
+capture goes to the rig as a FRAME_TX frame, its start time plus its
+(L,H) pairs, and the rig drives it onto CH0/CH1 in 26 µs units at that
+time.  With TX_LOOPBACK the rig captures and decodes its own traffic:
+the decoded records go to monitor.jsonl as with collect.py, and its
+"tx:" log line counts echoes that came back ok, bad or not at all.
+
+--speed N divides the idle time between messages by N, for soak tests
+at many times the real message rate; two messages on the same channel
+are never put closer than the decoder's 10 ms gap, so each still
+decodes on its own.  --loop N plays the capture N times back to back.
+--csv writes the schedule as an LA CSV instead of sending it, which
+analyze.py and bench.py read like any other capture.
+
+Usage:
+    python replay.py COM5 test04_open_full.txt
+    python replay.py COM5 t07c_full_cycle.txt --speed 8 --loop 50
+    python replay.py t07c_full_cycle.txt --speed 8 --csv fast.txt
+    python replay.py --test                  # no hardware needed
+"""
+
+import os
+import sys
+import time
+import argparse
+import tempfile
+import threading
+
+import analyze as A
+import collect as C
+import dump_collect as DC
+
+MAX_PAIRS = 128             # firmware msg_t limit
+MAX_UNITS = 255             # firmware L/H are u8
+GAP_MARGIN_S = 0.002        # on top of BURST_GAP_S between messages
+QUIET_S = 2.0               # keep reading this long after the last frame
+
+
+# ── Schedule ────────────────────────────────────────────────────────
+
+def capture_messages(path):
+    """Data bursts of a capture → ([(t_s, ch, pairs), ...], skipped).
+
+    Pairs are clamped to the firmware's u8 units; bursts with more than
+    MAX_PAIRS pairs cannot be sent and are counted in skipped.
+    """
+    channels, _ = A.parse_capture(path)
+    msgs, skipped = [], 0
+    for ch in (0, 1):
+        for burst in A.find_bursts(channels[ch]):
+            if A.classify_burst(burst) != "data":
+                continue
+            pairs = [(min(l, MAX_UNITS), min(h, MAX_UNITS))
+                     for l, h in A.burst_to_lh_pairs(burst)]
+            if len(pairs) > MAX_PAIRS:
+                skipped += 1
+                continue
+            msgs.append((burst[0][0], ch, pairs))
+    msgs.sort(key=lambda m: m[0])
+    return msgs, skipped
+
+
+def duration_s(pairs):
+    return sum(l + h for l, h in pairs) * A.PWM_UNIT_US / 1e6
+
+
+def schedule(msgs, speed=1.0, loops=1, min_gap_s=A.BURST_GAP_S + GAP_MARGIN_S):
+    """[(t_s, ch, pairs)] → [(t_us, ch, pairs)] from 0, idle time / speed.
+
+    Times only ever move forward.  Each message starts at least
+    min_gap_s after the end of the previous one on its channel, and a
+    new loop starts right after the last message of the one before.
+    """
+    out = []
+    end = [float("-inf")] * 2
+    cur = 0.0
+    prev = None
+    for _ in range(loops):
+        for t, ch, pairs in msgs:
+            if prev is not None:
+                cur += max(t - prev, 0.0) / speed
+            cur = max(cur, end[ch] + min_gap_s)
+            end[ch] = cur + duration_s(pairs)
+            prev = t
+            out.append((round(cur * 1e6), ch, pairs))
+    return out
+
+
+def tx_frame(t_us, ch, pairs):
+    """One FRAME_TX.  t is the firmware's 32-bit µs; past ~71 min it
+    wraps and the rig treats the wrap as a new replay start."""
+    return C.encode_frame(C.FRAME_TX, C.TX_HDR.pack(t_us & 0xFFFFFFFF, ch)
+                          + C.pack_pairs(pairs))
+
+
+def write_csv(sched, path):
+    """Render a schedule as the LA1010 CSV layout parse_capture reads."""
+    unit = A.PWM_UNIT_US
+    edges = []
+    for t, ch, pairs in sched:
+        for l, h in pairs:
+            edges.append((t, ch, 0))
+            t += round(l * unit)
+            edges.append((t, ch, 1))
+            t += round(h * unit)
+    edges.sort()
+    levels = [1, 1]
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("Time[s], Channel 0, Channel 1\n0.000000, 1, 1\n")
+        for t, ch, lv in edges:
+            levels[ch] = lv
+            f.write(f"{t / 1e6:.6f}, {levels[0]}, {levels[1]}\n")
+    return len(edges)
+
+
+# ── Serial session ──────────────────────────────────────────────────
+
+def run(ser, sched, monfile):
+    """Send the schedule from a writer thread, log what comes back."""
+    done = threading.Event()
+
+    def writer():
+        try:
+            for t, ch, pairs in sched:
+                ser.write(tx_frame(t, ch, pairs))
+            ser.flush()
+        finally:
+            done.set()
+
+    dec = C.FrameDecoder()
+    threading.Thread(target=writer, daemon=True).start()
+    t_end = None
+    with open(monfile, "a", encoding="utf-8") as mf:
+        col = C.Collector(mf, mf, target=None)
+        try:
+            while t_end is None or time.monotonic() < t_end:
+                chunk = ser.read(ser.in_waiting or 1)
+                for ev in dec.feed(chunk):
+                    if ev[0] == "text":
+                        col.handle_text(ev[1])
+                    else:
+                        rec = C.frame_to_record(ev[1], ev[2])
+                        if rec is not None:
+                            col.handle(rec)
+                if t_end is None and done.is_set():
+                    # The rig plays the last frame TX_LEAD_US or more
+                    # after reading it, then reports on its next status
+                    t_end = time.monotonic() + QUIET_S
+                    print("  all frames sent, waiting for the rig to finish")
+        except KeyboardInterrupt:
+            print("\nStopped.")
+    if dec.bad:
+        print(f"({dec.bad} corrupt frame bytes skipped)")
+
+
+# ── Self-test ───────────────────────────────────────────────────────
+
+def self_test():
+    import bench
+    print("=== replay.py self-test ===\n")
+    checks = []
+
+    # Frames carry the schedule exactly
+    pairs = [(1, 1), (7, 1), (3, 17), (200, 0)]
+    evs = list(C.FrameDecoder().feed(b"I (1) capture: x\r\n" + tx_frame(123456, 1, pairs)))
+    fr = [e for e in evs if e[0] == "frame"]
+    ok = len(fr) == 1 and fr[0][1] == C.FRAME_TX
+    if ok:
+        t, ch = C.TX_HDR.unpack_from(fr[0][2])
+        got, _ = C.unpack_pairs(fr[0][2], C.TX_HDR.size)
+        ok = (t, ch, got) == (123456, 1, [list(p) for p in pairs])
+    checks.append(("FRAME_TX round trip", ok))
+
+    d = tempfile.mkdtemp(prefix="replay_")
+    src, fast = os.path.join(d, "synth.txt"), os.path.join(d, "fast.txt")
+    try:
+        truth = bench.synth_capture(src, 20000)
+        msgs, skipped = capture_messages(src)
+        checks.append(("capture → messages", skipped == 0 and
+                       [(ch, p) for _, ch, p in msgs] ==
+                       [(ch, p) for _, ch, _, p, _ in truth]))
+
+        speed, loops = 20, 3
+        sched = schedule(msgs, speed, loops)
+        gap_ok = all(b[0] > a[0] for a, b in zip(sched, sched[1:]))
+        last = {}
+        for t, ch, p in sched:
+            if ch in last:
+                gap_ok &= t - last[ch] >= (A.BURST_GAP_S + GAP_MARGIN_S) * 1e6 - 1
+            last[ch] = t + duration_s(p) * 1e6
+        span = msgs[-1][0] - msgs[0][0]
+        fast_s = (sched[len(msgs) - 1][0] - sched[0][0]) / 1e6
+        slow = [(i * 0.5, i % 2, [(1, 1), (7, 0)]) for i in range(10)]
+        checks.append(("schedule ordered, gaps ≥ decoder gap", gap_ok))
+        checks.append(("idle time divided by speed",
+                       [t for t, _, _ in schedule(slow, 10)] ==
+                       [i * 50000 for i in range(10)]))
+
+        # What the rig would see decodes back to the same messages
+        write_csv(sched, fast)
+        back = A.analyze_capture(fast).messages
+        want = [n for _ in range(loops) for _, _, n, _, _ in truth]
+        checks.append(("compressed replay decodes unchanged",
+                       [m.pairs for m in back] == [p for _, _, p in sched]
+                       and [m.name for m in back] == want))
+        print(f"  {len(msgs)} messages, {span:.1f} s → {fast_s:.1f} s per loop "
+              f"at --speed {speed}\n")
+    finally:
+        for p in (src, fast):
+            if os.path.exists(p):
+                os.remove(p)
+        os.rmdir(d)
+
+    ok = True
+    for name, passed in checks:
+        print(f"  {'PASS' if passed else 'FAIL'}: {name}")
+        ok &= passed
+    print(f"\n=== Self-test {'PASSED' if ok else 'FAILED'} ===")
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0],
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port", nargs="?")
+    ap.add_argument("capture", nargs="?")
+    ap.add_argument("--speed", type=float, default=1.0, help="divide idle time by this")
+    ap.add_argument("--loop", type=int, default=1, help="play the capture this many times")
+    ap.add_argument("--csv", help="write the schedule as an LA CSV instead of sending")
+    ap.add_argument("--monitor", default="monitor.jsonl")
+    ap.add_argument("--test", action="store_true", help="self-test, no hardware")
+    args = ap.parse_args()
+
+    if args.test:
+        sys.exit(0 if self_test() else 1)
+    if args.csv and args.capture is None:
+        args.port, args.capture = None, args.port
+    if not args.capture or not (args.port or args.csv):
+        ap.error("need PORT and CAPTURE (or CAPTURE with --csv)")
+    if args.speed <= 0 or args.loop < 1:
+        ap.error("--speed must be > 0 and --loop ≥ 1")
+
+    msgs, skipped = capture_messages(args.capture)
+    if not msgs:
+        print(f"No data bursts in {args.capture}")
+        sys.exit(1)
+    sched = schedule(msgs, args.speed, args.loop)
+    span = (sched[-1][0] - sched[0][0]) / 1e6
+    print(f"{args.capture}: {len(msgs)} messages × {args.loop} → {span:.1f} s"
+          f"{f' ({skipped} bursts over {MAX_PAIRS} pairs skipped)' if skipped else ''}")
+
+    if args.csv:
+        n = write_csv(sched, args.csv)
+        print(f"Wrote {n} edges → {args.csv}")
+        return
+    if DC.serial is None:
+        print("pyserial is required: pip install pyserial")
+        sys.exit(1)
+    ser = DC.open_serial(args.port)
+    ser.timeout = 0.2
+    print(f"Replaying on {args.port} — decoded records to {args.monitor}")
+    try:
+        run(ser, sched, args.monitor)
+    finally:
+        ser.close()
+
+
+if __name__ == "__main__":
+    main()